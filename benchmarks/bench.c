@@ -0,0 +1,442 @@
+/* This file is part of PocPlot.
+ *
+ * PocPlot is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * PocPlot is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with PocPlot; if not, see
+ * <https://www.gnu.org/licenses/>.
+ *
+ * Copyright 2020 Brian Stafford
+ */
+
+/* Benchmarks for the PocPlot drawing paths.
+ *
+ * Each benchmark is repeated until it has run for at least the minimum time
+ * and its timings are written to stdout as one JSON object per line, for
+ * example
+ *
+ *   {"benchmark":"dataset-draw","points":1000,"axis":"linear",
+ *    "decimation":"none","iterations":412,"mean_s":0.000605,"min_s":0.000571}
+ *
+ * so that results may be collected and compared between releases.
+ */
+#include <poc.h>
+#include <math.h>
+#include "pocbag.h"
+
+#define WIDTH	800
+#define HEIGHT	600
+
+static guint max_points = 10000000;
+static gdouble min_time = 0.25;
+
+/* timing {{{1 */
+
+typedef void (*BenchFunc) (gpointer data);
+
+static void
+bench_run (const gchar *name, const gchar *params, BenchFunc func, gpointer data)
+{
+  gint64 start, elapsed, total, best;
+  guint iterations;
+
+  total = 0;
+  best = G_MAXINT64;
+  for (iterations = 0; iterations < 3 || total < min_time * G_USEC_PER_SEC;
+       iterations++)
+    {
+      start = g_get_monotonic_time ();
+      (*func) (data);
+      elapsed = g_get_monotonic_time () - start;
+      total += elapsed;
+      if (elapsed < best)
+	best = elapsed;
+    }
+
+  g_print ("{\"benchmark\":\"%s\",%s,\"iterations\":%u,"
+	   "\"mean_s\":%.9g,\"min_s\":%.9g}\n",
+	   name, params, iterations,
+	   (gdouble) total / iterations / G_USEC_PER_SEC,
+	   (gdouble) best / G_USEC_PER_SEC);
+}
+
+/* test data {{{1 */
+
+/* A noisy sine wave with increasing x from 1 to n so that both linear and
+   logarithmic axes may be used.  */
+static void
+make_data (guint n, PocVector **x, PocVector **y)
+{
+  PocDoubleArray *xa, *ya;
+  GRand *rand;
+  guint i;
+
+  rand = g_rand_new_with_seed (n);
+  xa = poc_double_array_sized_new (n);
+  ya = poc_double_array_sized_new (n);
+  poc_double_array_set_size (xa, n);
+  poc_double_array_set_size (ya, n);
+  for (i = 0; i < n; i++)
+    {
+      poc_double_array_index (xa, i) = i + 1;
+      poc_double_array_index (ya, i) = sin (i * 20.0 * G_PI / n)
+				       + g_rand_double_range (rand, -0.1, 0.1);
+    }
+  *x = poc_vector_new_from_double_array (xa);
+  *y = poc_vector_new_from_double_array (ya);
+  poc_double_array_unref (xa);
+  poc_double_array_unref (ya);
+  g_rand_free (rand);
+}
+
+static PocAxis *
+make_axis (PocAxisMode mode, gdouble lower, gdouble upper)
+{
+  PocAxis *axis;
+
+  axis = poc_axis_new ();
+  poc_axis_set_axis_mode (axis, mode);
+  poc_axis_set_lower_bound (axis, lower);
+  poc_axis_set_upper_bound (axis, upper);
+  return axis;
+}
+
+static PocDataset *
+make_dataset (GType type, guint n, PocAxis *x_axis, PocAxis *y_axis)
+{
+  PocDataset *dataset;
+  PocVector *x, *y;
+
+  dataset = g_object_new (type, NULL);
+  make_data (n, &x, &y);
+  poc_dataset_set_vectors (dataset, x, y);
+  poc_dataset_set_sorted_x (dataset, TRUE);
+  poc_dataset_set_x_axis (dataset, x_axis);
+  poc_dataset_set_y_axis (dataset, y_axis);
+  poc_vector_unref (x);
+  poc_vector_unref (y);
+  return dataset;
+}
+
+/* dataset drawing {{{1 */
+
+struct draw_closure
+  {
+    cairo_t *cr;
+    PocDataset *dataset;
+    gboolean invalidate;
+  };
+
+static void
+bench_dataset_draw (gpointer data)
+{
+  struct draw_closure *closure = data;
+
+  if (closure->invalidate)
+    poc_dataset_invalidate (closure->dataset);
+  cairo_save (closure->cr);
+  poc_dataset_draw (closure->dataset, closure->cr, WIDTH, HEIGHT);
+  cairo_restore (closure->cr);
+}
+
+static void
+bench_datasets (cairo_t *cr)
+{
+  static const PocDecimation decimations[] =
+    {
+      POC_DECIMATION_NONE, POC_DECIMATION_MIN_MAX, POC_DECIMATION_PYRAMID,
+    };
+  static const PocAxisMode modes[] = { POC_AXIS_LINEAR, POC_AXIS_LOG_DECADE, };
+  struct draw_closure closure;
+  PocAxis *x_axis, *y_axis;
+  gchar *params;
+  guint n, i, j;
+
+  closure.cr = cr;
+  for (n = 1000; n <= max_points; n *= 10)
+    for (i = 0; i < G_N_ELEMENTS (modes); i++)
+      {
+	x_axis = make_axis (modes[i], 1.0, n);
+	y_axis = make_axis (POC_AXIS_LINEAR, -1.5, 1.5);
+	closure.dataset = make_dataset (POC_TYPE_DATASET, n, x_axis, y_axis);
+	for (j = 0; j < G_N_ELEMENTS (decimations); j++)
+	  {
+	    /* Undecimated lines of millions of points take too long */
+	    if (decimations[j] == POC_DECIMATION_NONE && n > 1000000)
+	      continue;
+	    poc_dataset_set_decimation (closure.dataset, decimations[j]);
+	    params = g_strdup_printf ("\"points\":%u,\"axis\":\"%s\","
+				      "\"decimation\":\"%s\"", n,
+				      poc_enum_to_string (POC_TYPE_AXIS_MODE,
+							  modes[i]),
+				      poc_enum_to_string (POC_TYPE_DECIMATION,
+							  decimations[j]));
+	    /* Cached path, only the first iteration projects the points */
+	    closure.invalidate = FALSE;
+	    bench_run ("dataset-draw", params, bench_dataset_draw, &closure);
+	    /* Project, decimate and draw on every iteration */
+	    closure.invalidate = TRUE;
+	    bench_run ("dataset-draw-invalidate", params, bench_dataset_draw,
+		       &closure);
+	    g_free (params);
+	  }
+	g_object_unref (closure.dataset);
+	g_object_unref (x_axis);
+	g_object_unref (y_axis);
+      }
+}
+
+static void
+bench_dataset_spline (cairo_t *cr)
+{
+  struct draw_closure closure;
+  PocAxis *x_axis, *y_axis;
+  gchar *params;
+  guint n;
+
+  closure.cr = cr;
+  for (n = 1000; n <= max_points && n <= 1000000; n *= 10)
+    {
+      x_axis = make_axis (POC_AXIS_LINEAR, 1.0, n);
+      y_axis = make_axis (POC_AXIS_LINEAR, -1.5, 1.5);
+      closure.dataset = make_dataset (POC_TYPE_DATASET_SPLINE, n,
+				      x_axis, y_axis);
+      params = g_strdup_printf ("\"points\":%u", n);
+
+      /* Cached spline, only the line is drawn */
+      closure.invalidate = FALSE;
+      bench_run ("spline-draw", params, bench_dataset_draw, &closure);
+      /* Solve, sample and draw on every iteration */
+      closure.invalidate = TRUE;
+      bench_run ("spline-draw-invalidate", params, bench_dataset_draw, &closure);
+
+      g_free (params);
+      g_object_unref (closure.dataset);
+      g_object_unref (x_axis);
+      g_object_unref (y_axis);
+    }
+}
+
+/* spline {{{1 */
+
+struct spline_closure
+  {
+    PocVector *x;
+    PocVector *y;
+    PocSpline *spline;
+    guint n;
+  };
+
+static void
+bench_spline_solve (gpointer data)
+{
+  struct spline_closure *closure = data;
+
+  poc_spline_unref (poc_spline_new_vectors (closure->x, closure->y));
+}
+
+static void
+bench_spline_sample (gpointer data)
+{
+  struct spline_closure *closure = data;
+
+  poc_point_array_unref (poc_spline_sample_points (closure->spline,
+						   1.0, closure->n, WIDTH));
+}
+
+static void
+bench_spline_evaluate (gpointer data)
+{
+  struct spline_closure *closure = data;
+  volatile gdouble sum = 0.0;
+  guint i;
+
+  /* Scattered evaluation, each a binary search for the interval */
+  for (i = 0; i < WIDTH; i++)
+    sum += poc_spline_evaluate (closure->spline,
+				1.0 + (gdouble) (i * 7919u % WIDTH) * closure->n / WIDTH);
+}
+
+static void
+bench_splines (void)
+{
+  struct spline_closure closure;
+  gchar *params;
+  guint n;
+
+  for (n = 1000; n <= max_points; n *= 10)
+    {
+      make_data (n, &closure.x, &closure.y);
+      closure.spline = poc_spline_new_vectors (closure.x, closure.y);
+      closure.n = n;
+      params = g_strdup_printf ("\"points\":%u", n);
+      bench_run ("spline-solve", params, bench_spline_solve, &closure);
+      bench_run ("spline-sample", params, bench_spline_sample, &closure);
+      bench_run ("spline-evaluate", params, bench_spline_evaluate, &closure);
+      g_free (params);
+      poc_spline_unref (closure.spline);
+      poc_vector_unref (closure.x);
+      poc_vector_unref (closure.y);
+    }
+}
+
+/* object bag {{{1 */
+
+struct bag_closure
+  {
+    GObject **objects;
+    guint n;
+  };
+
+static void
+bench_bag (gpointer data)
+{
+  struct bag_closure *closure = data;
+  PocObjectBag *bag;
+  guint i;
+
+  bag = poc_object_bag_new ();
+  for (i = 0; i < closure->n; i++)
+    poc_object_bag_add (bag, closure->objects[i]);
+  for (i = 0; i < closure->n; i++)
+    g_assert (poc_object_bag_contains (bag, closure->objects[closure->n - i - 1]));
+  poc_object_bag_unref (bag);
+}
+
+static void
+bench_bags (void)
+{
+  struct bag_closure closure;
+  gchar *params;
+  guint n, i;
+
+  for (n = 1000; n <= max_points && n <= 100000; n *= 10)
+    {
+      closure.n = n;
+      closure.objects = g_new (GObject *, n);
+      for (i = 0; i < n; i++)
+	closure.objects[i] = g_object_new (G_TYPE_OBJECT, NULL);
+      params = g_strdup_printf ("\"objects\":%u", n);
+      bench_run ("bag-add-find", params, bench_bag, &closure);
+      g_free (params);
+      for (i = 0; i < n; i++)
+	g_object_unref (closure.objects[i]);
+      g_free (closure.objects);
+    }
+}
+
+/* plot rendering {{{1 */
+
+struct plot_closure
+  {
+    cairo_t *cr;
+    PocPlot *plot;
+  };
+
+static void
+bench_plot_render (gpointer data)
+{
+  struct plot_closure *closure = data;
+  GdkRGBA background = { 1.0, 1.0, 1.0, 1.0 };
+  GdkRGBA grid = { 0.5, 0.5, 0.5, 1.0 };
+  GdkRGBA text = { 0.0, 0.0, 0.0, 1.0 };
+
+  poc_plot_render (closure->plot, closure->cr, WIDTH, HEIGHT,
+		   &background, &grid, &text);
+}
+
+static void
+bench_plots (cairo_t *cr)
+{
+  static const guint counts[] = { 1, 10, 100, };
+  PocAxis *x_axis, *y_axis;
+  PocDataset *dataset;
+  struct plot_closure closure;
+  gchar *params;
+  guint i, j, threaded;
+
+  closure.cr = cr;
+  for (i = 0; i < G_N_ELEMENTS (counts); i++)
+    for (threaded = 0; threaded <= 1; threaded++)
+      {
+	closure.plot = g_object_ref_sink (poc_plot_new ());
+	poc_plot_set_threaded_datasets (closure.plot, threaded);
+	x_axis = make_axis (POC_AXIS_LINEAR, 1.0, 10000);
+	y_axis = make_axis (POC_AXIS_LINEAR, -1.5, 1.5);
+	for (j = 0; j < counts[i]; j++)
+	  {
+	    dataset = make_dataset (POC_TYPE_DATASET, 10000, x_axis, y_axis);
+	    poc_dataset_set_decimation (dataset, POC_DECIMATION_MIN_MAX);
+	    poc_plot_add_dataset (closure.plot, dataset,
+				  GTK_PACK_START, GTK_PACK_START);
+	    g_object_unref (dataset);
+	  }
+	params = g_strdup_printf ("\"datasets\":%u,\"points\":%u,"
+				  "\"threaded\":%s", counts[i], 10000,
+				  threaded ? "true" : "false");
+	bench_run ("plot-render", params, bench_plot_render, &closure);
+	g_free (params);
+	g_object_unref (x_axis);
+	g_object_unref (y_axis);
+	gtk_widget_destroy (GTK_WIDGET (closure.plot));
+	g_object_unref (closure.plot);
+      }
+}
+
+/* main {{{1 */
+
+int
+main (int argc, char **argv)
+{
+  gint max = max_points;
+  GOptionEntry entries[] =
+    {
+      { "max-points", 'n', 0, G_OPTION_ARG_INT, &max,
+	"Largest number of points to benchmark", "N" },
+      { "min-time", 't', 0, G_OPTION_ARG_DOUBLE, &min_time,
+	"Minimum time to run each benchmark in seconds", "SECONDS" },
+      { NULL, 0, 0, 0, NULL, NULL, NULL }
+    };
+  GOptionContext *context;
+  GError *error = NULL;
+  cairo_surface_t *surface;
+  cairo_t *cr;
+  gboolean have_gtk;
+
+  context = g_option_context_new ("- benchmark PocPlot");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+  g_option_context_free (context);
+  max_points = MAX (max, 1000);
+
+  /* Plots are widgets and need a display, the remaining benchmarks do not */
+  have_gtk = gtk_init_check (&argc, &argv);
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, WIDTH, HEIGHT);
+  cr = cairo_create (surface);
+
+  bench_datasets (cr);
+  bench_dataset_spline (cr);
+  bench_splines ();
+  bench_bags ();
+  if (have_gtk)
+    bench_plots (cr);
+  else
+    g_printerr ("no display, plot-render benchmarks skipped\n");
+
+  cairo_destroy (cr);
+  cairo_surface_destroy (surface);
+  return 0;
+}
@@ -25,7 +25,10 @@
 #include <pocplot.h>
 #include <pocaxis.h>
 #include <pocdataset.h>
+#include <pocdatasetmapped.h>
+#include <pocdatasetscatter.h>
 #include <pocdatasetspline.h>
+#include <pocdatasetstream.h>
 #include <pocspline.h>
 #include <pocsample.h>
 #include <poclegend.h>
@@ -41,6 +41,15 @@
  * Axes are also responsible from drawing grid lines in the main plot area.
  */
 
+/* A major tick label.  The tick is at index * major_interval in mode
+   coordinates. */
+struct tick_label
+  {
+    gint64		index;
+    gchar		text[32];
+    cairo_text_extents_t extents;
+  };
+
 typedef struct _PocAxisPrivate PocAxisPrivate;
 struct _PocAxisPrivate
   {
@@ -68,6 +77,30 @@ struct _PocAxisPrivate
     gdouble		lower_mode;
     gdouble		upper_mode;
     gdouble		minor_interval;
+
+    /* Displayed range, read from the adjustment on the main thread so that
+       datasets drawn on worker threads need not call GTK */
+    gdouble		lower_display;
+    gdouble		upper_display;
+
+    /* Tick positions in mode coordinates, see poc_axis_update_ticks() */
+    GArray		*major_ticks;
+    GArray		*minor_ticks;
+    gint64		major_first;
+    guint		ticks_pixels;
+    gboolean		ticks_valid;
+    guint		interval_notify_id;
+
+    /* Tick labels and text extents, see poc_axis_get_labels() */
+    GArray		*labels;
+    GArray		*labels_spare;
+    cairo_font_face_t	*label_face;
+    cairo_text_extents_t legend_extents;
+    gboolean		legend_extents_valid;
+
+    /* Deferred updates, see poc_axis_freeze_update() */
+    guint		update_freeze;
+    gboolean		update_pending;
   };
 
 G_DEFINE_TYPE_WITH_PRIVATE (PocAxis, poc_axis, G_TYPE_OBJECT)
@@ -133,6 +166,8 @@ static void poc_axis_get_property (GObject *object, guint param_id,
 static void poc_axis_set_property (GObject *object, guint param_id,
 				     const GValue *value, GParamSpec *pspec);
 static void poc_axis_update_bounds (PocAxis *self);
+static void poc_axis_update_display (PocAxis *self);
+static void poc_axis_invalidate_labels (PocAxis *self);
 
 static void
 poc_axis_class_init (PocAxisClass *class)
@@ -242,6 +277,10 @@ poc_axis_init (PocAxis *self)
   priv->major_grid = POC_LINE_STYLE_SOLID;
   priv->minor_grid = POC_LINE_STYLE_DASH;
   priv->legend_size = 14.0f;
+  priv->major_ticks = g_array_new (FALSE, FALSE, sizeof (gdouble));
+  priv->minor_ticks = g_array_new (FALSE, FALSE, sizeof (gdouble));
+  priv->labels = g_array_new (FALSE, FALSE, sizeof (struct tick_label));
+  priv->labels_spare = g_array_new (FALSE, FALSE, sizeof (struct tick_label));
   poc_axis_update_bounds (self);
 }
 
@@ -265,6 +304,12 @@ poc_axis_finalize (GObject *object)
   PocAxisPrivate *priv = poc_axis_get_instance_private (self);
 
   g_free (priv->legend);
+  g_array_unref (priv->major_ticks);
+  g_array_unref (priv->minor_ticks);
+  g_array_unref (priv->labels);
+  g_array_unref (priv->labels_spare);
+  if (priv->label_face != NULL)
+    cairo_font_face_destroy (priv->label_face);
   G_OBJECT_CLASS (poc_axis_parent_class)->finalize (object);
 }
 
@@ -527,6 +572,8 @@ poc_axis_adj_value_changed (GtkAdjustment *adjustment, PocAxis *self)
   page_size = gtk_adjustment_get_page_size (adjustment);
   priv->lower_mode = value;
   priv->upper_mode = value + page_size;
+  priv->ticks_valid = FALSE;
+  poc_axis_update_display (self);
   poc_axis_notify_update (self);
 }
 
@@ -595,6 +642,7 @@ poc_axis_set_adjustment (PocAxis *self, GtkAdjustment *adjustment)
 				    G_CALLBACK (poc_axis_adj_value_changed),
 				    self, 0);
     }
+  poc_axis_update_display (self);
   g_object_notify_by_pspec (G_OBJECT (self), poc_axis_prop[PROP_ADJUSTMENT]);
 }
 
@@ -667,7 +715,9 @@ poc_axis_get_major_interval (PocAxis *self)
  * @self: A #PocAxis
  * @enabled: enable auto calculation
  *
- * Automatically set major tick interval if @enabled is %TRUE.
+ * Automatically set major tick interval if @enabled is %TRUE.  The interval
+ * is 1, 2 or 5 times a power of ten, chosen so that major ticks are at
+ * least 50 pixels apart along the displayed range.
  */
 void
 poc_axis_set_auto_interval (PocAxis *self, gboolean enabled)
@@ -800,6 +850,7 @@ poc_axis_set_label_size (PocAxis *self, gfloat size)
   g_return_if_fail (POC_IS_AXIS (self));
 
   priv->label_size = size;
+  poc_axis_invalidate_labels (self);
   g_object_notify_by_pspec (G_OBJECT (self), poc_axis_prop[PROP_LABEL_SIZE]);
   poc_axis_notify_update (self);
 }
@@ -846,6 +897,7 @@ poc_axis_set_legend (PocAxis *self, const gchar *legend)
 
   g_free (priv->legend);
   priv->legend = maybe_null (legend);
+  priv->legend_extents_valid = FALSE;
   g_object_notify_by_pspec (G_OBJECT (self), poc_axis_prop[PROP_LEGEND]);
   poc_axis_notify_update (self);
 }
@@ -885,6 +937,7 @@ poc_axis_set_legend_size (PocAxis *self, gfloat size)
   g_return_if_fail (POC_IS_AXIS (self));
 
   priv->legend_size = size;
+  priv->legend_extents_valid = FALSE;
   g_object_notify_by_pspec (G_OBJECT (self), poc_axis_prop[PROP_LEGEND_SIZE]);
   poc_axis_notify_update (self);
 }
@@ -996,8 +1049,58 @@ poc_axis_get_minor_grid (PocAxis *self)
 void
 poc_axis_notify_update (PocAxis *self)
 {
+  PocAxisPrivate *priv = poc_axis_get_instance_private (self);
+
+  g_return_if_fail (POC_IS_AXIS (self));
+
+  if (priv->update_freeze > 0)
+    priv->update_pending = TRUE;
+  else
+    g_signal_emit (self, poc_axis_signals[UPDATE], 0);
+}
+
+/**
+ * poc_axis_freeze_update:
+ * @self: A #PocAxis
+ *
+ * Defer "update" signals and property change notifications until
+ * poc_axis_thaw_update() is called, so that several properties may be
+ * changed at the cost of a single update.  Calls may be nested.
+ */
+void
+poc_axis_freeze_update (PocAxis *self)
+{
+  PocAxisPrivate *priv = poc_axis_get_instance_private (self);
+
+  g_return_if_fail (POC_IS_AXIS (self));
+
+  g_object_freeze_notify (G_OBJECT (self));
+  priv->update_freeze += 1;
+}
+
+/**
+ * poc_axis_thaw_update:
+ * @self: A #PocAxis
+ *
+ * Reverse the effect of a previous call to poc_axis_freeze_update().  When
+ * the last freeze is released a single "update" signal is emitted if any
+ * were deferred.
+ */
+void
+poc_axis_thaw_update (PocAxis *self)
+{
+  PocAxisPrivate *priv = poc_axis_get_instance_private (self);
+
   g_return_if_fail (POC_IS_AXIS (self));
-  g_signal_emit (self, poc_axis_signals[UPDATE], 0);
+  g_return_if_fail (priv->update_freeze > 0);
+
+  priv->update_freeze -= 1;
+  if (priv->update_freeze == 0 && priv->update_pending)
+    {
+      priv->update_pending = FALSE;
+      g_signal_emit (self, poc_axis_signals[UPDATE], 0);
+    }
+  g_object_thaw_notify (G_OBJECT (self));
 }
 
 /* range of axes {{{1 */
@@ -1008,6 +1111,233 @@ poc_axis_notify_update (PocAxis *self)
   lower/upper_mode are computed from lower/upper_display
  */
 
+/* Choose a major interval of 1, 2 or 5 times a power of ten giving as many
+   ticks across the current span as fit with at least MIN_MAJOR_SPACING
+   pixels between them.  If the axis length is not yet known, allow for
+   DEFAULT_MAJOR_TICKS.  Logarithmic axes use whole decades or octaves. */
+
+#define MIN_MAJOR_SPACING	50.0
+#define DEFAULT_MAJOR_TICKS	10.0
+#define MAX_TICKS		10000u
+#define TICK_EPSILON		1e-9
+
+static gdouble
+poc_axis_nice_interval (PocAxis *self, guint pixels)
+{
+  PocAxisPrivate *priv = poc_axis_get_instance_private (self);
+  gdouble span, max_ticks, raw, magnitude, fraction, interval;
+
+  span = priv->upper_mode - priv->lower_mode;
+  if (!(span > 0.0) || !isfinite (span))
+    return 1.0;
+
+  max_ticks = pixels > 0 ? floor (pixels / MIN_MAJOR_SPACING) : DEFAULT_MAJOR_TICKS;
+  if (max_ticks < 1.0)
+    max_ticks = 1.0;
+  raw = span / max_ticks;
+  magnitude = exp10 (floor (log10 (raw)));
+  fraction = raw / magnitude;
+  if (fraction <= 1.0 + TICK_EPSILON)
+    interval = magnitude;
+  else if (fraction <= 2.0 + TICK_EPSILON)
+    interval = 2.0 * magnitude;
+  else if (fraction <= 5.0 + TICK_EPSILON)
+    interval = 5.0 * magnitude;
+  else
+    interval = 10.0 * magnitude;
+
+  if (priv->axis_mode != POC_AXIS_LINEAR && interval < 1.0)
+    interval = 1.0;
+  return interval;
+}
+
+/* log10 (m) for m = 2 .. 9, the minor ticks within a decade */
+static const gdouble decade_minor[] =
+  {
+    0.30102999566398120, 0.47712125471966244, 0.60205999132796240,
+    0.69897000433601886, 0.77815125038364363, 0.84509804001425681,
+    0.90308998699194354, 0.95424250943932487,
+  };
+
+static inline void
+poc_axis_add_tick (GArray *ticks, gdouble lower, gdouble upper, gdouble xy)
+{
+  if (xy >= lower && xy <= upper && ticks->len < MAX_TICKS)
+    g_array_append_val (ticks, xy);
+}
+
+/* The automatic interval changes when ticks are computed while drawing.
+   Notify from an idle callback so that handlers do not run during the draw
+   or on the thread rendering the plot. */
+static gboolean
+poc_axis_interval_notify (gpointer user_data)
+{
+  PocAxis *self = user_data;
+  PocAxisPrivate *priv = poc_axis_get_instance_private (self);
+
+  priv->interval_notify_id = 0;
+  g_object_notify_by_pspec (G_OBJECT (self), poc_axis_prop[PROP_MAJOR_INTERVAL]);
+  return G_SOURCE_REMOVE;
+}
+
+static void
+poc_axis_queue_interval_notify (PocAxis *self)
+{
+  PocAxisPrivate *priv = poc_axis_get_instance_private (self);
+
+  if (priv->interval_notify_id == 0)
+    priv->interval_notify_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+						poc_axis_interval_notify,
+						g_object_ref (self),
+						g_object_unref);
+}
+
+/* Compute the major and minor tick positions, in mode coordinates, for an
+   axis pixels long.  Ticks are computed from integer multiples of the major
+   interval so there is no accumulated rounding error.  The table is reused
+   until the bounds, intervals, display range or axis length change. */
+static void
+poc_axis_update_ticks (PocAxis *self, guint pixels)
+{
+  PocAxisPrivate *priv = poc_axis_get_instance_private (self);
+  gdouble interval, first, last, lower, upper, xy, step;
+  gint64 k, k_first, k_last;
+  guint j;
+
+  if (priv->ticks_valid && priv->ticks_pixels == pixels)
+    return;
+  priv->ticks_valid = TRUE;
+  priv->ticks_pixels = pixels;
+
+  if (priv->auto_interval)
+    {
+      interval = poc_axis_nice_interval (self, pixels);
+      if (interval != priv->major_interval)
+	{
+	  priv->major_interval = interval;
+	  if (priv->minor_divisions != 0)
+	    priv->minor_interval = interval / priv->minor_divisions;
+	  poc_axis_invalidate_labels (self);
+	  poc_axis_queue_interval_notify (self);
+	}
+    }
+
+  g_array_set_size (priv->major_ticks, 0);
+  g_array_set_size (priv->minor_ticks, 0);
+  priv->major_first = 0;
+
+  interval = priv->major_interval;
+  lower = priv->lower_mode;
+  upper = priv->upper_mode;
+  if (!(interval > 0.0) || !isfinite (lower) || !isfinite (upper))
+    return;
+
+  first = ceil (lower / interval - TICK_EPSILON);
+  last = floor (upper / interval + TICK_EPSILON);
+  if (last - first >= MAX_TICKS)
+    last = first + MAX_TICKS - 1;
+  k_first = (gint64) first;
+  k_last = (gint64) last;
+
+  priv->major_first = k_first;
+  for (k = k_first; k <= k_last; k++)
+    {
+      xy = k * interval;
+      g_array_append_val (priv->major_ticks, xy);
+    }
+
+  if (priv->minor_divisions == 0)
+    return;
+
+  /* Minor ticks also fill the partial intervals at either end */
+  lower -= interval * TICK_EPSILON;
+  upper += interval * TICK_EPSILON;
+  step = priv->minor_interval;
+  for (k = k_first - 1; k <= k_last; k++)
+    if (priv->axis_mode == POC_AXIS_LOG_DECADE && interval == 1.0)
+      for (j = 0; j < G_N_ELEMENTS (decade_minor); j++)
+	poc_axis_add_tick (priv->minor_ticks, lower, upper,
+			   k + decade_minor[j]);
+    else
+      for (j = 1; j < priv->minor_divisions; j++)
+	poc_axis_add_tick (priv->minor_ticks, lower, upper,
+			   k * interval + j * step);
+}
+
+static PocDoubleArray *
+poc_axis_ticks_to_array (PocAxis *self, GArray *ticks)
+{
+  PocAxisPrivate *priv = poc_axis_get_instance_private (self);
+  PocDoubleArray *array;
+  gdouble xy;
+  guint i;
+
+  array = poc_double_array_sized_new (ticks->len);
+  poc_double_array_set_size (array, ticks->len);
+  for (i = 0; i < ticks->len; i++)
+    {
+      xy = g_array_index (ticks, gdouble, i);
+      switch (priv->axis_mode)
+	{
+	case POC_AXIS_LOG_OCTAVE:
+	  xy = exp2 (xy);
+	  break;
+	case POC_AXIS_LOG_DECADE:
+	  xy = exp10 (xy);
+	  break;
+	default:
+	  break;
+	}
+      poc_double_array_index (array, i) = xy;
+    }
+  return array;
+}
+
+/**
+ * poc_axis_get_major_ticks:
+ * @self: A #PocAxis
+ * @pixels: length of the axis in pixels, or zero if unknown
+ *
+ * Get the positions of the major ticks within the displayed range of the
+ * axis, as drawn by poc_axis_draw_axis() and poc_axis_draw_grid().  When
+ * #PocAxis:auto-interval is set the major interval is chosen as 1, 2 or 5
+ * times a power of ten such that ticks are separated by a reasonable number
+ * of pixels.
+ *
+ * Returns: (transfer full): A #PocDoubleArray of tick positions in axis units
+ */
+PocDoubleArray *
+poc_axis_get_major_ticks (PocAxis *self, guint pixels)
+{
+  PocAxisPrivate *priv = poc_axis_get_instance_private (self);
+
+  g_return_val_if_fail (POC_IS_AXIS (self), NULL);
+
+  poc_axis_update_ticks (self, pixels);
+  return poc_axis_ticks_to_array (self, priv->major_ticks);
+}
+
+/**
+ * poc_axis_get_minor_ticks:
+ * @self: A #PocAxis
+ * @pixels: length of the axis in pixels, or zero if unknown
+ *
+ * Get the positions of the minor ticks within the displayed range of the
+ * axis.  See poc_axis_get_major_ticks().
+ *
+ * Returns: (transfer full): A #PocDoubleArray of tick positions in axis units
+ */
+PocDoubleArray *
+poc_axis_get_minor_ticks (PocAxis *self, guint pixels)
+{
+  PocAxisPrivate *priv = poc_axis_get_instance_private (self);
+
+  g_return_val_if_fail (POC_IS_AXIS (self), NULL);
+
+  poc_axis_update_ticks (self, pixels);
+  return poc_axis_ticks_to_array (self, priv->minor_ticks);
+}
+
 static void
 poc_axis_update_bounds (PocAxis *self)
 {
@@ -1042,21 +1372,18 @@ poc_axis_update_bounds (PocAxis *self)
 
   if (priv->auto_interval)
     {
-      interval = priv->upper_mode - priv->lower_mode;
-      if (interval >= 10000.0)
-	priv->major_interval = 10000.0;
-      else if (interval >= 1000.0)
-	priv->major_interval = 1000.0;
-      else if (interval >= 100.0)
-	priv->major_interval = 100.0;
-      else if (interval >= 10.0)
-	priv->major_interval = 10.0;
-      else
-	priv->major_interval = 1.0;
-      g_object_notify_by_pspec (G_OBJECT (self), poc_axis_prop[PROP_MAJOR_INTERVAL]);
+      interval = poc_axis_nice_interval (self, priv->ticks_pixels);
+      if (interval != priv->major_interval)
+	{
+	  priv->major_interval = interval;
+	  g_object_notify_by_pspec (G_OBJECT (self), poc_axis_prop[PROP_MAJOR_INTERVAL]);
+	}
     }
   if (priv->minor_divisions != 0)
     priv->minor_interval = priv->major_interval / priv->minor_divisions;
+  priv->ticks_valid = FALSE;
+  poc_axis_invalidate_labels (self);
+  poc_axis_update_display (self);
 }
 
 /* Always uses linear value */
@@ -1122,15 +1449,26 @@ poc_axis_get_range (PocAxis *self, gdouble *lower_bound, gdouble *upper_bound)
  * @upper_bound: axis upper bound
  *
  * Get displayed axis range. This may be less than the full range if scrolling.
+ * The range is updated on the main thread when the bounds or adjustment
+ * change, so it may be read while datasets are drawn on worker threads.
  */
 void
 poc_axis_get_display_range (PocAxis *self, gdouble *lower_bound, gdouble *upper_bound)
 {
   PocAxisPrivate *priv = poc_axis_get_instance_private (self);
-  gdouble value, page_size;
 
   g_return_if_fail (POC_IS_AXIS (self));
 
+  *lower_bound = priv->lower_display;
+  *upper_bound = priv->upper_display;
+}
+
+static void
+poc_axis_update_display (PocAxis *self)
+{
+  PocAxisPrivate *priv = poc_axis_get_instance_private (self);
+  gdouble value, page_size;
+
   if (priv->adjustment != NULL)
     {
       value = gtk_adjustment_get_value (priv->adjustment);
@@ -1138,21 +1476,24 @@ poc_axis_get_display_range (PocAxis *self, gdouble *lower_bound, gdouble *upper_
       switch (priv->axis_mode)
 	{
 	case POC_AXIS_LINEAR:
-	  *lower_bound = value;
-	  *upper_bound = value + page_size;
+	  priv->lower_display = value;
+	  priv->upper_display = value + page_size;
 	  break;
 	case POC_AXIS_LOG_OCTAVE:
-	  *lower_bound = exp2 (value);
-	  *upper_bound = exp2 (value + page_size);
+	  priv->lower_display = exp2 (value);
+	  priv->upper_display = exp2 (value + page_size);
 	  break;
 	case POC_AXIS_LOG_DECADE:
-	  *lower_bound = exp10 (value);
-	  *upper_bound = exp10 (value + page_size);
+	  priv->lower_display = exp10 (value);
+	  priv->upper_display = exp10 (value + page_size);
 	  break;
 	}
     }
   else
-    poc_axis_get_range (self, lower_bound, upper_bound);
+    {
+      priv->lower_display = priv->lower_bound;
+      priv->upper_display = priv->upper_bound;
+    }
 }
 
 /* drawing {{{1 */
@@ -1190,6 +1531,42 @@ poc_axis_project (PocAxis *self, gdouble value, gint norm)
   return poc_axis_linear_project (self, value, norm);
 }
 
+/**
+ * poc_axis_unproject:
+ * @self: A #PocAxis
+ * @position: pixel based position
+ * @norm: normalisation value
+ *
+ * Reverse the projection performed by poc_axis_project(), converting a pixel
+ * based position back to a value interpreted according to the axis mode.
+ * This function is intended for use in hit-testing code.
+ *
+ * Returns: the value at @position
+ */
+double
+poc_axis_unproject (PocAxis *self, gdouble position, gint norm)
+{
+  PocAxisPrivate *priv = poc_axis_get_instance_private (self);
+  gdouble scale, offset, value;
+
+  g_return_val_if_fail (POC_IS_AXIS (self), 0.0);
+
+  poc_axis_get_projection (self, norm, &scale, &offset);
+  value = (position - offset) / scale;
+  switch (priv->axis_mode)
+    {
+    case POC_AXIS_LINEAR:
+      break;
+    case POC_AXIS_LOG_OCTAVE:
+      value = exp2 (value);
+      break;
+    case POC_AXIS_LOG_DECADE:
+      value = exp10 (value);
+      break;
+    }
+  return value;
+}
+
 /**
  * poc_axis_linear_project:
  * @self: A #PocAxis
@@ -1215,6 +1592,174 @@ poc_axis_linear_project (PocAxis *self, gdouble value, gint norm)
     return value * scale;
 }
 
+/**
+ * poc_axis_get_projection:
+ * @self: A #PocAxis
+ * @norm: normalisation value
+ * @scale: (out): return location for the scale factor
+ * @offset: (out): return location for the offset
+ *
+ * Get the coefficients of the linear projection used by
+ * poc_axis_linear_project().  A value, in the units of the axis mode,
+ * projects to `value * scale + offset`.  For logarithmic axes the value must
+ * be transformed with log2() or log10() beforehand as appropriate.
+ */
+void
+poc_axis_get_projection (PocAxis *self, gint norm,
+			 gdouble *scale, gdouble *offset)
+{
+  PocAxisPrivate *priv = poc_axis_get_instance_private (self);
+  double s = (norm < 0 ? -norm : norm) - 1.0;
+  double k;
+
+  g_return_if_fail (POC_IS_AXIS (self));
+
+  k = s / (priv->upper_mode - priv->lower_mode);
+  if (norm < 0)
+    {
+      *scale = -k;
+      *offset = s + priv->lower_mode * k;
+    }
+  else
+    {
+      *scale = k;
+      *offset = -priv->lower_mode * k;
+    }
+}
+
+/**
+ * poc_axis_project_vector:
+ * @self: A #PocAxis
+ * @values: (array length=n): values to project
+ * @stride: distance between successive elements of @values
+ * @out: (array length=n): destination for the projected values
+ * @out_stride: distance between successive elements of @out
+ * @n: number of values to project
+ * @norm: normalisation value
+ *
+ * Project @n values from the dataset to pixel based positions in a single
+ * call, giving the same results as calling poc_axis_project() for each value.
+ * Strides are counted in units of #gdouble so that, for example, the x
+ * coordinates of a #PocPoint array are projected with @values set to
+ * `&points[0].x` and a stride of 2.  @values and @out may be the same
+ * location.
+ *
+ * The projection coefficients are computed once per call and the inner loops
+ * are kept free of branches so that they can be vectorised by the compiler.
+ * This function is intended for use in drawing code in subclasses of
+ * #PocDataset.
+ */
+void
+poc_axis_project_vector (PocAxis *self,
+			 const gdouble *values, gsize stride,
+			 gdouble *out, gsize out_stride,
+			 guint n, gint norm)
+{
+  PocAxisPrivate *priv = poc_axis_get_instance_private (self);
+  gdouble scale, offset;
+  guint i;
+
+  g_return_if_fail (POC_IS_AXIS (self));
+
+  poc_axis_get_projection (self, norm, &scale, &offset);
+  switch (priv->axis_mode)
+    {
+    case POC_AXIS_LINEAR:
+      for (i = 0; i < n; i++)
+	out[i * out_stride] = values[i * stride] * scale + offset;
+      return;
+    case POC_AXIS_LOG_OCTAVE:
+      break;
+    case POC_AXIS_LOG_DECADE:
+      /* log10 (x) == log2 (x) * log10 (2), fold the constant into scale */
+      scale *= G_LN2 / G_LN10;
+      break;
+    }
+
+  /* Keep the log and affine passes separate so each is a simple loop */
+  for (i = 0; i < n; i++)
+    out[i * out_stride] = log2 (values[i * stride]);
+  for (i = 0; i < n; i++)
+    out[i * out_stride] = out[i * out_stride] * scale + offset;
+}
+
+/**
+ * poc_axis_project_values:
+ * @self: A #PocAxis
+ * @vector: A #PocVector holding the values to project
+ * @start: index of the first value to project
+ * @out: (array length=n): destination for the projected values
+ * @out_stride: distance between successive elements of @out
+ * @n: number of values to project
+ * @norm: normalisation value
+ *
+ * Project @n values of @vector starting at @start, as
+ * poc_axis_project_vector(), reading the values in the vector's own format.
+ * Single precision values are converted as they are projected and the
+ * positions of implicit values are computed without reading any data.
+ */
+void
+poc_axis_project_values (PocAxis *self, const PocVector *vector, guint start,
+			 gdouble *out, gsize out_stride, guint n, gint norm)
+{
+  PocAxisPrivate *priv = poc_axis_get_instance_private (self);
+  gdouble scale, offset, base, step;
+  const gfloat *f;
+  gsize stride;
+  guint i;
+
+  g_return_if_fail (POC_IS_AXIS (self));
+  g_return_if_fail (vector != NULL);
+  g_return_if_fail (start + n <= vector->len);
+
+  stride = vector->stride;
+  switch (vector->format)
+    {
+    case POC_VECTOR_DOUBLE:
+      poc_axis_project_vector (self,
+			       (const gdouble *) vector->data + (gsize) start * stride,
+			       stride, out, out_stride, n, norm);
+      return;
+
+    case POC_VECTOR_FLOAT:
+      poc_axis_get_projection (self, norm, &scale, &offset);
+      f = (const gfloat *) vector->data + (gsize) start * stride;
+      switch (priv->axis_mode)
+	{
+	case POC_AXIS_LINEAR:
+	  for (i = 0; i < n; i++)
+	    out[i * out_stride] = f[i * stride] * scale + offset;
+	  return;
+	case POC_AXIS_LOG_OCTAVE:
+	  break;
+	case POC_AXIS_LOG_DECADE:
+	  scale *= G_LN2 / G_LN10;
+	  break;
+	}
+      for (i = 0; i < n; i++)
+	out[i * out_stride] = log2 (f[i * stride]) * scale + offset;
+      return;
+
+    case POC_VECTOR_IMPLICIT:
+      base = vector->start + start * vector->step;
+      step = vector->step;
+      if (priv->axis_mode == POC_AXIS_LINEAR)
+	{
+	  /* Uniformly spaced values project to uniformly spaced positions */
+	  poc_axis_get_projection (self, norm, &scale, &offset);
+	  base = base * scale + offset;
+	  step *= scale;
+	  for (i = 0; i < n; i++)
+	    out[i * out_stride] = base + i * step;
+	  return;
+	}
+      for (i = 0; i < n; i++)
+	out[i * out_stride] = base + i * step;
+      poc_axis_project_vector (self, out, out_stride, out, out_stride, n, norm);
+      return;
+    }
+}
+
 /* Draw grid */
 static inline void
 poc_axis_draw_grid_line (PocAxis *self, cairo_t *cr, GtkOrientation orientation,
@@ -1248,12 +1793,6 @@ void
 poc_axis_draw_grid (PocAxis *self, cairo_t *cr, GtkOrientation orientation,
 		    guint width, guint height, GtkStyleContext *style)
 {
-  PocAxisPrivate *priv = poc_axis_get_instance_private (self);
-  gdouble xy, mxy;
-  gdouble lower_floor;
-  const double *dashes;
-  int num_dashes;
-  const GdkRGBA *major_stroke, *minor_stroke;
   GdkRGBA rgba;
   GtkStateFlags state;
 
@@ -1262,20 +1801,48 @@ poc_axis_draw_grid (PocAxis *self, cairo_t *cr, GtkOrientation orientation,
   gtk_style_context_save (style);
   gtk_style_context_add_class (style, "grid");
   gtk_style_context_get_color (style, state, &rgba);
-  major_stroke = &rgba;
-  minor_stroke = &rgba;
   gtk_style_context_restore (style);
 
+  poc_axis_draw_grid_rgba (self, cr, orientation, width, height, &rgba);
+}
 
-  lower_floor = floor (priv->lower_mode / priv->major_interval) * priv->major_interval;
+/**
+ * poc_axis_draw_grid_rgba:
+ * @self: A #PocAxis
+ * @cr: A #cairo_t
+ * @orientation: A #GtkOrientation
+ * @width: Plot area width
+ * @height: Plot area height
+ * @stroke: Colour for the grid lines
+ *
+ * Draw plot grid lines in main plot area using an explicit colour instead of
+ * a #GtkStyleContext.  This makes no GTK calls and may be used from any
+ * thread provided @self is not used concurrently elsewhere.  Used by
+ * poc_plot_render().
+ */
+void
+poc_axis_draw_grid_rgba (PocAxis *self, cairo_t *cr,
+			 GtkOrientation orientation,
+			 guint width, guint height, const GdkRGBA *stroke)
+{
+  PocAxisPrivate *priv = poc_axis_get_instance_private (self);
+  const double *dashes;
+  int num_dashes;
+  const GdkRGBA *major_stroke, *minor_stroke;
+  guint i;
+
+  major_stroke = stroke;
+  minor_stroke = stroke;
+
+  poc_axis_update_ticks (self, orientation == GTK_ORIENTATION_HORIZONTAL
+			       ? width : height);
 
   cairo_new_path (cr);
 
   /* Draw the major grid */
-  for (xy = lower_floor;
-       xy <= ceil (priv->upper_mode);
-       xy += priv->major_interval)
-    poc_axis_draw_grid_line (self, cr, orientation, width, height, xy);
+  for (i = 0; i < priv->major_ticks->len; i++)
+    poc_axis_draw_grid_line (self, cr, orientation, width, height,
+			     g_array_index (priv->major_ticks, gdouble, i));
   cairo_set_line_width (cr, 1.0);
   dashes = poc_line_style_get_dashes (priv->major_grid, &num_dashes);
   cairo_set_dash (cr, dashes, num_dashes, 0.0);
@@ -1283,19 +1850,11 @@ poc_axis_draw_grid (PocAxis *self, cairo_t *cr, GtkOrientation orientation,
   cairo_stroke (cr);
 
   /* Draw the minor grid */
-  if (priv->minor_divisions != 0)
+  if (priv->minor_ticks->len > 0)
     {
-      for (xy = lower_floor; xy <= priv->upper_mode; xy += priv->major_interval)
-	if (priv->axis_mode == POC_AXIS_LOG_DECADE)
-	  for (mxy = 2.0; mxy < 10.0; mxy += 1.0)
-	    poc_axis_draw_grid_line (self, cr, orientation, width, height,
-				     xy + log10 (mxy));
-	else
-	  for (mxy = priv->minor_interval;
-	       mxy < priv->major_interval;
-	       mxy += priv->minor_interval)
-	    poc_axis_draw_grid_line (self, cr, orientation, width, height,
-				     xy + mxy);
+      for (i = 0; i < priv->minor_ticks->len; i++)
+	poc_axis_draw_grid_line (self, cr, orientation, width, height,
+				 g_array_index (priv->minor_ticks, gdouble, i));
       cairo_set_line_width (cr, 0.5);
       dashes = poc_line_style_get_dashes (priv->minor_grid, &num_dashes);
       cairo_set_dash (cr, dashes, num_dashes, 0.0);
@@ -1332,43 +1891,116 @@ poc_axis_draw_tick (PocAxis *self, cairo_t *cr,
     }
 }
 
+/* tick labels {{{2 */
+
+static void
+poc_axis_invalidate_labels (PocAxis *self)
+{
+  PocAxisPrivate *priv = poc_axis_get_instance_private (self);
+
+  g_array_set_size (priv->labels, 0);
+}
+
+/* Labels and their extents change only with the bounds, major interval,
+   label size or font, so they are retained between redraws.  When scrolling,
+   labels for ticks remaining in view are reused and only those for newly
+   exposed ticks are formatted and measured.  The font size must already be
+   set on cr and poc_axis_update_ticks() called.  Label i is for major
+   tick i. */
+static const struct tick_label *
+poc_axis_get_labels (PocAxis *self, cairo_t *cr, guint *n_labels)
+{
+  PocAxisPrivate *priv = poc_axis_get_instance_private (self);
+  cairo_font_face_t *face;
+  struct tick_label *label;
+  const struct tick_label *old;
+  GArray *array;
+  gdouble xy;
+  gint64 lo, index;
+  guint i, n;
+
+  face = cairo_get_font_face (cr);
+  if (face != priv->label_face)
+    {
+      if (priv->label_face != NULL)
+	cairo_font_face_destroy (priv->label_face);
+      priv->label_face = cairo_font_face_reference (face);
+      g_array_set_size (priv->labels, 0);
+      priv->legend_extents_valid = FALSE;
+    }
+
+  lo = priv->major_first;
+  n = priv->major_ticks->len;
+
+  old = (const struct tick_label *) (gconstpointer) priv->labels->data;
+  if (priv->labels->len == n && (n == 0 || old[0].index == lo))
+    {
+      *n_labels = n;
+      return old;
+    }
+
+  array = priv->labels_spare;
+  g_array_set_size (array, n);
+  for (i = 0; i < n; i++)
+    {
+      label = &g_array_index (array, struct tick_label, i);
+      index = lo + i;
+      if (priv->labels->len > 0 && index >= old[0].index
+	  && index < old[0].index + priv->labels->len)
+	{
+	  *label = old[index - old[0].index];
+	  continue;
+	}
+      label->index = index;
+      xy = index * priv->major_interval;
+      if (priv->axis_mode == POC_AXIS_LOG_DECADE)
+	xy = exp10 (xy);
+      g_snprintf (label->text, sizeof label->text, "%g", xy);
+      cairo_text_extents (cr, label->text, &label->extents);
+    }
+  priv->labels_spare = priv->labels;
+  priv->labels = array;
+
+  *n_labels = n;
+  return (const struct tick_label *) (gconstpointer) array->data;
+}
+
 static inline void
 poc_axis_label_tick (PocAxis *self, cairo_t *cr,
 		     GtkOrientation orientation, GtkPackType pack,
 		     guint width, guint height,
-		     const gchar *label, double xy, double size)
+		     const struct tick_label *label, double xy, double size)
 {
-  cairo_text_extents_t extents;
+  const cairo_text_extents_t *extents = &label->extents;
   double x, y;
 
-  cairo_text_extents (cr, label, &extents);
   switch (orientation)
     {
     case GTK_ORIENTATION_HORIZONTAL:
       x = poc_axis_linear_project (self, xy, width);
       if (x >= width)
 	return;
-      x -= extents.width / 2;
+      x -= extents->width / 2;
       if (pack == GTK_PACK_START)
-	y = size - extents.y_bearing + EXTRA;
+	y = size - extents->y_bearing + EXTRA;
       else
 	y = height - 1 - size - EXTRA;
       if (x < 0)
 	x = 0;
-      else if (x >= width - extents.width)
-	x = width - 1 - extents.width;
+      else if (x >= width - extents->width)
+	x = width - 1 - extents->width;
       break;
     case GTK_ORIENTATION_VERTICAL:
       y = poc_axis_linear_project (self, xy, -height);
       if (y >= height)
 	return;
       if (pack == GTK_PACK_START)
-	x = width - 1 - (size + extents.width) - EXTRA;
+	x = width - 1 - (size + extents->width) - EXTRA;
       else
 	x = size + EXTRA;
-      y -= extents.y_bearing / 2;
-      if (y < -extents.y_bearing)
-	y = -extents.y_bearing;
+      y -= extents->y_bearing / 2;
+      if (y < -extents->y_bearing)
+	y = -extents->y_bearing;
       else if (y >= height)
 	y = height - 1;
       break;
@@ -1376,7 +2008,7 @@ poc_axis_label_tick (PocAxis *self, cairo_t *cr,
       return;
     }
   cairo_move_to (cr, x, y);
-  cairo_show_text (cr, label);
+  cairo_show_text (cr, label->text);
 }
 
 /**
@@ -1396,26 +2028,55 @@ poc_axis_draw_axis (PocAxis *self, cairo_t *cr,
 		    GtkOrientation orientation, GtkPackType pack,
 		    guint width, guint height, GtkStyleContext *style)
 {
-  PocAxisPrivate *priv = poc_axis_get_instance_private (self);
-  gdouble xy, mxy, axy;
-  cairo_text_extents_t extents;
-  gchar buffer[128];
-  gfloat minor, ends;
-  gdouble lower_floor;
-  const GdkRGBA *major_stroke, *minor_stroke, *text_fill;
-  GdkRGBA rgba;
+  GdkRGBA stroke, text;
   GtkStateFlags state;
 
   state = gtk_style_context_get_state (style);
 
   gtk_style_context_save (style);
   gtk_style_context_add_class (style, "grid");
-  gtk_style_context_get_color (style, state, &rgba);
-  major_stroke = &rgba;
-  minor_stroke = &rgba;
+  gtk_style_context_get_color (style, state, &stroke);
   gtk_style_context_restore (style);
 
-  lower_floor = floor (priv->lower_mode / priv->major_interval) * priv->major_interval;
+  gtk_style_context_get_color (style, state, &text);
+
+  poc_axis_draw_axis_rgba (self, cr, orientation, pack, width, height,
+			   &stroke, &text);
+}
+
+/**
+ * poc_axis_draw_axis_rgba:
+ * @self: A #PocAxis
+ * @cr: A #cairo_t
+ * @orientation: A #GtkOrientation
+ * @pack: A #GtkPackType
+ * @width: Axis area width
+ * @height: Axis area height
+ * @stroke: Colour for the axis line, ticks and tick labels
+ * @text: Colour for the axis legend
+ *
+ * Draw the axis using explicit colours instead of a #GtkStyleContext.  This
+ * makes no GTK calls and may be used from any thread provided @self is not
+ * used concurrently elsewhere.  Used by poc_plot_render().
+ */
+void
+poc_axis_draw_axis_rgba (PocAxis *self, cairo_t *cr,
+			 GtkOrientation orientation, GtkPackType pack,
+			 guint width, guint height,
+			 const GdkRGBA *stroke, const GdkRGBA *text)
+{
+  PocAxisPrivate *priv = poc_axis_get_instance_private (self);
+  const cairo_text_extents_t *extents;
+  const struct tick_label *labels;
+  guint i, n_labels;
+  gfloat minor, ends;
+  const GdkRGBA *major_stroke, *minor_stroke, *text_fill;
+
+  major_stroke = stroke;
+  minor_stroke = stroke;
+
+  poc_axis_update_ticks (self, orientation == GTK_ORIENTATION_HORIZONTAL
+			       ? width : height);
 
   cairo_new_path (cr);
 
@@ -1439,30 +2100,22 @@ poc_axis_draw_axis (PocAxis *self, cairo_t *cr,
 	  cairo_rel_line_to (cr, 0, height - 1);
 	  break;
 	}
-      for (xy = lower_floor;
-	   xy <= ceil (priv->upper_mode);
-	   xy += priv->major_interval)
+      for (i = 0; i < priv->major_ticks->len; i++)
 	poc_axis_draw_tick (self, cr, orientation, pack, width, height,
-			    xy, priv->tick_size);
+			    g_array_index (priv->major_ticks, gdouble, i),
+			    priv->tick_size);
       cairo_set_line_width (cr, 1.0);
       gdk_cairo_set_source_rgba (cr, major_stroke);
       cairo_stroke (cr);
 
       /* minor ticks */
-      if (priv->minor_divisions != 0)
+      if (priv->minor_ticks->len > 0)
 	{
 	  minor = priv->tick_size * 0.6f;
-	  for (xy = lower_floor; xy <= priv->upper_mode; xy += priv->major_interval)
-	    if (priv->axis_mode == POC_AXIS_LOG_DECADE)
-	      for (mxy = 2.0; mxy < 10.0; mxy += 1.0)
-		poc_axis_draw_tick (self, cr, orientation, pack, width, height,
-				    xy + log10 (mxy), minor);
-	    else
-	      for (mxy = priv->minor_interval;
-		   mxy < priv->major_interval;
-		   mxy += priv->minor_interval)
-		poc_axis_draw_tick (self, cr, orientation, pack, width, height,
-				    xy + mxy, minor);
+	  for (i = 0; i < priv->minor_ticks->len; i++)
+	    poc_axis_draw_tick (self, cr, orientation, pack, width, height,
+				g_array_index (priv->minor_ticks, gdouble, i),
+				minor);
 	  cairo_set_line_width (cr, 0.5);
 	  gdk_cairo_set_source_rgba (cr, minor_stroke);
 	  cairo_stroke (cr);
@@ -1472,46 +2125,49 @@ poc_axis_draw_axis (PocAxis *self, cairo_t *cr,
   /* Annotate major ticks */
   cairo_set_font_size (cr, priv->label_size);
   gdk_cairo_set_source_rgba (cr, major_stroke);
-  for (xy = lower_floor; xy <= priv->upper_mode; xy += priv->major_interval)
-    {
-      axy = (priv->axis_mode == POC_AXIS_LOG_DECADE) ? exp10 (xy) : xy;
-      g_snprintf (buffer, sizeof buffer, "%g", axy);
-      poc_axis_label_tick (self, cr, orientation, pack, width, height,
-			   buffer, xy, priv->tick_size);
-    }
+  labels = poc_axis_get_labels (self, cr, &n_labels);
+  for (i = 0; i < n_labels; i++)
+    poc_axis_label_tick (self, cr, orientation, pack, width, height,
+			 &labels[i],
+			 g_array_index (priv->major_ticks, gdouble, i),
+			 priv->tick_size);
 
   /* Text */
-  gtk_style_context_get_color (style, state, &rgba);
-  text_fill = &rgba;
+  text_fill = text;
   gdk_cairo_set_source_rgba (cr, text_fill);
 
   /* Legend */
   if (priv->legend != NULL)
     {
       cairo_set_font_size (cr, priv->legend_size);
-      cairo_text_extents (cr, priv->legend, &extents);
+      if (!priv->legend_extents_valid)
+	{
+	  cairo_text_extents (cr, priv->legend, &priv->legend_extents);
+	  priv->legend_extents_valid = TRUE;
+	}
+      extents = &priv->legend_extents;
       cairo_save (cr);
       switch (orientation)
 	{
 	case GTK_ORIENTATION_HORIZONTAL:
 	  if (pack == GTK_PACK_START)
-	    cairo_move_to (cr, (width - extents.width) / 2,
-			       ends - extents.y_bearing);
+	    cairo_move_to (cr, (width - extents->width) / 2,
+			       ends - extents->y_bearing);
 	  else
-	    cairo_move_to (cr, (width - extents.width) / 2,
-			       -extents.y_bearing);
+	    cairo_move_to (cr, (width - extents->width) / 2,
+			       -extents->y_bearing);
 	  break;
 	case GTK_ORIENTATION_VERTICAL:
 	  if (pack == GTK_PACK_START)
 	    {
-	      cairo_move_to (cr, width - (ends - extents.y_bearing),
-				 (height - extents.width) / 2);
+	      cairo_move_to (cr, width - (ends - extents->y_bearing),
+				 (height - extents->width) / 2);
 	      cairo_rotate (cr, G_PI / 2.0);
 	    }
 	  else
 	    {
-	      cairo_move_to (cr, ends - extents.y_bearing,
-				 (height + extents.width) / 2);
+	      cairo_move_to (cr, ends - extents->y_bearing,
+				 (height + extents->width) / 2);
 	      cairo_rotate (cr, -G_PI / 2.0);
 	    }
 	  break;
@@ -71,7 +71,12 @@ const gchar *	poc_axis_get_legend (PocAxis *self);
 void		poc_axis_set_legend_size (PocAxis *self, gfloat size);
 gfloat		poc_axis_get_legend_size (PocAxis *self);
 
+PocDoubleArray *poc_axis_get_major_ticks (PocAxis *self, guint pixels);
+PocDoubleArray *poc_axis_get_minor_ticks (PocAxis *self, guint pixels);
+
 void		poc_axis_notify_update (PocAxis *self);
+void		poc_axis_freeze_update (PocAxis *self);
+void		poc_axis_thaw_update (PocAxis *self);
 void		poc_axis_draw_axis (PocAxis *self, cairo_t *cr,
 				    GtkOrientation orientation,
 				    GtkPackType pack,
@@ -81,6 +86,16 @@ void		poc_axis_draw_grid (PocAxis *self, cairo_t *cr,
 				    GtkOrientation orientation,
 				    guint width, guint height,
 				    GtkStyleContext *style);
+void		poc_axis_draw_axis_rgba (PocAxis *self, cairo_t *cr,
+					 GtkOrientation orientation,
+					 GtkPackType pack,
+					 guint width, guint height,
+					 const GdkRGBA *stroke,
+					 const GdkRGBA *text);
+void		poc_axis_draw_grid_rgba (PocAxis *self, cairo_t *cr,
+					 GtkOrientation orientation,
+					 guint width, guint height,
+					 const GdkRGBA *stroke);
 gdouble		poc_axis_size (PocAxis *self);
 
 /* convenience access to bounds */
@@ -98,6 +113,17 @@ void		poc_axis_get_display_range (PocAxis *self,
 
 double		poc_axis_linear_project (PocAxis *self, gdouble value, gint norm);
 double		poc_axis_project (PocAxis *self, gdouble value, gint norm);
+double		poc_axis_unproject (PocAxis *self, gdouble position, gint norm);
+void		poc_axis_get_projection (PocAxis *self, gint norm,
+					 gdouble *scale, gdouble *offset);
+void		poc_axis_project_vector (PocAxis *self,
+					 const gdouble *values, gsize stride,
+					 gdouble *out, gsize out_stride,
+					 guint n, gint norm);
+void		poc_axis_project_values (PocAxis *self,
+					 const PocVector *vector, guint start,
+					 gdouble *out, gsize out_stride,
+					 guint n, gint norm);
 
 G_END_DECLS
 
@@ -18,6 +18,10 @@
  */
 #include "pocbag.h"
 
+/* Items are kept in insertion order in a queue and indexed by object in a
+   hash table mapping to the item's queue link, so lookup, addition and
+   removal take constant time while iteration preserves order. */
+
 struct PocBagItem
   {
     GObject *object;
@@ -26,17 +30,12 @@ struct PocBagItem
     GDestroyNotify destroy;
   };
 
-#if 0
-static struct PocBagItem *
-poc_bag_item_new (void)
-{
-  struct PocBagItem *item;
-
-  item = g_slice_new0 (struct PocBagItem);
-  item->count = 1;
-  return item;
-}
-#endif
+struct _PocObjectBag
+  {
+    gint ref_count;
+    GQueue items;
+    GHashTable *index;
+  };
 
 /**
  * poc_bag_item_destroy: (skip)
@@ -49,6 +48,7 @@ poc_bag_item_destroy (gpointer data)
   g_object_unref (item->object);
   if (item->destroy != NULL)
     (*item->destroy) (item->data);
+  g_slice_free (struct PocBagItem, item);
 }
 
 /**
@@ -57,11 +57,13 @@ poc_bag_item_destroy (gpointer data)
 PocObjectBag *
 poc_object_bag_new (void)
 {
-  GArray *array;
+  PocObjectBag *bag;
 
-  array = g_array_new (FALSE, TRUE, sizeof (struct PocBagItem));
-  g_array_set_clear_func (array, poc_bag_item_destroy);
-  return (PocObjectBag *) array;
+  bag = g_slice_new (PocObjectBag);
+  bag->ref_count = 1;
+  g_queue_init (&bag->items);
+  bag->index = g_hash_table_new (g_direct_hash, g_direct_equal);
+  return bag;
 }
 
 /**
@@ -70,7 +72,8 @@ poc_object_bag_new (void)
 PocObjectBag *
 poc_object_bag_ref (PocObjectBag *bag)
 {
-  return (PocObjectBag *) g_array_ref ((GArray *) bag);
+  g_atomic_int_inc (&bag->ref_count);
+  return bag;
 }
 
 /**
@@ -79,24 +82,18 @@ poc_object_bag_ref (PocObjectBag *bag)
 void
 poc_object_bag_unref (PocObjectBag *bag)
 {
-  g_array_unref ((GArray *) bag);
+  if (g_atomic_int_dec_and_test (&bag->ref_count))
+    {
+      poc_object_bag_empty (bag);
+      g_hash_table_unref (bag->index);
+      g_slice_free (PocObjectBag, bag);
+    }
 }
 
-static inline gboolean
-poc_object_bag_find_object (PocObjectBag *bag, GObject *object, guint *ret)
+static inline GList *
+poc_object_bag_find_object (PocObjectBag *bag, GObject *object)
 {
-  GArray *array = (GArray *) bag;
-  struct PocBagItem *item;
-  guint i;
-
-  item = (struct PocBagItem *) array->data;
-  for (i = 0; i < array->len; i++)
-    if (item[i].object == object)
-      {
-        *ret = i;
-	return TRUE;
-      }
-  return FALSE;
+  return g_hash_table_lookup (bag->index, object);
 }
 
 /* TRUE if object was already in the bag */
@@ -106,22 +103,23 @@ poc_object_bag_find_object (PocObjectBag *bag, GObject *object, guint *ret)
 gboolean
 poc_object_bag_add (PocObjectBag *bag, GObject *object)
 {
-  GArray *array = (GArray *) bag;
-  struct PocBagItem *item, new_item;
-  guint i;
+  struct PocBagItem *item;
+  GList *link;
 
-  if (poc_object_bag_find_object (bag, object, &i))
+  if ((link = poc_object_bag_find_object (bag, object)) != NULL)
     {
-      item = &g_array_index (array, struct PocBagItem, i);
+      item = link->data;
       item->count += 1;
       return TRUE;
     }
 
-  new_item.object = g_object_ref (object);
-  new_item.count = 1;
-  new_item.data = NULL;
-  new_item.destroy = NULL;
-  g_array_append_val (array, new_item);
+  item = g_slice_new (struct PocBagItem);
+  item->object = g_object_ref (object);
+  item->count = 1;
+  item->data = NULL;
+  item->destroy = NULL;
+  g_queue_push_tail (&bag->items, item);
+  g_hash_table_insert (bag->index, object, g_queue_peek_tail_link (&bag->items));
   return FALSE;
 }
 
@@ -131,9 +129,11 @@ poc_object_bag_add (PocObjectBag *bag, GObject *object)
 void
 poc_object_bag_empty (PocObjectBag *bag)
 {
-  GArray *array = (GArray *) bag;
+  struct PocBagItem *item;
 
-  g_array_set_size (array, 0);
+  g_hash_table_remove_all (bag->index);
+  while ((item = g_queue_pop_head (&bag->items)) != NULL)
+    poc_bag_item_destroy (item);
 }
 
 /* TRUE if object was removed from the bag */
@@ -143,16 +143,17 @@ poc_object_bag_empty (PocObjectBag *bag)
 gboolean
 poc_object_bag_remove (PocObjectBag *bag, GObject *object)
 {
-  GArray *array = (GArray *) bag;
   struct PocBagItem *item;
-  guint i;
+  GList *link;
 
-  if (poc_object_bag_find_object (bag, object, &i))
+  if ((link = poc_object_bag_find_object (bag, object)) != NULL)
     {
-      item = &g_array_index (array, struct PocBagItem, i);
+      item = link->data;
       if ((item->count -= 1) <= 0)
 	{
-	  g_array_remove_index (array, i);
+	  g_hash_table_remove (bag->index, object);
+	  g_queue_delete_link (&bag->items, link);
+	  poc_bag_item_destroy (item);
 	  return TRUE;
 	}
     }
@@ -166,13 +167,12 @@ gboolean
 poc_object_bag_set_data_full (PocObjectBag *bag, GObject *object,
 			      gpointer data, GDestroyNotify destroy)
 {
-  GArray *array = (GArray *) bag;
   struct PocBagItem *item;
-  guint i;
+  GList *link;
 
-  if (poc_object_bag_find_object (bag, object, &i))
+  if ((link = poc_object_bag_find_object (bag, object)) != NULL)
     {
-      item = &g_array_index (array, struct PocBagItem, i);
+      item = link->data;
       if (item->destroy != NULL)
 	(*item->destroy) (item->data);
       item->data = data;
@@ -188,13 +188,12 @@ poc_object_bag_set_data_full (PocObjectBag *bag, GObject *object,
 gpointer
 poc_object_bag_get_data (PocObjectBag *bag, GObject *object)
 {
-  GArray *array = (GArray *) bag;
   struct PocBagItem *item;
-  guint i;
+  GList *link;
 
-  if (poc_object_bag_find_object (bag, object, &i))
+  if ((link = poc_object_bag_find_object (bag, object)) != NULL)
     {
-      item = &g_array_index (array, struct PocBagItem, i);
+      item = link->data;
       return item->data;
     }
   return NULL;
@@ -207,9 +206,7 @@ poc_object_bag_get_data (PocObjectBag *bag, GObject *object)
 gboolean
 poc_object_bag_contains (PocObjectBag *bag, GObject *object)
 {
-  guint i;
-
-  return poc_object_bag_find_object (bag, object, &i);
+  return poc_object_bag_find_object (bag, object) != NULL;
 }
 
 /**
@@ -218,14 +215,15 @@ poc_object_bag_contains (PocObjectBag *bag, GObject *object)
 GObject *
 poc_object_bag_find (PocObjectBag *bag, GHRFunc predicate, gpointer user_data)
 {
-  GArray *array = (GArray *) bag;
   struct PocBagItem *item;
-  guint i;
+  GList *link;
 
-  item = (struct PocBagItem *) array->data;
-  for (i = 0; i < array->len; i++)
-    if ((*predicate) (item[i].object, item[i].data, user_data))
-      return item[i].object;
+  for (link = bag->items.head; link != NULL; link = link->next)
+    {
+      item = link->data;
+      if ((*predicate) (item->object, item->data, user_data))
+	return item->object;
+    }
   return NULL;
 }
 
@@ -235,12 +233,23 @@ poc_object_bag_find (PocObjectBag *bag, GHRFunc predicate, gpointer user_data)
 void
 poc_object_bag_foreach (PocObjectBag *bag, GHFunc func, gpointer user_data)
 {
-  GArray *array = (GArray *) bag;
   struct PocBagItem *item;
-  guint i;
+  GList *link, *next;
 
-  item = (struct PocBagItem *) array->data;
-  for (i = 0; i < array->len; i++)
-    (*func) (item[i].object, item[i].data, user_data);
+  /* Fetch the next link first so that func may remove the current item */
+  for (link = bag->items.head; link != NULL; link = next)
+    {
+      next = link->next;
+      item = link->data;
+      (*func) (item->object, item->data, user_data);
+    }
 }
 
+/**
+ * poc_object_bag_get_length: (skip)
+ */
+guint
+poc_object_bag_get_length (PocObjectBag *bag)
+{
+  return bag->items.length;
+}
@@ -45,6 +45,7 @@ GObject *	poc_object_bag_find	(PocObjectBag *bag,
 					 GHRFunc predicate, gpointer user_data);
 void		poc_object_bag_foreach	(PocObjectBag *bag,
 					 GHFunc func, gpointer user_data);
+guint		poc_object_bag_get_length (PocObjectBag *bag);
 
 G_END_DECLS
 
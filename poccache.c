@@ -0,0 +1,162 @@
+/* This file is part of PocPlot.
+ *
+ * PocPlot is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * PocPlot is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with PocPlot; if not, see
+ * <https://www.gnu.org/licenses/>.
+ *
+ * Copyright 2020 Brian Stafford
+ */
+#include "poccache.h"
+#include <string.h>
+
+/* Render results shared by every plot drawing a dataset.  A dataset added
+   to several plots is drawn at each plot's size; caching a few results,
+   each keyed by the axis state and pixel size it was computed for, lets
+   linked views reuse each other's work instead of recomputing it on every
+   alternating draw.  The tag distinguishes the kinds of result cached by
+   different drawing methods.
+
+   Entries are kept in order of use and the least recently used is evicted
+   when the cache is full.  The cache is accessed only while drawing, and
+   data returned by poc_cache_lookup() remains valid until the next insert
+   or clear. */
+
+#define CACHE_SIZE	4
+
+struct entry
+  {
+    PocCacheKey		key;
+    gpointer		data;
+    GDestroyNotify	destroy;
+  };
+
+struct _PocCache
+  {
+    struct entry	entries[CACHE_SIZE];
+    guint		n_entries;
+  };
+
+void
+poc_cache_key_init (PocCacheKey *key, gconstpointer tag,
+		    PocAxis *x_axis, PocAxis *y_axis,
+		    guint width, guint height)
+{
+  memset (key, 0, sizeof (PocCacheKey));
+  key->tag = tag;
+  key->width = width;
+  key->height = height;
+  if (x_axis != NULL)
+    {
+      key->x_mode = poc_axis_get_axis_mode (x_axis);
+      poc_axis_get_display_range (x_axis, &key->x_lower, &key->x_upper);
+    }
+  if (y_axis != NULL)
+    {
+      key->y_mode = poc_axis_get_axis_mode (y_axis);
+      poc_axis_get_display_range (y_axis, &key->y_lower, &key->y_upper);
+    }
+}
+
+gboolean
+poc_cache_key_equal (const PocCacheKey *a, const PocCacheKey *b)
+{
+  return a->tag == b->tag
+	 && a->width == b->width && a->height == b->height
+	 && a->x_mode == b->x_mode && a->y_mode == b->y_mode
+	 && a->x_lower == b->x_lower && a->x_upper == b->x_upper
+	 && a->y_lower == b->y_lower && a->y_upper == b->y_upper;
+}
+
+PocCache *
+poc_cache_new (void)
+{
+  return g_new0 (PocCache, 1);
+}
+
+void
+poc_cache_free (PocCache *cache)
+{
+  poc_cache_clear (cache);
+  g_free (cache);
+}
+
+static void
+cache_entry_clear (struct entry *entry)
+{
+  if (entry->destroy != NULL)
+    (*entry->destroy) (entry->data);
+  entry->data = NULL;
+  entry->destroy = NULL;
+}
+
+void
+poc_cache_clear (PocCache *cache)
+{
+  guint i;
+
+  for (i = 0; i < cache->n_entries; i++)
+    cache_entry_clear (&cache->entries[i]);
+  cache->n_entries = 0;
+}
+
+/* Move entry i to the front, returning it */
+static struct entry *
+cache_touch (PocCache *cache, guint i)
+{
+  struct entry entry;
+
+  if (i > 0)
+    {
+      entry = cache->entries[i];
+      memmove (&cache->entries[1], &cache->entries[0],
+	       i * sizeof (struct entry));
+      cache->entries[0] = entry;
+    }
+  return &cache->entries[0];
+}
+
+gpointer
+poc_cache_lookup (PocCache *cache, const PocCacheKey *key)
+{
+  guint i;
+
+  for (i = 0; i < cache->n_entries; i++)
+    if (poc_cache_key_equal (&cache->entries[i].key, key))
+      return cache_touch (cache, i)->data;
+  return NULL;
+}
+
+void
+poc_cache_insert (PocCache *cache, const PocCacheKey *key,
+		  gpointer data, GDestroyNotify destroy)
+{
+  struct entry *entry;
+  guint i;
+
+  for (i = 0; i < cache->n_entries; i++)
+    if (poc_cache_key_equal (&cache->entries[i].key, key))
+      break;
+  if (i == cache->n_entries)
+    {
+      if (cache->n_entries < CACHE_SIZE)
+	cache->n_entries += 1;
+      i = cache->n_entries - 1;
+    }
+
+  /* Replaces an entry for the same key or evicts the least recently used */
+  entry = cache_touch (cache, i);
+  cache_entry_clear (entry);
+  entry->key = *key;
+  entry->data = data;
+  entry->destroy = destroy;
+}
@@ -0,0 +1,66 @@
+/* This file is part of PocPlot.
+ *
+ * PocPlot is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * PocPlot is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with PocPlot; if not, see
+ * <https://www.gnu.org/licenses/>.
+ *
+ * Copyright 2020 Brian Stafford
+ */
+#ifndef _poccache_h
+#define _poccache_h
+
+#if !defined(__poc_h_inside__) && !defined(__poc_compile__)
+# error "only <poc.h> can be included directly"
+#endif
+
+#include "pocdataset.h"
+
+G_BEGIN_DECLS
+
+typedef struct _PocCacheKey PocCacheKey;
+struct _PocCacheKey
+  {
+    gconstpointer	tag;
+    guint		width;
+    guint		height;
+    PocAxisMode		x_mode;
+    PocAxisMode		y_mode;
+    gdouble		x_lower;
+    gdouble		x_upper;
+    gdouble		y_lower;
+    gdouble		y_upper;
+  };
+
+typedef struct _PocCache PocCache;
+
+void		poc_cache_key_init	(PocCacheKey *key, gconstpointer tag,
+					 PocAxis *x_axis, PocAxis *y_axis,
+					 guint width, guint height);
+gboolean	poc_cache_key_equal	(const PocCacheKey *a,
+					 const PocCacheKey *b);
+
+PocCache *	poc_cache_new		(void);
+void		poc_cache_free		(PocCache *cache);
+void		poc_cache_clear		(PocCache *cache);
+gpointer	poc_cache_lookup	(PocCache *cache,
+					 const PocCacheKey *key);
+void		poc_cache_insert	(PocCache *cache,
+					 const PocCacheKey *key,
+					 gpointer data, GDestroyNotify destroy);
+
+/* Defined in pocdataset.c */
+PocCache *	poc_dataset_get_cache	(PocDataset *self);
+
+G_END_DECLS
+
+#endif
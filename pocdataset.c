@@ -18,6 +18,10 @@
  */
 #include "pocdataset.h"
 #include "pocplot.h"
+#include "poclod.h"
+#include "pocindex.h"
+#include "poccache.h"
+#include <math.h>
 
 /**
  * SECTION: pocdataset
@@ -48,6 +52,40 @@ struct _PocDatasetPrivate
     PocLineStyle	line_style;
     PocAxis		*x_axis;
     PocAxis		*y_axis;
+    PocDecimation	decimation;
+    gboolean		sorted_x;
+    PocVector		*x_vector;
+    PocVector		*y_vector;
+    PocLod		*lod;
+    gboolean		lod_valid;
+
+    /* Path through the points in a normalised data space, see
+       poc_dataset_draw_cached() */
+    cairo_path_t	*data_path;
+    guint		data_path_points;
+    gdouble		data_origin_x;
+    gdouble		data_origin_y;
+    gdouble		data_scale_x;
+    gdouble		data_scale_y;
+
+    /* Spatial index for unsorted points, see poc_dataset_nearest_point() */
+    PocIndex		*index;
+
+    /* Results shared by the plots drawing the dataset, see poccache.c */
+    PocCache		*cache;
+
+    /* Deferred updates, see poc_dataset_freeze_update() */
+    guint		update_freeze;
+    gboolean		update_pending;
+    gboolean		invalidate_pending;
+    /* Points below this index are unchanged by the pending invalidation,
+       having only been appended to */
+    guint		invalid_from;
+
+    /* Accumulated since last taken, see poc_dataset_take_draw_stats() */
+    gint64		draw_time;
+    guint		draw_points;
+    guint		draw_segments;
   };
 
 G_DEFINE_TYPE_WITH_PRIVATE (PocDataset, poc_dataset, G_TYPE_OBJECT)
@@ -81,6 +119,9 @@ enum
     PROP_X_AXIS,
     PROP_Y_AXIS,
 
+    PROP_DECIMATION,
+    PROP_SORTED_X,
+
     N_PROPERTIES
   };
 static GParamSpec *poc_dataset_prop[N_PROPERTIES];
@@ -101,6 +142,11 @@ static void poc_dataset_set_property (GObject *object, guint param_id,
 static void poc_dataset_draw_real (PocDataset *self, cairo_t *cr,
 		       		   guint width, guint height);
 static void poc_dataset_invalidate_real (PocDataset *self);
+static void poc_dataset_invalidate_from (PocDataset *self, guint start);
+static void poc_dataset_draw_view (PocDataset *self, cairo_t *cr,
+				   const PocVector *x, const PocVector *y,
+				   guint start, guint n,
+				   guint width, guint height);
 
 static void
 poc_dataset_class_init (PocDatasetClass *class)
@@ -155,6 +201,16 @@ poc_dataset_class_init (PocDatasetClass *class)
 	POC_TYPE_AXIS,
 	G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  poc_dataset_prop[PROP_DECIMATION] = g_param_spec_enum (
+        "decimation", "Decimation",
+        "Reduce the number of points drawn for dense datasets",
+        POC_TYPE_DECIMATION, POC_DECIMATION_NONE,
+        G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+  poc_dataset_prop[PROP_SORTED_X] = g_param_spec_boolean (
+	"sorted-x", "Sorted X", "X coordinates are in non-decreasing order",
+	FALSE,
+	G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, N_PROPERTIES, poc_dataset_prop);
 
   poc_dataset_signals[UPDATE] = g_signal_new (
@@ -174,6 +230,7 @@ poc_dataset_init (PocDataset *self)
 
   priv->line_stroke = white;
   priv->line_style = POC_LINE_STYLE_SOLID;
+  priv->decimation = POC_DECIMATION_NONE;
 }
 
 static void
@@ -196,6 +253,18 @@ poc_dataset_finalize (GObject *object)
 
   if (priv->points != NULL)
     poc_point_array_unref (priv->points);
+  if (priv->x_vector != NULL)
+    poc_vector_unref (priv->x_vector);
+  if (priv->y_vector != NULL)
+    poc_vector_unref (priv->y_vector);
+  if (priv->lod != NULL)
+    poc_lod_free (priv->lod);
+  if (priv->data_path != NULL)
+    cairo_path_destroy (priv->data_path);
+  if (priv->index != NULL)
+    poc_index_free (priv->index);
+  if (priv->cache != NULL)
+    poc_cache_free (priv->cache);
   g_free (priv->nickname);
   g_free (priv->legend);
   G_OBJECT_CLASS (poc_dataset_parent_class)->finalize (object);
@@ -232,6 +301,13 @@ poc_dataset_set_property (GObject *object, guint prop_id,
     case PROP_Y_AXIS:
       poc_dataset_set_y_axis (self, g_value_get_object (value));
       break;
+
+    case PROP_DECIMATION:
+      poc_dataset_set_decimation (self, g_value_get_enum (value));
+      break;
+    case PROP_SORTED_X:
+      poc_dataset_set_sorted_x (self, g_value_get_boolean (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       return;
@@ -271,6 +347,13 @@ poc_dataset_get_property (GObject *object, guint prop_id,
     case PROP_Y_AXIS:
       g_value_set_object (value, poc_dataset_get_y_axis (self));
       break;
+
+    case PROP_DECIMATION:
+      g_value_set_enum (value, poc_dataset_get_decimation (self));
+      break;
+    case PROP_SORTED_X:
+      g_value_set_boolean (value, poc_dataset_get_sorted_x (self));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -518,8 +601,136 @@ poc_dataset_get_y_axis (PocDataset *self)
   return priv->y_axis;
 }
 
+/* "decimation" {{{2 */
+
+/**
+ * poc_dataset_set_decimation:
+ * @self: A #PocDataset
+ * @decimation: A #PocDecimation
+ *
+ * Set how the dataset reduces the number of points drawn.  With
+ * %POC_DECIMATION_MIN_MAX only the first, last, minimum and maximum points
+ * falling within each pixel column are drawn, so the cost of stroking the
+ * plot line depends on the plot width rather than the number of points while
+ * the result looks the same as the full trace.
+ *
+ * %POC_DECIMATION_PYRAMID additionally maintains an index of minimum and
+ * maximum values over blocks of points at power-of-two sizes.  When drawing,
+ * the coarsest level giving at least two points per pixel across the visible
+ * range is used, so the cost of a redraw depends on the plot width and not on
+ * the number of points or the zoom level.  The index is built when the
+ * dataset is first drawn after its points change and is extended
+ * incrementally by poc_dataset_append_points().  It requires the X
+ * coordinates to be non-decreasing.
+ */
+void
+poc_dataset_set_decimation (PocDataset *self, PocDecimation decimation)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+
+  g_return_if_fail (POC_IS_DATASET (self));
+
+  if (priv->decimation != decimation)
+    {
+      priv->decimation = decimation;
+      if (decimation != POC_DECIMATION_PYRAMID && priv->lod != NULL)
+	{
+	  poc_lod_free (priv->lod);
+	  priv->lod = NULL;
+	}
+      poc_dataset_notify_update (self);
+      g_object_notify_by_pspec (G_OBJECT (self), poc_dataset_prop[PROP_DECIMATION]);
+    }
+}
+
+/**
+ * poc_dataset_get_decimation:
+ * @self: A #PocDataset
+ *
+ * Get the dataset's decimation mode.
+ *
+ * Returns: a #PocDecimation
+ */
+PocDecimation
+poc_dataset_get_decimation (PocDataset *self)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+
+  g_return_val_if_fail (POC_IS_DATASET (self), POC_DECIMATION_NONE);
+
+  return priv->decimation;
+}
+
+/* "sorted-x" {{{2 */
+
+/**
+ * poc_dataset_set_sorted_x:
+ * @self: A #PocDataset
+ * @sorted_x: %TRUE if the X coordinates are in non-decreasing order
+ *
+ * Declare that the dataset's X coordinates are in non-decreasing order.
+ * When set, drawing locates the display range of the X axis by binary search
+ * and visits only the points within it plus one either side, so when
+ * scrolling through a long dataset the cost of a redraw depends on the
+ * number of visible points.  If the points are not in fact sorted, parts of
+ * the line may be missing.
+ */
+void
+poc_dataset_set_sorted_x (PocDataset *self, gboolean sorted_x)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+
+  g_return_if_fail (POC_IS_DATASET (self));
+
+  sorted_x = !!sorted_x;
+  if (priv->sorted_x != sorted_x)
+    {
+      priv->sorted_x = sorted_x;
+      /* Cached paths depend on how the visible points were found */
+      if (priv->cache != NULL)
+	poc_cache_clear (priv->cache);
+      poc_dataset_notify_update (self);
+      g_object_notify_by_pspec (G_OBJECT (self), poc_dataset_prop[PROP_SORTED_X]);
+    }
+}
+
+/**
+ * poc_dataset_get_sorted_x:
+ * @self: A #PocDataset
+ *
+ * Get whether the dataset's X coordinates are declared to be sorted.
+ *
+ * Returns: %TRUE if the X coordinates are sorted
+ */
+gboolean
+poc_dataset_get_sorted_x (PocDataset *self)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+
+  g_return_val_if_fail (POC_IS_DATASET (self), FALSE);
+
+  return priv->sorted_x;
+}
+
 /* points {{{2 */
 
+static void
+poc_dataset_clear_vectors (PocDataset *self)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+
+  if (priv->x_vector != NULL)
+    {
+      poc_vector_unref (priv->x_vector);
+      priv->x_vector = NULL;
+    }
+  if (priv->y_vector != NULL)
+    {
+      poc_vector_unref (priv->y_vector);
+      priv->y_vector = NULL;
+    }
+}
+
 /**
  * poc_dataset_set_points:
  * @self: A #PocDataset
@@ -539,6 +750,7 @@ poc_dataset_set_points (PocDataset *self, PocPointArray *points)
   priv->points = points != NULL ? poc_point_array_ref (points) : NULL;
   if (old != NULL)
     poc_point_array_unref (old);
+  poc_dataset_clear_vectors (self);
   poc_dataset_invalidate (self);
   poc_dataset_notify_update (self);
   g_object_notify_by_pspec (G_OBJECT (self), poc_dataset_prop[PROP_POINTS]);
@@ -570,113 +782,1393 @@ poc_dataset_get_points (PocDataset *self)
  * @points: number of points in coordinate arrays
  *
  * Set the array of control points for the dataset. X and Y coordinates
- * for each control point are specified in two arrays.
+ * for each control point are specified in two arrays which are copied.  Use
+ * poc_dataset_set_vectors() to plot existing arrays without copying.
  */
 void
 poc_dataset_set_points_array (PocDataset *self,
 			      const gdouble *x, const gdouble *y, guint points)
 {
-  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
-  PocPoint p;
+  PocPointArray *array;
   guint i;
 
   g_return_if_fail (POC_IS_DATASET (self));
 
-  priv->points = poc_point_array_sized_new (points);
+  array = poc_point_array_sized_new (points);
+  poc_point_array_set_size (array, points);
   for (i = 0; i < points; i++)
     {
-      p.x = x[i];
-      p.y = y[i];
-      poc_point_array_append_val (priv->points, p);
+      array->data[i].x = x[i];
+      array->data[i].y = y[i];
     }
+  poc_dataset_set_points (self, array);
+  poc_point_array_unref (array);
 }
 
-/* virtual/private methods {{{1 */
-
+/**
+ * poc_dataset_append_points:
+ * @self: A #PocDataset
+ * @points: (array length=n): points to append
+ * @n: number of points
+ *
+ * Append points to the dataset's #PocDataset:points array, creating it if
+ * necessary.  The shared #PocPointArray is modified in place, so the
+ * appended points are also seen by every other holder of a reference to it,
+ * for instance another dataset given the same array, which is not notified
+ * of the change.  Unlike replacing the points, appending extends the
+ * %POC_DECIMATION_PYRAMID index incrementally, including when several
+ * appends are collected by poc_dataset_freeze_update().  The dataset must
+ * not be using vectors set with poc_dataset_set_vectors().
+ */
 void
-poc_dataset_notify_update (PocDataset *self)
+poc_dataset_append_points (PocDataset *self, const PocPoint *points, guint n)
 {
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+  guint start;
+
   g_return_if_fail (POC_IS_DATASET (self));
-  g_signal_emit (self, poc_dataset_signals[UPDATE], 0);
+  g_return_if_fail (points != NULL || n == 0);
+  g_return_if_fail (priv->x_vector == NULL);
+
+  if (n == 0)
+    return;
+
+  if (priv->points == NULL)
+    priv->points = poc_point_array_sized_new (n);
+  start = poc_point_array_len (priv->points);
+  poc_point_array_append_vals (priv->points, points, n);
+
+  /* Summaries of the existing points are still valid */
+  poc_dataset_invalidate_from (self, start);
+
+  poc_dataset_notify_update (self);
+  g_object_notify_by_pspec (G_OBJECT (self), poc_dataset_prop[PROP_POINTS]);
 }
 
+/* vectors {{{2 */
+
 /**
- * poc_dataset_invalidate:
+ * poc_dataset_set_vectors:
  * @self: A #PocDataset
+ * @x: (nullable): A #PocVector of x coordinates
+ * @y: (nullable): A #PocVector of y coordinates
  *
- * Notify subclasses cached data is invalid.
+ * Set the dataset's control points from separate vectors of X and Y
+ * coordinates.  The data are not copied; the dataset holds a reference to
+ * each vector and reads through it whenever the dataset is drawn.  If the
+ * vectors differ in length the excess values in the longer are ignored.
+ * Any #PocDataset:points array is released.
+ *
+ * If the data viewed by the vectors is modified, call
+ * poc_dataset_invalidate() and poc_dataset_notify_update().
  */
 void
-poc_dataset_invalidate (PocDataset *self)
+poc_dataset_set_vectors (PocDataset *self, PocVector *x, PocVector *y)
 {
-  PocDatasetClass *class;
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+  gboolean had_points;
 
   g_return_if_fail (POC_IS_DATASET (self));
-
-  class = POC_DATASET_GET_CLASS (self);
-  g_return_if_fail (class->invalidate != NULL);
-  (*class->invalidate) (self);
+  g_return_if_fail ((x == NULL) == (y == NULL));
+
+  if (x != NULL)
+    poc_vector_ref (x);
+  if (y != NULL)
+    poc_vector_ref (y);
+  poc_dataset_clear_vectors (self);
+  priv->x_vector = x;
+  priv->y_vector = y;
+
+  had_points = priv->points != NULL;
+  if (had_points)
+    {
+      poc_point_array_unref (priv->points);
+      priv->points = NULL;
+    }
+  poc_dataset_invalidate (self);
+  poc_dataset_notify_update (self);
+  if (had_points)
+    g_object_notify_by_pspec (G_OBJECT (self), poc_dataset_prop[PROP_POINTS]);
 }
 
 static void
-poc_dataset_invalidate_real (G_GNUC_UNUSED PocDataset *self)
+poc_dataset_float_array_unref (gpointer data)
 {
+  poc_float_array_unref (data);
 }
 
 /**
- * poc_dataset_draw:
+ * poc_dataset_set_float_points:
  * @self: A #PocDataset
- * @cr: A #cairo_t
- * @width: Plot area width
- * @height: Plot area height
+ * @xy: (nullable): A #PocFloatArray of interleaved x and y coordinates
  *
- * Draw the dataset in the main plot area.  Used by #PocPlot.
+ * Set the dataset's control points from an array of single precision
+ * coordinates stored as `x0, y0, x1, y1, ...`.  The array is not copied or
+ * widened to #gdouble; the dataset holds a reference to it through a pair of
+ * #PocVector views, see poc_dataset_set_vectors().  The array should not be
+ * resized while the dataset uses it.
  */
 void
-poc_dataset_draw (PocDataset *self, cairo_t *cr, guint width, guint height)
+poc_dataset_set_float_points (PocDataset *self, PocFloatArray *xy)
 {
-  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
-  PocDatasetClass *class;
+  PocVector *x, *y;
+  guint n;
 
   g_return_if_fail (POC_IS_DATASET (self));
-  g_return_if_fail (POC_IS_AXIS (priv->x_axis));
-  g_return_if_fail (POC_IS_AXIS (priv->y_axis));
 
-  class = POC_DATASET_GET_CLASS (self);
-  g_return_if_fail (class->draw != NULL);
-  (*class->draw) (self, cr, width, height);
+  if (xy == NULL)
+    {
+      poc_dataset_set_vectors (self, NULL, NULL);
+      return;
+    }
+
+  n = xy->len / 2;
+  x = poc_vector_new_float (xy->data, n, 2, poc_dataset_float_array_unref,
+			    poc_float_array_ref (xy));
+  y = poc_vector_new_float (xy->data + 1, n, 2, poc_dataset_float_array_unref,
+			    poc_float_array_ref (xy));
+  poc_dataset_set_vectors (self, x, y);
+  poc_vector_unref (x);
+  poc_vector_unref (y);
+}
+
+/**
+ * poc_dataset_set_implicit_x:
+ * @self: A #PocDataset
+ * @start: X coordinate of the first point
+ * @step: spacing between X coordinates
+ * @y: (nullable): A #PocDoubleArray of y coordinates
+ *
+ * Set the dataset's control points from uniformly spaced samples.  Only the
+ * Y coordinates are stored; the X coordinate of the i'th point is
+ * `start + i * step` and is computed as needed.  If @step is not negative
+ * #PocDataset:sorted-x is set, allowing the visible points to be located
+ * without a search.
+ */
+void
+poc_dataset_set_implicit_x (PocDataset *self, gdouble start, gdouble step,
+			    PocDoubleArray *y)
+{
+  PocVector *vx, *vy;
+
+  g_return_if_fail (POC_IS_DATASET (self));
+
+  if (y == NULL)
+    {
+      poc_dataset_set_vectors (self, NULL, NULL);
+      return;
+    }
+
+  vx = poc_vector_new_implicit (start, step, y->len);
+  vy = poc_vector_new_from_double_array (y);
+  poc_dataset_set_vectors (self, vx, vy);
+  poc_vector_unref (vx);
+  poc_vector_unref (vy);
+  if (step >= 0.0)
+    poc_dataset_set_sorted_x (self, TRUE);
+}
+
+/**
+ * poc_dataset_get_x_vector:
+ * @self: A #PocDataset
+ *
+ * Get the vector of x coordinates set with poc_dataset_set_vectors().
+ *
+ * Returns: (transfer none) (nullable): A #PocVector
+ */
+PocVector *
+poc_dataset_get_x_vector (PocDataset *self)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+
+  g_return_val_if_fail (POC_IS_DATASET (self), NULL);
+
+  return priv->x_vector;
+}
+
+/**
+ * poc_dataset_get_y_vector:
+ * @self: A #PocDataset
+ *
+ * Get the vector of y coordinates set with poc_dataset_set_vectors().
+ *
+ * Returns: (transfer none) (nullable): A #PocVector
+ */
+PocVector *
+poc_dataset_get_y_vector (PocDataset *self)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+
+  g_return_val_if_fail (POC_IS_DATASET (self), NULL);
+
+  return priv->y_vector;
+}
+
+/**
+ * poc_dataset_get_data:
+ * @self: A #PocDataset
+ * @x: (out) (optional): location for a pointer to the first x coordinate
+ * @x_stride: (out) (optional): location for the distance between x
+ * coordinates in #gdouble units
+ * @y: (out) (optional): location for a pointer to the first y coordinate
+ * @y_stride: (out) (optional): location for the distance between y
+ * coordinates in #gdouble units
+ *
+ * Get a view of the dataset's control points, whether they were set as a
+ * #PocPointArray or as vectors.  The i'th point is
+ * `(x[i * x_stride], y[i * y_stride])`.  The pointers remain valid until the
+ * dataset's points or vectors are changed.  This function is intended for use
+ * in drawing code in subclasses of #PocDataset.
+ *
+ * Only points stored as #gdouble can be viewed this way; if either vector
+ * has another #PocVectorFormat no points are returned.  Use
+ * poc_dataset_get_data_vectors() to view points stored in any format.
+ *
+ * Returns: the number of points.
+ */
+guint
+poc_dataset_get_data (PocDataset *self,
+		      const gdouble **x, gsize *x_stride,
+		      const gdouble **y, gsize *y_stride)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+  const gdouble *px = NULL, *py = NULL;
+  gsize sx = 1, sy = 1;
+  guint len = 0;
+
+  g_return_val_if_fail (POC_IS_DATASET (self), 0);
+
+  if (priv->x_vector != NULL && priv->y_vector != NULL)
+    {
+      if (priv->x_vector->format == POC_VECTOR_DOUBLE
+	  && priv->y_vector->format == POC_VECTOR_DOUBLE)
+	{
+	  px = priv->x_vector->data;
+	  sx = priv->x_vector->stride;
+	  py = priv->y_vector->data;
+	  sy = priv->y_vector->stride;
+	  len = MIN (priv->x_vector->len, priv->y_vector->len);
+	}
+    }
+  else if (priv->points != NULL && priv->points->len > 0)
+    {
+      px = &priv->points->data->x;
+      py = &priv->points->data->y;
+      sx = sy = 2;
+      len = priv->points->len;
+    }
+
+  if (x != NULL)
+    *x = px;
+  if (x_stride != NULL)
+    *x_stride = sx;
+  if (y != NULL)
+    *y = py;
+  if (y_stride != NULL)
+    *y_stride = sy;
+  return len;
+}
+
+/* Initialise a view, not reference counted, of a strided double array */
+static inline void
+poc_dataset_init_view (PocVector *view, const gdouble *data, guint len,
+		       gsize stride)
+{
+  view->data = data;
+  view->len = len;
+  view->stride = stride;
+  view->format = POC_VECTOR_DOUBLE;
+  view->start = 0.0;
+  view->step = 0.0;
+}
+
+/**
+ * poc_dataset_get_data_vectors:
+ * @self: A #PocDataset
+ * @x: (out caller-allocates) (optional): location to store a view of the x
+ * coordinates
+ * @y: (out caller-allocates) (optional): location to store a view of the y
+ * coordinates
+ *
+ * Get a view of the dataset's control points in the format in which they
+ * are stored, whether they were set as a #PocPointArray or as vectors of any
+ * #PocVectorFormat.  The views are copied into @x and @y; they are not
+ * reference counted so must not be passed to poc_vector_ref() and remain
+ * valid only until the dataset's points or vectors are changed.  Access the
+ * values with poc_vector_index() or poc_vector_read(), or project them with
+ * poc_dataset_project_range().
+ *
+ * Returns: the number of points.
+ */
+guint
+poc_dataset_get_data_vectors (PocDataset *self, PocVector *x, PocVector *y)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+  PocVector vx, vy;
+  guint len;
+
+  g_return_val_if_fail (POC_IS_DATASET (self), 0);
+
+  if (priv->x_vector != NULL && priv->y_vector != NULL)
+    {
+      vx = *priv->x_vector;
+      vy = *priv->y_vector;
+      len = MIN (vx.len, vy.len);
+    }
+  else if (priv->points != NULL && priv->points->len > 0)
+    {
+      len = priv->points->len;
+      poc_dataset_init_view (&vx, &priv->points->data->x, len, 2);
+      poc_dataset_init_view (&vy, &priv->points->data->y, len, 2);
+    }
+  else
+    {
+      len = 0;
+      poc_dataset_init_view (&vx, NULL, 0, 1);
+      poc_dataset_init_view (&vy, NULL, 0, 1);
+    }
+  vx.len = vy.len = len;
+
+  if (x != NULL)
+    *x = vx;
+  if (y != NULL)
+    *y = vy;
+  return len;
 }
 
+/* Find the range [lo, hi) of points lying within [min_x, max_x] plus one
+   either side, so that a line through them reaches the edges of the plot.
+   The X coordinates must be non-decreasing.  Implicit coordinates are
+   located arithmetically. */
 static void
-poc_dataset_draw_real (PocDataset *self, cairo_t *cr,
-		       guint width, guint height)
+poc_dataset_visible_range (const PocVector *x, guint n,
+			   gdouble min_x, gdouble max_x, guint *lo, guint *hi)
+{
+  guint a, b, mid;
+  gdouble k;
+
+  if (x->format == POC_VECTOR_IMPLICIT && x->step > 0.0)
+    {
+      /* a is the first index with x >= min_x, b the first with x > max_x */
+      k = ceil ((min_x - x->start) / x->step);
+      a = k <= 0.0 ? 0 : k >= n ? n : (guint) k;
+      k = floor ((max_x - x->start) / x->step) + 1.0;
+      b = k <= 0.0 ? 0 : k >= n ? n : (guint) k;
+      *lo = a > 0 ? a - 1 : 0;
+      *hi = b < n ? b + 1 : n;
+      return;
+    }
+
+  a = 0; b = n;
+  while (a < b)
+    {
+      mid = a + (b - a) / 2;
+      if (poc_vector_index (x, mid) < min_x)
+	a = mid + 1;
+      else
+	b = mid;
+    }
+  *lo = a > 0 ? a - 1 : 0;
+
+  b = n;
+  while (a < b)
+    {
+      mid = a + (b - a) / 2;
+      if (poc_vector_index (x, mid) <= max_x)
+	a = mid + 1;
+      else
+	b = mid;
+    }
+  *hi = a < n ? a + 1 : n;
+}
+
+/**
+ * poc_dataset_get_visible_range:
+ * @self: A #PocDataset
+ * @start: (out) (optional): index of the first point to draw
+ * @end: (out) (optional): index following the last point to draw
+ *
+ * Get the range of points, as returned by poc_dataset_get_data_vectors(), which must
+ * be drawn to cover the display range of the dataset's X axis.  When
+ * #PocDataset:sorted-x is set the range is found by binary search and
+ * includes one point either side of the display range, otherwise it covers
+ * all the points.
+ *
+ * Returns: the number of points in the range
+ */
+guint
+poc_dataset_get_visible_range (PocDataset *self, guint *start, guint *end)
 {
   PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
-  PocPoint p;
-  const double *dashes;
-  int num_dashes;
-  guint i;
+  PocVector x;
+  gdouble min_x, max_x;
+  guint len, lo, hi;
 
-  if (priv->points == NULL)
-    return;
+  g_return_val_if_fail (POC_IS_DATASET (self), 0);
 
-  /* Draw the plot line */
-  cairo_new_path (cr);
-  p = poc_point_array_index (priv->points, 0);
-  cairo_move_to (cr, poc_axis_project (priv->x_axis, p.x, width),
-		     poc_axis_project (priv->y_axis, p.y, -height));
-  for (i = 1; i < poc_point_array_len (priv->points); i++)
+  len = poc_dataset_get_data_vectors (self, &x, NULL);
+  lo = 0;
+  hi = len;
+  if (priv->sorted_x && priv->x_axis != NULL && len > 0)
     {
-      p = poc_point_array_index (priv->points, i);
-      cairo_line_to (cr, poc_axis_project (priv->x_axis, p.x, width),
-			 poc_axis_project (priv->y_axis, p.y, -height));
+      poc_axis_get_display_range (priv->x_axis, &min_x, &max_x);
+      poc_dataset_visible_range (&x, len, min_x, max_x, &lo, &hi);
     }
+  if (start != NULL)
+    *start = lo;
+  if (end != NULL)
+    *end = hi;
+  return hi - lo;
+}
 
-  /* Stroke the line */
-  cairo_set_line_width (cr, 1.0);
-  dashes = poc_line_style_get_dashes (priv->line_style, &num_dashes);
-  cairo_set_dash (cr, dashes, num_dashes, 0.0);
-  gdk_cairo_set_source_rgba (cr, &priv->line_stroke);
-  cairo_stroke (cr);
+/* virtual/private methods {{{1 */
+
+void
+poc_dataset_notify_update (PocDataset *self)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+
+  g_return_if_fail (POC_IS_DATASET (self));
+
+  if (priv->update_freeze > 0)
+    priv->update_pending = TRUE;
+  else
+    g_signal_emit (self, poc_dataset_signals[UPDATE], 0);
 }
 
+/**
+ * poc_dataset_flush_invalidate:
+ * @self: A #PocDataset
+ *
+ * Perform an invalidation deferred by poc_dataset_freeze_update() so that
+ * a frozen dataset may be drawn without using stale cached data.  Called by
+ * #PocPlot on the main thread before drawing its datasets, since
+ * #PocDatasetClass.invalidate is always called on the main thread while
+ * drawing may not be.
+ */
+void
+poc_dataset_flush_invalidate (PocDataset *self)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+  PocDatasetClass *class;
+
+  g_return_if_fail (POC_IS_DATASET (self));
+
+  if (!priv->invalidate_pending)
+    return;
+  priv->invalidate_pending = FALSE;
+
+  class = POC_DATASET_GET_CLASS (self);
+  g_return_if_fail (class->invalidate != NULL);
+  (*class->invalidate) (self);
+  priv->invalid_from = 0;
+}
+
+/**
+ * poc_dataset_freeze_update:
+ * @self: A #PocDataset
+ *
+ * Defer invalidation of cached data, "update" signals and property change
+ * notifications until poc_dataset_thaw_update() is called.  Each is then
+ * emitted at most once, however many changes were made.  Calls may be
+ * nested.  A #PocPlot drawing a frozen dataset first discards any
+ * invalidated cached data with poc_dataset_flush_invalidate().
+ */
+void
+poc_dataset_freeze_update (PocDataset *self)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+
+  g_return_if_fail (POC_IS_DATASET (self));
+
+  g_object_freeze_notify (G_OBJECT (self));
+  priv->update_freeze += 1;
+}
+
+/**
+ * poc_dataset_thaw_update:
+ * @self: A #PocDataset
+ *
+ * Reverse the effect of a previous call to poc_dataset_freeze_update().
+ * When the last freeze is released, deferred invalidation is performed and
+ * a single "update" signal is emitted if any were collapsed.
+ */
+void
+poc_dataset_thaw_update (PocDataset *self)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+
+  g_return_if_fail (POC_IS_DATASET (self));
+  g_return_if_fail (priv->update_freeze > 0);
+
+  priv->update_freeze -= 1;
+  if (priv->update_freeze == 0)
+    {
+      poc_dataset_flush_invalidate (self);
+      if (priv->update_pending)
+	{
+	  priv->update_pending = FALSE;
+	  g_signal_emit (self, poc_dataset_signals[UPDATE], 0);
+	}
+    }
+  g_object_thaw_notify (G_OBJECT (self));
+}
+
+/**
+ * poc_dataset_invalidate:
+ * @self: A #PocDataset
+ *
+ * Notify subclasses cached data is invalid.
+ */
+void
+poc_dataset_invalidate (PocDataset *self)
+{
+  g_return_if_fail (POC_IS_DATASET (self));
+
+  poc_dataset_invalidate_from (self, 0);
+}
+
+/* Invalidate cached data for points from index start onwards.  Pending
+   invalidations accumulate while frozen so the lowest start applies. */
+static void
+poc_dataset_invalidate_from (PocDataset *self, guint start)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+
+  if (!priv->invalidate_pending || start < priv->invalid_from)
+    priv->invalid_from = start;
+  priv->invalidate_pending = TRUE;
+  if (priv->update_freeze == 0)
+    poc_dataset_flush_invalidate (self);
+}
+
+static void
+poc_dataset_invalidate_real (PocDataset *self)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+
+  /* Summaries of points which were only appended to are still valid and
+     the pyramid is extended incrementally */
+  if (priv->invalid_from == 0)
+    priv->lod_valid = FALSE;
+  if (priv->data_path != NULL)
+    {
+      cairo_path_destroy (priv->data_path);
+      priv->data_path = NULL;
+    }
+  if (priv->index != NULL)
+    {
+      poc_index_free (priv->index);
+      priv->index = NULL;
+    }
+  if (priv->cache != NULL)
+    poc_cache_clear (priv->cache);
+}
+
+/* Render cache for use by subclasses, created on demand */
+PocCache *
+poc_dataset_get_cache (PocDataset *self)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+
+  if (priv->cache == NULL)
+    priv->cache = poc_cache_new ();
+  return priv->cache;
+}
+
+/**
+ * poc_dataset_prepare:
+ * @self: A #PocDataset
+ *
+ * Give the dataset the opportunity to update itself before a frame is
+ * drawn.  Used by #PocPlot.
+ *
+ * Returns: %TRUE if the dataset should be prepared again on the next frame.
+ */
+gboolean
+poc_dataset_prepare (PocDataset *self)
+{
+  PocDatasetClass *class;
+
+  g_return_val_if_fail (POC_IS_DATASET (self), FALSE);
+
+  class = POC_DATASET_GET_CLASS (self);
+  if (class->prepare == NULL)
+    return FALSE;
+  return (*class->prepare) (self);
+}
+
+/**
+ * poc_dataset_draw:
+ * @self: A #PocDataset
+ * @cr: A #cairo_t
+ * @width: Plot area width
+ * @height: Plot area height
+ *
+ * Draw the dataset in the main plot area.  Used by #PocPlot.
+ */
+void
+poc_dataset_draw (PocDataset *self, cairo_t *cr, guint width, guint height)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+  PocDatasetClass *class;
+  gint64 start;
+
+  g_return_if_fail (POC_IS_DATASET (self));
+  g_return_if_fail (POC_IS_AXIS (priv->x_axis));
+  g_return_if_fail (POC_IS_AXIS (priv->y_axis));
+
+  class = POC_DATASET_GET_CLASS (self);
+  g_return_if_fail (class->draw != NULL);
+  start = g_get_monotonic_time ();
+  (*class->draw) (self, cr, width, height);
+  priv->draw_time += g_get_monotonic_time () - start;
+}
+
+/**
+ * poc_dataset_add_draw_stats:
+ * @self: A #PocDataset
+ * @points: number of points submitted for drawing
+ * @segments: number of line segments added to the path
+ *
+ * Record the amount of work done by a #PocDatasetClass.draw()
+ * implementation for #PocPlot:frame-stats.  The default drawing methods
+ * call this themselves; subclasses which build their own paths should call
+ * it for each line drawn.
+ */
+void
+poc_dataset_add_draw_stats (PocDataset *self, guint points, guint segments)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+
+  g_return_if_fail (POC_IS_DATASET (self));
+
+  priv->draw_points += points;
+  priv->draw_segments += segments;
+}
+
+/**
+ * poc_dataset_take_draw_stats:
+ * @self: A #PocDataset
+ * @draw_time: (out) (optional): time spent drawing in microseconds
+ * @points: (out) (optional): number of points submitted for drawing
+ * @segments: (out) (optional): number of line segments drawn
+ *
+ * Retrieve the drawing statistics accumulated since the last call and reset
+ * them to zero.  Used by #PocPlot.
+ *
+ * The statistics belong to the dataset, not to a plot.  A dataset shown in
+ * several plots accumulates the work of drawing it in all of them, so each
+ * plot's #PocPlot::frame-stats may include work done for another plot since
+ * the last frame.
+ */
+void
+poc_dataset_take_draw_stats (PocDataset *self, gint64 *draw_time,
+			     guint *points, guint *segments)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+
+  g_return_if_fail (POC_IS_DATASET (self));
+
+  if (draw_time != NULL)
+    *draw_time = priv->draw_time;
+  if (points != NULL)
+    *points = priv->draw_points;
+  if (segments != NULL)
+    *segments = priv->draw_segments;
+  priv->draw_time = 0;
+  priv->draw_points = priv->draw_segments = 0;
+}
+
+/* projection {{{2 */
+
+/**
+ * poc_dataset_project_points:
+ * @self: A #PocDataset
+ * @points: (array length=n): points in dataset coordinates
+ * @out: (array length=n): destination for the projected points
+ * @n: number of points
+ * @width: width of the plot area
+ * @height: height of the plot area
+ *
+ * Project @n points to pixel positions using the dataset's x and y axes.
+ * This is equivalent to calling poc_axis_project() on each coordinate but
+ * uses poc_axis_project_vector() to project whole arrays at a time.  @points
+ * and @out may be the same location.  This function is intended for use in
+ * drawing code in subclasses of #PocDataset.
+ */
+void
+poc_dataset_project_points (PocDataset *self, const PocPoint *points,
+			    PocPoint *out, guint n, guint width, guint height)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+
+  g_return_if_fail (POC_IS_DATASET (self));
+
+  poc_axis_project_vector (priv->x_axis, &points->x, 2, &out->x, 2, n, width);
+  poc_axis_project_vector (priv->y_axis, &points->y, 2, &out->y, 2, n, -height);
+}
+
+/**
+ * poc_dataset_project_strided:
+ * @self: A #PocDataset
+ * @x: (array): x coordinates in dataset units
+ * @x_stride: distance between x coordinates in #gdouble units
+ * @y: (array): y coordinates in dataset units
+ * @y_stride: distance between y coordinates in #gdouble units
+ * @out: (array length=n): destination for the projected points
+ * @n: number of points
+ * @width: width of the plot area
+ * @height: height of the plot area
+ *
+ * Project @n points given as separate strided coordinate arrays to pixel
+ * positions using the dataset's x and y axes.  This suits the view returned
+ * by poc_dataset_get_data().
+ */
+void
+poc_dataset_project_strided (PocDataset *self,
+			     const gdouble *x, gsize x_stride,
+			     const gdouble *y, gsize y_stride,
+			     PocPoint *out, guint n, guint width, guint height)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+
+  g_return_if_fail (POC_IS_DATASET (self));
+
+  poc_axis_project_vector (priv->x_axis, x, x_stride, &out->x, 2, n, width);
+  poc_axis_project_vector (priv->y_axis, y, y_stride, &out->y, 2, n, -height);
+}
+
+static inline void
+poc_dataset_project_view (PocDataset *self,
+			  const PocVector *x, const PocVector *y, guint start,
+			  PocPoint *out, guint n, guint width, guint height)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+
+  poc_axis_project_values (priv->x_axis, x, start, &out->x, 2, n, width);
+  poc_axis_project_values (priv->y_axis, y, start, &out->y, 2, n, -height);
+}
+
+/**
+ * poc_dataset_project_range:
+ * @self: A #PocDataset
+ * @start: index of the first point to project
+ * @out: (array length=n): destination for the projected points
+ * @n: number of points
+ * @width: width of the plot area
+ * @height: height of the plot area
+ *
+ * Project @n of the dataset's points, starting at @start, to pixel
+ * positions using the dataset's x and y axes.  The points are read in the
+ * format in which they are stored, see poc_dataset_get_data_vectors().
+ */
+void
+poc_dataset_project_range (PocDataset *self, guint start, PocPoint *out,
+			   guint n, guint width, guint height)
+{
+  PocVector x, y;
+  guint len;
+
+  g_return_if_fail (POC_IS_DATASET (self));
+
+  len = poc_dataset_get_data_vectors (self, &x, &y);
+  g_return_if_fail (start + n <= len);
+
+  poc_dataset_project_view (self, &x, &y, start, out, n, width, height);
+}
+
+/* hit testing {{{2 */
+
+struct nearest
+  {
+    PocDataset *self;
+    const PocVector *x;
+    const PocVector *y;
+    gdouble px, py;
+    gint width, height;
+    gdouble distance2;
+    guint index;
+  };
+
+static void
+poc_dataset_nearest_test (guint i, gpointer user_data)
+{
+  struct nearest *nearest = user_data;
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (nearest->self);
+  gdouble dx, dy, d2;
+
+  dx = poc_axis_project (priv->x_axis, poc_vector_index (nearest->x, i),
+			 nearest->width) - nearest->px;
+  dy = poc_axis_project (priv->y_axis, poc_vector_index (nearest->y, i),
+			 nearest->height) - nearest->py;
+  d2 = dx * dx + dy * dy;
+  if (d2 < nearest->distance2
+      || (d2 == nearest->distance2 && nearest->index == G_MAXUINT))
+    {
+      nearest->distance2 = d2;
+      nearest->index = i;
+    }
+}
+
+/**
+ * poc_dataset_nearest_point:
+ * @self: A #PocDataset
+ * @x: x position in pixels relative to the plot area
+ * @y: y position in pixels relative to the plot area
+ * @width: width of the plot area
+ * @height: height of the plot area
+ * @max_distance: search radius in pixels
+ * @index: (out) (optional): location to store the index of the point
+ * @distance: (out) (optional): location to store the distance in pixels
+ *
+ * Find the point, as returned by poc_dataset_get_data_vectors(), whose
+ * projection is nearest to (@x, @y) and no further than @max_distance.
+ * When #PocDataset:sorted-x is set the candidates are found by binary
+ * search, otherwise with a spatial index built when first required.  The
+ * index is discarded by poc_dataset_invalidate() so queries remain fast
+ * enough to track the pointer over very large datasets.
+ *
+ * Returns: %TRUE if a point was found.
+ */
+gboolean
+poc_dataset_nearest_point (PocDataset *self, gdouble x, gdouble y,
+			   guint width, guint height, gdouble max_distance,
+			   guint *index, gdouble *distance)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+  struct nearest nearest;
+  PocVector vx, vy;
+  gdouble x0, x1, y0, y1;
+  guint i, len, lo, hi;
+
+  g_return_val_if_fail (POC_IS_DATASET (self), FALSE);
+  g_return_val_if_fail (max_distance >= 0.0, FALSE);
+
+  len = poc_dataset_get_data_vectors (self, &vx, &vy);
+  if (len == 0 || priv->x_axis == NULL || priv->y_axis == NULL
+      || width == 0 || height == 0)
+    return FALSE;
+
+  nearest.self = self;
+  nearest.x = &vx;
+  nearest.y = &vy;
+  nearest.px = x;
+  nearest.py = y;
+  nearest.width = width;
+  nearest.height = -(gint) height;
+  nearest.distance2 = max_distance * max_distance;
+  nearest.index = G_MAXUINT;
+
+  /* The search square in data space; axes may be reversed */
+  x0 = poc_axis_unproject (priv->x_axis, x - max_distance, nearest.width);
+  x1 = poc_axis_unproject (priv->x_axis, x + max_distance, nearest.width);
+  y0 = poc_axis_unproject (priv->y_axis, y - max_distance, nearest.height);
+  y1 = poc_axis_unproject (priv->y_axis, y + max_distance, nearest.height);
+
+  if (priv->sorted_x)
+    {
+      poc_dataset_visible_range (&vx, len, MIN (x0, x1), MAX (x0, x1),
+				 &lo, &hi);
+      for (i = lo; i < hi; i++)
+	poc_dataset_nearest_test (i, &nearest);
+    }
+  else
+    {
+      if (priv->index == NULL)
+	priv->index = poc_index_new (&vx, &vy, len);
+      poc_index_foreach (priv->index, MIN (x0, x1), MAX (x0, x1),
+			 MIN (y0, y1), MAX (y0, y1),
+			 poc_dataset_nearest_test, &nearest);
+    }
+
+  if (nearest.index == G_MAXUINT)
+    return FALSE;
+  if (index != NULL)
+    *index = nearest.index;
+  if (distance != NULL)
+    *distance = sqrt (nearest.distance2);
+  return TRUE;
+}
+
+/* Points are projected in chunks of this size into a buffer on the stack */
+#define PROJECT_CHUNK	256
+
+/* min/max decimation {{{2 */
+
+/* Points falling within a single pixel column.  Indices are retained so
+   the minimum and maximum can be emitted in their original order. */
+struct column
+  {
+    gdouble x;
+    PocPoint first, last, min, max;
+    guint i_first, i_last, i_min, i_max;
+  };
+
+/* n_path counts the points added to the path */
+static inline void
+poc_dataset_path_point (cairo_t *cr, guint *n_path, const PocPoint *p)
+{
+  if ((*n_path)++ > 0)
+    cairo_line_to (cr, p->x, p->y);
+  else
+    cairo_move_to (cr, p->x, p->y);
+}
+
+static void
+poc_dataset_path_column (cairo_t *cr, guint *n_path,
+			 const struct column *column)
+{
+  const PocPoint *a, *b;
+  guint i_a, i_b;
+
+  if (column->i_min <= column->i_max)
+    {
+      a = &column->min, i_a = column->i_min;
+      b = &column->max, i_b = column->i_max;
+    }
+  else
+    {
+      a = &column->max, i_a = column->i_max;
+      b = &column->min, i_b = column->i_min;
+    }
+
+  poc_dataset_path_point (cr, n_path, &column->first);
+  if (i_a != column->i_first)
+    poc_dataset_path_point (cr, n_path, a);
+  if (i_b != column->i_first && i_b != i_a)
+    poc_dataset_path_point (cr, n_path, b);
+  if (column->i_last != column->i_first
+      && column->i_last != i_a && column->i_last != i_b)
+    poc_dataset_path_point (cr, n_path, &column->last);
+}
+
+static guint
+poc_dataset_path_min_max (PocDataset *self, cairo_t *cr,
+			  const PocVector *px, const PocVector *py,
+			  guint start, guint len, guint width, guint height)
+{
+  PocPoint buf[PROJECT_CHUNK];
+  struct column column = { 0 };
+  guint n_path = 0;
+  PocPoint q;
+  gdouble x;
+  guint i, j, n;
+
+  for (i = 0; i < len; i += n)
+    {
+      n = MIN (PROJECT_CHUNK, len - i);
+      poc_dataset_project_view (self, px, py, start + i, buf, n, width, height);
+      for (j = 0; j < n; j++)
+	{
+	  q = buf[j];
+	  x = floor (q.x);
+
+	  if (i + j == 0 || x != column.x)
+	    {
+	      if (i + j > 0)
+		poc_dataset_path_column (cr, &n_path, &column);
+	      column.x = x;
+	      column.first = column.last = column.min = column.max = q;
+	      column.i_first = column.i_last = column.i_min = column.i_max = i + j;
+	      continue;
+	    }
+
+	  column.last = q;
+	  column.i_last = i + j;
+	  if (q.y < column.min.y)
+	    {
+	      column.min = q;
+	      column.i_min = i + j;
+	    }
+	  if (q.y > column.max.y)
+	    {
+	      column.max = q;
+	      column.i_max = i + j;
+	    }
+	}
+    }
+  if (len > 0)
+    poc_dataset_path_column (cr, &n_path, &column);
+  return n_path;
+}
+
+/* polyline {{{2 */
+
+static guint
+poc_dataset_path_polyline (PocDataset *self, cairo_t *cr,
+			   const PocVector *px, const PocVector *py,
+			   guint start, guint len, guint width, guint height)
+{
+  PocPoint buf[PROJECT_CHUNK];
+  guint n_path = 0;
+  guint i, j, n;
+
+  for (i = 0; i < len; i += n)
+    {
+      n = MIN (PROJECT_CHUNK, len - i);
+      poc_dataset_project_view (self, px, py, start + i, buf, n, width, height);
+      for (j = 0; j < n; j++)
+	poc_dataset_path_point (cr, &n_path, &buf[j]);
+    }
+  return n_path;
+}
+
+/* draw {{{2 */
+
+/**
+ * poc_dataset_draw_strided:
+ * @self: A #PocDataset
+ * @cr: A #cairo_t
+ * @x: (array): pointer to the first x coordinate
+ * @x_stride: distance between x coordinates in #gdouble units
+ * @y: (array): pointer to the first y coordinate
+ * @y_stride: distance between y coordinates in #gdouble units
+ * @n: number of points
+ * @width: Width of plot area
+ * @height: Height of plot area
+ *
+ * Stroke a line through @n points using the dataset's line style, stroke
+ * colour and decimation setting.  This is the default drawing method and is
+ * intended for use by subclasses which supply a subset of their data, for
+ * example only the points within the visible range.
+ */
+void
+poc_dataset_draw_strided (PocDataset *self, cairo_t *cr,
+			  const gdouble *x, gsize x_stride,
+			  const gdouble *y, gsize y_stride,
+			  guint n, guint width, guint height)
+{
+  PocVector vx, vy;
+
+  g_return_if_fail (POC_IS_DATASET (self));
+
+  poc_dataset_init_view (&vx, x, n, x_stride);
+  poc_dataset_init_view (&vy, y, n, y_stride);
+  poc_dataset_draw_view (self, cr, &vx, &vy, 0, n, width, height);
+}
+
+/* Stroke the current path using the dataset's line style */
+static void
+poc_dataset_stroke (PocDataset *self, cairo_t *cr)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+  const double *dashes;
+  int num_dashes;
+
+  cairo_set_line_width (cr, 1.0);
+  dashes = poc_line_style_get_dashes (priv->line_style, &num_dashes);
+  cairo_set_dash (cr, dashes, num_dashes, 0.0);
+  gdk_cairo_set_source_rgba (cr, &priv->line_stroke);
+  cairo_stroke (cr);
+}
+
+/* Add a line through points [start, start + n) of the views to the path,
+   decimated if required.  Returns the number of points in the path. */
+static guint
+poc_dataset_path_view (PocDataset *self, cairo_t *cr,
+		       const PocVector *x, const PocVector *y,
+		       guint start, guint n, guint width, guint height)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+
+  if (priv->decimation != POC_DECIMATION_NONE && n > 4 * width)
+    return poc_dataset_path_min_max (self, cr, x, y, start, n,
+				     width, height);
+  return poc_dataset_path_polyline (self, cr, x, y, start, n,
+				    width, height);
+}
+
+/* Stroke a line through points [start, start + n) of the views */
+static void
+poc_dataset_draw_view (PocDataset *self, cairo_t *cr,
+		       const PocVector *x, const PocVector *y,
+		       guint start, guint n, guint width, guint height)
+{
+  guint n_path;
+
+  if (n == 0)
+    return;
+
+  cairo_new_path (cr);
+  n_path = poc_dataset_path_view (self, cr, x, y, start, n, width, height);
+  poc_dataset_add_draw_stats (self, n, n_path - 1);
+  poc_dataset_stroke (self, cr);
+}
+
+/* Add a line through the visible points to the path, taken from the
+   coarsest level of the pyramid index with enough points, and set
+   n_points to the number of points it was taken from.  Returns the number
+   of points in the path. */
+static guint
+poc_dataset_path_pyramid (PocDataset *self, cairo_t *cr,
+			  const PocVector *x, const PocVector *y, guint len,
+			  guint width, guint height, guint *n_points)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+  const PocPoint *level;
+  PocVector lx, ly;
+  gdouble min_x, max_x;
+  guint k, n, lo, hi;
+
+  *n_points = 0;
+  if (len == 0)
+    return 0;
+
+  if (priv->lod == NULL)
+    priv->lod = poc_lod_new ();
+  if (!priv->lod_valid)
+    {
+      poc_lod_reset (priv->lod);
+      priv->lod_valid = TRUE;
+    }
+  poc_lod_update (priv->lod, x, y, len);
+
+  /* Use the coarsest level giving at least two points per pixel */
+  poc_axis_get_display_range (priv->x_axis, &min_x, &max_x);
+  for (k = poc_lod_get_n_levels (priv->lod); k-- > 0; )
+    {
+      level = poc_lod_get_level (priv->lod, k, &n);
+      poc_dataset_init_view (&lx, &level->x, n, 2);
+      poc_dataset_init_view (&ly, &level->y, n, 2);
+      poc_dataset_visible_range (&lx, n, min_x, max_x, &lo, &hi);
+      if (hi - lo >= 2 * width)
+	{
+	  *n_points = hi - lo;
+	  return poc_dataset_path_view (self, cr, &lx, &ly, lo, hi - lo,
+					width, height);
+	}
+    }
+
+  /* Zoomed in far enough to draw the points themselves */
+  poc_dataset_visible_range (x, len, min_x, max_x, &lo, &hi);
+  *n_points = hi - lo;
+  return poc_dataset_path_view (self, cr, x, y, lo, hi - lo, width, height);
+}
+
+/* decimated path cache {{{2 */
+
+/* A decimated line has no more than four points per pixel column so its
+   path is small enough to keep for each size and axis range the dataset is
+   drawn at, sparing linked plots from decimating the data again on every
+   alternating draw. */
+struct path_entry
+  {
+    cairo_path_t	*path;
+    PocDecimation	decimation;
+    guint		n_points;
+    guint		n_path;
+  };
+
+static const gchar path_cache_tag[] = "path";
+
+static void
+path_entry_free (gpointer data)
+{
+  struct path_entry *entry = data;
+
+  cairo_path_destroy (entry->path);
+  g_free (entry);
+}
+
+static void
+poc_dataset_draw_decimated (PocDataset *self, cairo_t *cr,
+			    const PocVector *x, const PocVector *y, guint len,
+			    guint width, guint height)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+  PocCache *cache = poc_dataset_get_cache (self);
+  struct path_entry *entry;
+  PocCacheKey key;
+  guint n_points, n_path, lo, hi;
+
+  poc_cache_key_init (&key, path_cache_tag, priv->x_axis, priv->y_axis,
+		      width, height);
+  entry = poc_cache_lookup (cache, &key);
+  cairo_new_path (cr);
+  if (entry != NULL && entry->decimation == priv->decimation)
+    {
+      cairo_append_path (cr, entry->path);
+      n_points = entry->n_points;
+      n_path = entry->n_path;
+    }
+  else
+    {
+      if (priv->decimation == POC_DECIMATION_PYRAMID)
+	n_path = poc_dataset_path_pyramid (self, cr, x, y, len,
+					   width, height, &n_points);
+      else
+	{
+	  poc_dataset_get_visible_range (self, &lo, &hi);
+	  n_points = hi - lo;
+	  n_path = poc_dataset_path_view (self, cr, x, y, lo, n_points,
+					  width, height);
+	}
+
+      entry = g_new (struct path_entry, 1);
+      entry->path = cairo_copy_path (cr);
+      entry->decimation = priv->decimation;
+      entry->n_points = n_points;
+      entry->n_path = n_path;
+      if (entry->path->status == CAIRO_STATUS_SUCCESS)
+	poc_cache_insert (cache, &key, entry, path_entry_free);
+      else
+	path_entry_free (entry);
+    }
+
+  if (n_path == 0)
+    return;
+  poc_dataset_add_draw_stats (self, n_points, n_path - 1);
+  poc_dataset_stroke (self, cr);
+}
+
+/* Cairo holds paths in 24.8 fixed point device coordinates.  The cached
+   path is built with the data scaled to [0, DATA_PATH_EXTENT] and may be
+   drawn while a unit spans at most DATA_PATH_MAX_ZOOM pixels, which bounds
+   the rounding error to 1/16 pixel. */
+#define DATA_PATH_EXTENT	65536.0
+#define DATA_PATH_MAX_ZOOM	16.0
+
+static void
+poc_dataset_data_bounds (const PocVector *v, guint len,
+			 gdouble *origin, gdouble *scale)
+{
+  gdouble buf[PROJECT_CHUNK];
+  gdouble lo, hi;
+  guint i, j, n;
+
+  lo = G_MAXDOUBLE;
+  hi = -G_MAXDOUBLE;
+  for (i = 0; i < len; i += n)
+    {
+      n = MIN (PROJECT_CHUNK, len - i);
+      poc_vector_read (v, i, n, buf, 1);
+      for (j = 0; j < n; j++)
+	if (isfinite (buf[j]))
+	  {
+	    if (buf[j] < lo)
+	      lo = buf[j];
+	    if (buf[j] > hi)
+	      hi = buf[j];
+	  }
+    }
+  if (lo > hi)
+    lo = hi = 0.0;
+  *origin = lo;
+  *scale = hi > lo ? DATA_PATH_EXTENT / (hi - lo) : 1.0;
+}
+
+static void
+poc_dataset_build_data_path (PocDataset *self, cairo_t *cr,
+			     const PocVector *x, const PocVector *y, guint len)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+  PocPoint buf[PROJECT_CHUNK];
+  guint i, j, n, n_path;
+
+  poc_dataset_data_bounds (x, len, &priv->data_origin_x, &priv->data_scale_x);
+  poc_dataset_data_bounds (y, len, &priv->data_origin_y, &priv->data_scale_y);
+
+  cairo_save (cr);
+  cairo_identity_matrix (cr);
+  cairo_new_path (cr);
+  n_path = 0;
+  for (i = 0; i < len; i += n)
+    {
+      n = MIN (PROJECT_CHUNK, len - i);
+      poc_vector_read (x, i, n, &buf->x, 2);
+      poc_vector_read (y, i, n, &buf->y, 2);
+      for (j = 0; j < n; j++)
+	{
+	  buf[j].x = (buf[j].x - priv->data_origin_x) * priv->data_scale_x;
+	  buf[j].y = (buf[j].y - priv->data_origin_y) * priv->data_scale_y;
+	  poc_dataset_path_point (cr, &n_path, &buf[j]);
+	}
+    }
+  priv->data_path = cairo_copy_path (cr);
+  priv->data_path_points = n_path;
+  cairo_new_path (cr);
+  cairo_restore (cr);
+
+  if (priv->data_path->status != CAIRO_STATUS_SUCCESS)
+    {
+      cairo_path_destroy (priv->data_path);
+      priv->data_path = NULL;
+    }
+}
+
+/* On linear axes the projection is affine.  Stroke a path built once in
+   data space through the axis mapping, so that panning and zooming require
+   no projection or path construction.  Returns FALSE if the path cannot
+   be used. */
+static gboolean
+poc_dataset_draw_cached (PocDataset *self, cairo_t *cr,
+			 const PocVector *x, const PocVector *y, guint len,
+			 guint width, guint height)
+{
+  PocDatasetPrivate *priv = poc_dataset_get_instance_private (self);
+  cairo_matrix_t matrix;
+  gdouble sx, ox, sy, oy;
+  guint lo, hi;
+
+  if (priv->decimation != POC_DECIMATION_NONE || len < 2
+      || poc_axis_get_axis_mode (priv->x_axis) != POC_AXIS_LINEAR
+      || poc_axis_get_axis_mode (priv->y_axis) != POC_AXIS_LINEAR)
+    return FALSE;
+
+  /* Culling is cheaper when most sorted points are out of view */
+  if (priv->sorted_x)
+    {
+      poc_dataset_get_visible_range (self, &lo, &hi);
+      if ((hi - lo) * 2 < len)
+	return FALSE;
+    }
+
+  poc_axis_get_projection (priv->x_axis, width, &sx, &ox);
+  poc_axis_get_projection (priv->y_axis, -height, &sy, &oy);
+
+  if (priv->data_path == NULL)
+    poc_dataset_build_data_path (self, cr, x, y, len);
+  if (priv->data_path == NULL)
+    return FALSE;
+
+  /* Pixels per unit of the normalised data space */
+  sx /= priv->data_scale_x;
+  sy /= priv->data_scale_y;
+  if (!(sx != 0.0 && fabs (sx) <= DATA_PATH_MAX_ZOOM
+	&& sy != 0.0 && fabs (sy) <= DATA_PATH_MAX_ZOOM))
+    return FALSE;
+  cairo_matrix_init (&matrix, sx, 0.0, 0.0, sy,
+		     priv->data_origin_x * sx * priv->data_scale_x + ox,
+		     priv->data_origin_y * sy * priv->data_scale_y + oy);
+
+  /* The path is transformed to device space as it is appended, so
+     restoring the matrix before stroking keeps the line 1px wide */
+  cairo_new_path (cr);
+  cairo_save (cr);
+  cairo_transform (cr, &matrix);
+  cairo_append_path (cr, priv->data_path);
+  cairo_restore (cr);
+  poc_dataset_add_draw_stats (self, len, priv->data_path_points - 1);
+  poc_dataset_stroke (self, cr);
+  return TRUE;
+}
+
+static void
+poc_dataset_draw_real (PocDataset *self, cairo_t *cr,
+		       guint width, guint height)
+{
+  PocVector x, y;
+  guint len, lo, hi;
+
+  len = poc_dataset_get_data_vectors (self, &x, &y);
+  if (poc_dataset_draw_cached (self, cr, &x, &y, len, width, height))
+    return;
+  if (poc_dataset_get_decimation (self) != POC_DECIMATION_NONE)
+    poc_dataset_draw_decimated (self, cr, &x, &y, len, width, height);
+  else
+    {
+      poc_dataset_get_visible_range (self, &lo, &hi);
+      poc_dataset_draw_view (self, cr, &x, &y, lo, hi - lo, width, height);
+    }
+}
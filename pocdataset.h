@@ -38,8 +38,19 @@ G_DECLARE_DERIVABLE_TYPE (PocDataset, poc_dataset, POC, DATASET, GObject)
  * PocDatasetClass:
  * @draw: Method called by #PocPlot to draw visible area of plot.
  * @invalidate: Notify subclasses to invalidate cached data.
+ * @prepare: Called by #PocPlot on the main thread at the start of each frame,
+ * 	before anything is drawn.  Return %TRUE to be called again on the
+ * 	next frame even if nothing else needs to be redrawn.
  *
  * The class structure for #PocDatasetClass.
+ *
+ * When #PocPlot:threaded-datasets is enabled, or the plot is rendered with
+ * poc_plot_render() from another thread, @draw is called on a worker thread
+ * while the main thread waits.  Datasets are drawn concurrently with each
+ * other, so @draw may update the dataset's own cached state and read its axes
+ * but must not modify the axes or any other shared object, emit signals or
+ * call GTK functions.  Drawing with cairo on the supplied context is safe.
+ * @invalidate is always called on the main thread.
  */
 struct _PocDatasetClass
 {
@@ -50,9 +61,9 @@ struct _PocDatasetClass
   void		(*draw)		(PocDataset *self, cairo_t *cr,
 			         guint width, guint height);
   void		(*invalidate)	(PocDataset *self);
+  gboolean	(*prepare)	(PocDataset *self);
 
   /*< private >*/
-  void		(*dummy3)	(PocDataset *self);
   void		(*dummy4)	(PocDataset *self);
 };
 
@@ -72,19 +83,72 @@ void		poc_dataset_set_x_axis (PocDataset *self, PocAxis *axis);
 PocAxis *	poc_dataset_get_x_axis (PocDataset *self);
 void		poc_dataset_set_y_axis (PocDataset *self, PocAxis *axis);
 PocAxis *	poc_dataset_get_y_axis (PocDataset *self);
+void		poc_dataset_set_decimation (PocDataset *self,
+					    PocDecimation decimation);
+PocDecimation	poc_dataset_get_decimation (PocDataset *self);
+void		poc_dataset_set_sorted_x (PocDataset *self, gboolean sorted_x);
+gboolean	poc_dataset_get_sorted_x (PocDataset *self);
 void		poc_dataset_set_points (PocDataset *self,
 					PocPointArray *points);
 PocPointArray *	poc_dataset_get_points (PocDataset *self);
 
 void		poc_dataset_notify_update (PocDataset *self);
+void		poc_dataset_freeze_update (PocDataset *self);
+void		poc_dataset_thaw_update (PocDataset *self);
 void		poc_dataset_invalidate (PocDataset *self);
+void		poc_dataset_flush_invalidate (PocDataset *self);
+gboolean	poc_dataset_prepare (PocDataset *self);
+void		poc_dataset_add_draw_stats (PocDataset *self,
+					    guint points, guint segments);
+void		poc_dataset_take_draw_stats (PocDataset *self,
+					     gint64 *draw_time,
+					     guint *points, guint *segments);
 void		poc_dataset_draw (PocDataset *self, cairo_t *cr,
 				  guint width, guint height);
+void		poc_dataset_project_points (PocDataset *self,
+					    const PocPoint *points,
+					    PocPoint *out, guint n,
+					    guint width, guint height);
 
 void		poc_dataset_set_points_array (PocDataset *self,
 					      const gdouble *x,
 					      const gdouble *y,
 					      guint points);
+void		poc_dataset_append_points (PocDataset *self,
+					   const PocPoint *points, guint n);
+void		poc_dataset_set_vectors (PocDataset *self,
+					 PocVector *x, PocVector *y);
+void		poc_dataset_set_float_points (PocDataset *self,
+					      PocFloatArray *xy);
+void		poc_dataset_set_implicit_x (PocDataset *self,
+					    gdouble start, gdouble step,
+					    PocDoubleArray *y);
+PocVector *	poc_dataset_get_x_vector (PocDataset *self);
+PocVector *	poc_dataset_get_y_vector (PocDataset *self);
+guint		poc_dataset_get_data (PocDataset *self,
+				      const gdouble **x, gsize *x_stride,
+				      const gdouble **y, gsize *y_stride);
+guint		poc_dataset_get_data_vectors (PocDataset *self,
+					      PocVector *x, PocVector *y);
+void		poc_dataset_project_range (PocDataset *self, guint start,
+					   PocPoint *out, guint n,
+					   guint width, guint height);
+void		poc_dataset_project_strided (PocDataset *self,
+					     const gdouble *x, gsize x_stride,
+					     const gdouble *y, gsize y_stride,
+					     PocPoint *out, guint n,
+					     guint width, guint height);
+void		poc_dataset_draw_strided (PocDataset *self, cairo_t *cr,
+					  const gdouble *x, gsize x_stride,
+					  const gdouble *y, gsize y_stride,
+					  guint n, guint width, guint height);
+guint		poc_dataset_get_visible_range (PocDataset *self,
+					       guint *start, guint *end);
+gboolean	poc_dataset_nearest_point (PocDataset *self,
+					   gdouble x, gdouble y,
+					   guint width, guint height,
+					   gdouble max_distance,
+					   guint *index, gdouble *distance);
 
 G_END_DECLS
 
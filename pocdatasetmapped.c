@@ -0,0 +1,485 @@
+/* This file is part of PocPlot.
+ *
+ * PocPlot is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * PocPlot is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with PocPlot; if not, see
+ * <https://www.gnu.org/licenses/>.
+ *
+ * Copyright 2020 Brian Stafford
+ */
+#include <glib.h>
+#include <string.h>
+#include "pocdatasetmapped.h"
+
+/**
+ * SECTION: pocdatasetmapped
+ * @title:  PocDatasetMapped
+ * @short_description: Memory mapped file dataset for #PocPlot
+ * @see_also: #PocPlot #PocAxis #PocDataset
+ *
+ * A #PocDataset subclass whose points are read directly from a memory mapped
+ * binary file.  The file is never copied into memory; the points are viewed
+ * in place through a pair of #PocVector<!-- -->s and pages are read from disk
+ * by the operating system only when they are accessed.  When the file
+ * declares its X coordinates to be sorted #PocDataset:sorted-x is set, so
+ * only the points within the display range of the X axis are visited when
+ * drawing.  In combination with #PocDataset:decimation this allows recordings
+ * much larger than physical memory to be opened immediately and browsed, with
+ * resident memory bounded by the visible data.
+ *
+ * The file starts with a 32 byte header; all fields are little endian.
+ *
+ * |[
+ * offset  size  field
+ *      0     8  magic, the characters "POCDATA" followed by a NUL byte
+ *      8     4  version, currently 1
+ *     12     4  data type, 1 for IEEE 754 binary64 (double)
+ *                           2 for IEEE 754 binary32 (float)
+ *     16     4  ordering, 0 for interleaved x0 y0 x1 y1 ...
+ *                         1 for planar x0 x1 ... xn-1 y0 y1 ... yn-1
+ *     20     4  flags, bit 0 set when X coordinates are non-decreasing
+ *     24     8  number of points, n
+ *     32        point data
+ * ]|
+ *
+ * The planar ordering is preferred for large files since searching for the
+ * visible range then touches only pages holding X coordinates.  Point data
+ * are read in host byte order so only little endian hosts are supported.
+ * Single precision files halve the memory and disk bandwidth needed to draw
+ * the data; their values are widened to #gdouble only as they are drawn.
+ */
+
+#define HEADER_SIZE		32
+#define HEADER_VERSION		1
+#define DTYPE_F64		1
+#define DTYPE_F32		2
+#define ORDERING_INTERLEAVED	0
+#define ORDERING_PLANAR		1
+#define FLAG_SORTED_X		(1u << 0)
+
+static const gchar header_magic[8] = "POCDATA";
+
+struct _PocDatasetMapped
+  {
+    PocDataset parent_instance;
+
+    gchar		*filename;
+    PocVector		*x_vector;
+    guint		length;
+    gboolean		sorted;
+  };
+
+G_DEFINE_TYPE (PocDatasetMapped, poc_dataset_mapped, POC_TYPE_DATASET)
+
+G_DEFINE_QUARK (poc-dataset-mapped-error-quark, poc_dataset_mapped_error)
+
+/**
+ * poc_dataset_mapped_new:
+ *
+ * Create a new #PocDatasetMapped with no file loaded.
+ *
+ * Returns: (transfer full): New #PocDatasetMapped
+ */
+PocDatasetMapped *
+poc_dataset_mapped_new (void)
+{
+  return g_object_new (POC_TYPE_DATASET_MAPPED, NULL);
+}
+
+/**
+ * poc_dataset_mapped_new_from_file:
+ * @filename: path to a PocPlot data file
+ * @error: return location for a #GError, or %NULL
+ *
+ * Create a new #PocDatasetMapped and load @filename, see
+ * poc_dataset_mapped_load().
+ *
+ * Returns: (transfer full) (nullable): New #PocDatasetMapped or %NULL on error
+ */
+PocDatasetMapped *
+poc_dataset_mapped_new_from_file (const gchar *filename, GError **error)
+{
+  PocDatasetMapped *self;
+
+  g_return_val_if_fail (filename != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  self = poc_dataset_mapped_new ();
+  if (!poc_dataset_mapped_load (self, filename, error))
+    g_clear_object (&self);
+  return self;
+}
+
+enum
+  {
+    PROP_0,
+    PROP_FILENAME,
+    PROP_LENGTH,
+    PROP_SORTED,
+    N_PROPERTIES
+  };
+static GParamSpec *poc_dataset_mapped_prop[N_PROPERTIES];
+
+static void poc_dataset_mapped_finalize (GObject *object);
+static void poc_dataset_mapped_get_property (GObject *object, guint param_id,
+				     GValue *value, GParamSpec *pspec);
+
+static void
+poc_dataset_mapped_class_init (PocDatasetMappedClass *class)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (class);
+
+  gobject_class->finalize = poc_dataset_mapped_finalize;
+  gobject_class->get_property = poc_dataset_mapped_get_property;
+
+  poc_dataset_mapped_prop[PROP_FILENAME] = g_param_spec_string (
+	"filename", "Filename", "Name of the mapped file",
+	NULL,
+	G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+  poc_dataset_mapped_prop[PROP_LENGTH] = g_param_spec_uint (
+	"length", "Length", "Number of points in the mapped file",
+	0, G_MAXUINT, 0,
+	G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+  poc_dataset_mapped_prop[PROP_SORTED] = g_param_spec_boolean (
+	"sorted", "Sorted", "X coordinates in the mapped file are ordered",
+	FALSE,
+	G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+  g_object_class_install_properties (gobject_class, N_PROPERTIES, poc_dataset_mapped_prop);
+}
+
+static void
+poc_dataset_mapped_init (PocDatasetMapped *self)
+{
+  self->filename = NULL;
+  self->x_vector = NULL;
+  self->length = 0;
+  self->sorted = FALSE;
+}
+
+static void
+poc_dataset_mapped_finalize (GObject *object)
+{
+  PocDatasetMapped *self = (PocDatasetMapped *) object;
+
+  g_free (self->filename);
+  if (self->x_vector != NULL)
+    poc_vector_unref (self->x_vector);
+  G_OBJECT_CLASS (poc_dataset_mapped_parent_class)->finalize (object);
+}
+
+static void
+poc_dataset_mapped_get_property (GObject *object, guint prop_id,
+				 GValue *value, GParamSpec *pspec)
+{
+  PocDatasetMapped *self = POC_DATASET_MAPPED (object);
+
+  switch (prop_id)
+    {
+    case PROP_FILENAME:
+      g_value_set_string (value, poc_dataset_mapped_get_filename (self));
+      break;
+    case PROP_LENGTH:
+      g_value_set_uint (value, poc_dataset_mapped_get_length (self));
+      break;
+    case PROP_SORTED:
+      g_value_set_boolean (value, poc_dataset_mapped_get_sorted (self));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+/* file {{{1 */
+
+struct header
+  {
+    guint32	version;
+    guint32	dtype;
+    guint32	ordering;
+    guint32	flags;
+    guint64	count;
+  };
+
+static guint32
+read_le32 (const gchar *p)
+{
+  guint32 v;
+
+  memcpy (&v, p, sizeof v);
+  return GUINT32_FROM_LE (v);
+}
+
+static guint64
+read_le64 (const gchar *p)
+{
+  guint64 v;
+
+  memcpy (&v, p, sizeof v);
+  return GUINT64_FROM_LE (v);
+}
+
+static inline gsize
+dtype_size (guint32 dtype)
+{
+  return dtype == DTYPE_F32 ? sizeof (gfloat) : sizeof (gdouble);
+}
+
+static gboolean
+poc_dataset_mapped_parse_header (const gchar *contents, gsize size,
+				 struct header *header,
+				 const gchar *filename, GError **error)
+{
+  if (contents == NULL || size < HEADER_SIZE
+      || memcmp (contents, header_magic, sizeof header_magic) != 0)
+    {
+      g_set_error (error, POC_DATASET_MAPPED_ERROR,
+		   POC_DATASET_MAPPED_ERROR_INVALID,
+		   "%s: not a PocPlot data file", filename);
+      return FALSE;
+    }
+
+  header->version = read_le32 (contents + 8);
+  header->dtype = read_le32 (contents + 12);
+  header->ordering = read_le32 (contents + 16);
+  header->flags = read_le32 (contents + 20);
+  header->count = read_le64 (contents + 24);
+
+  if (header->version != HEADER_VERSION)
+    {
+      g_set_error (error, POC_DATASET_MAPPED_ERROR,
+		   POC_DATASET_MAPPED_ERROR_UNSUPPORTED,
+		   "%s: unsupported file version %u", filename,
+		   header->version);
+      return FALSE;
+    }
+  if (G_BYTE_ORDER != G_LITTLE_ENDIAN)
+    {
+      g_set_error (error, POC_DATASET_MAPPED_ERROR,
+		   POC_DATASET_MAPPED_ERROR_UNSUPPORTED,
+		   "%s: mapped data files are little-endian; "
+		   "big-endian hosts are not supported", filename);
+      return FALSE;
+    }
+  if (header->dtype != DTYPE_F64 && header->dtype != DTYPE_F32)
+    {
+      g_set_error (error, POC_DATASET_MAPPED_ERROR,
+		   POC_DATASET_MAPPED_ERROR_UNSUPPORTED,
+		   "%s: unsupported data type %u", filename, header->dtype);
+      return FALSE;
+    }
+  if (header->ordering != ORDERING_INTERLEAVED
+      && header->ordering != ORDERING_PLANAR)
+    {
+      g_set_error (error, POC_DATASET_MAPPED_ERROR,
+		   POC_DATASET_MAPPED_ERROR_UNSUPPORTED,
+		   "%s: unsupported ordering %u", filename, header->ordering);
+      return FALSE;
+    }
+  if (header->count > G_MAXUINT)
+    {
+      g_set_error (error, POC_DATASET_MAPPED_ERROR,
+		   POC_DATASET_MAPPED_ERROR_UNSUPPORTED,
+		   "%s: too many points (%" G_GUINT64_FORMAT ")", filename,
+		   header->count);
+      return FALSE;
+    }
+  if (header->count > (size - HEADER_SIZE) / (2 * dtype_size (header->dtype)))
+    {
+      g_set_error (error, POC_DATASET_MAPPED_ERROR,
+		   POC_DATASET_MAPPED_ERROR_TRUNCATED,
+		   "%s: file truncated, expected %" G_GUINT64_FORMAT " points",
+		   filename, header->count);
+      return FALSE;
+    }
+  return TRUE;
+}
+
+static void
+poc_dataset_mapped_file_unref (gpointer data)
+{
+  g_mapped_file_unref (data);
+}
+
+/* View n values of the file's data type starting at element offset */
+static PocVector *
+poc_dataset_mapped_new_vector (GMappedFile *file, const struct header *header,
+			       gsize offset, guint n, gsize stride)
+{
+  gconstpointer data;
+
+  /* The 32 byte header keeps the data naturally aligned for gdouble and
+     gfloat, given the mapping itself is page aligned */
+  data = g_mapped_file_get_contents (file) + HEADER_SIZE;
+  if (header->dtype == DTYPE_F32)
+    return poc_vector_new_float ((const gfloat *) data + offset, n, stride,
+				 poc_dataset_mapped_file_unref,
+				 g_mapped_file_ref (file));
+  return poc_vector_new ((const gdouble *) data + offset, n, stride,
+			 poc_dataset_mapped_file_unref,
+			 g_mapped_file_ref (file));
+}
+
+/**
+ * poc_dataset_mapped_load:
+ * @self: A #PocDatasetMapped
+ * @filename: path to a PocPlot data file
+ * @error: return location for a #GError, or %NULL
+ *
+ * Map @filename into memory and use its contents as the dataset's points,
+ * replacing any previously loaded file, #PocDataset:points or vectors.  The
+ * mapping stays open until the dataset is finalized, another file is loaded
+ * or poc_dataset_mapped_close() is called.  The file must not be truncated
+ * while it is mapped.
+ *
+ * Files are always little-endian; on big-endian hosts loading fails with
+ * %POC_DATASET_MAPPED_ERROR_UNSUPPORTED.
+ *
+ * Returns: %TRUE on success, %FALSE if @error is set
+ */
+gboolean
+poc_dataset_mapped_load (PocDatasetMapped *self,
+			 const gchar *filename, GError **error)
+{
+  GMappedFile *file;
+  struct header header;
+  PocVector *x, *y;
+  guint n;
+
+  g_return_val_if_fail (POC_IS_DATASET_MAPPED (self), FALSE);
+  g_return_val_if_fail (filename != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  file = g_mapped_file_new (filename, FALSE, error);
+  if (file == NULL)
+    return FALSE;
+  if (!poc_dataset_mapped_parse_header (g_mapped_file_get_contents (file),
+					g_mapped_file_get_length (file),
+					&header, filename, error))
+    {
+      g_mapped_file_unref (file);
+      return FALSE;
+    }
+
+  n = header.count;
+  if (header.ordering == ORDERING_PLANAR)
+    {
+      x = poc_dataset_mapped_new_vector (file, &header, 0, n, 1);
+      y = poc_dataset_mapped_new_vector (file, &header, n, n, 1);
+    }
+  else
+    {
+      x = poc_dataset_mapped_new_vector (file, &header, 0, n, 2);
+      y = poc_dataset_mapped_new_vector (file, &header, 1, n, 2);
+    }
+  g_mapped_file_unref (file);
+
+  g_object_freeze_notify (G_OBJECT (self));
+  if (self->x_vector != NULL)
+    poc_vector_unref (self->x_vector);
+  self->x_vector = x;
+  g_free (self->filename);
+  self->filename = g_strdup (filename);
+  self->length = n;
+  self->sorted = (header.flags & FLAG_SORTED_X) != 0;
+  poc_dataset_set_vectors (POC_DATASET (self), x, y);
+  poc_dataset_set_sorted_x (POC_DATASET (self), self->sorted);
+  poc_vector_unref (y);
+  g_object_notify_by_pspec (G_OBJECT (self), poc_dataset_mapped_prop[PROP_FILENAME]);
+  g_object_notify_by_pspec (G_OBJECT (self), poc_dataset_mapped_prop[PROP_LENGTH]);
+  g_object_notify_by_pspec (G_OBJECT (self), poc_dataset_mapped_prop[PROP_SORTED]);
+  g_object_thaw_notify (G_OBJECT (self));
+  return TRUE;
+}
+
+/**
+ * poc_dataset_mapped_close:
+ * @self: A #PocDatasetMapped
+ *
+ * Release the dataset's vectors and unmap the file once no other references
+ * to the vectors remain.
+ */
+void
+poc_dataset_mapped_close (PocDatasetMapped *self)
+{
+  g_return_if_fail (POC_IS_DATASET_MAPPED (self));
+
+  if (self->x_vector == NULL)
+    return;
+
+  g_object_freeze_notify (G_OBJECT (self));
+  if (poc_dataset_get_x_vector (POC_DATASET (self)) == self->x_vector)
+    {
+      poc_dataset_set_vectors (POC_DATASET (self), NULL, NULL);
+      poc_dataset_set_sorted_x (POC_DATASET (self), FALSE);
+    }
+  poc_vector_unref (self->x_vector);
+  self->x_vector = NULL;
+  g_clear_pointer (&self->filename, g_free);
+  self->length = 0;
+  self->sorted = FALSE;
+  g_object_notify_by_pspec (G_OBJECT (self), poc_dataset_mapped_prop[PROP_FILENAME]);
+  g_object_notify_by_pspec (G_OBJECT (self), poc_dataset_mapped_prop[PROP_LENGTH]);
+  g_object_notify_by_pspec (G_OBJECT (self), poc_dataset_mapped_prop[PROP_SORTED]);
+  g_object_thaw_notify (G_OBJECT (self));
+}
+
+/* properties {{{1 */
+
+/**
+ * poc_dataset_mapped_get_filename:
+ * @self: A #PocDatasetMapped
+ *
+ * Get the name of the mapped file.
+ *
+ * Returns: (nullable): the filename or %NULL if no file is loaded
+ */
+const gchar *
+poc_dataset_mapped_get_filename (PocDatasetMapped *self)
+{
+  g_return_val_if_fail (POC_IS_DATASET_MAPPED (self), NULL);
+
+  return self->filename;
+}
+
+/**
+ * poc_dataset_mapped_get_length:
+ * @self: A #PocDatasetMapped
+ *
+ * Get the number of points in the mapped file.
+ *
+ * Returns: number of points
+ */
+guint
+poc_dataset_mapped_get_length (PocDatasetMapped *self)
+{
+  g_return_val_if_fail (POC_IS_DATASET_MAPPED (self), 0);
+
+  return self->length;
+}
+
+/**
+ * poc_dataset_mapped_get_sorted:
+ * @self: A #PocDatasetMapped
+ *
+ * Get whether the mapped file declares its X coordinates to be in
+ * non-decreasing order.
+ *
+ * Returns: %TRUE if the X coordinates are sorted
+ */
+gboolean
+poc_dataset_mapped_get_sorted (PocDatasetMapped *self)
+{
+  g_return_val_if_fail (POC_IS_DATASET_MAPPED (self), FALSE);
+
+  return self->sorted;
+}
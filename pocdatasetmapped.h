@@ -0,0 +1,73 @@
+/* This file is part of PocPlot.
+ *
+ * PocPlot is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * PocPlot is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with PocPlot; if not, see
+ * <https://www.gnu.org/licenses/>.
+ *
+ * Copyright 2020 Brian Stafford
+ */
+#ifndef _pocdatasetmapped_h
+#define _pocdatasetmapped_h
+
+#if !defined(__poc_h_inside__) && !defined(__poc_compile__)
+# error "only <poc.h> can be included directly"
+#endif
+
+#include "pocdataset.h"
+
+G_BEGIN_DECLS
+
+/**
+ * POC_DATASET_MAPPED_ERROR:
+ *
+ * Error domain for #PocDatasetMapped.  Errors in this domain will be from
+ * the #PocDatasetMappedError enumeration.
+ */
+#define POC_DATASET_MAPPED_ERROR		poc_dataset_mapped_error_quark ()
+GQuark		poc_dataset_mapped_error_quark (void);
+
+/**
+ * PocDatasetMappedError:
+ * @POC_DATASET_MAPPED_ERROR_INVALID: The file is not a PocPlot data file.
+ * @POC_DATASET_MAPPED_ERROR_UNSUPPORTED: The file version, data type or
+ * ordering is not supported, or the host is big-endian.
+ * @POC_DATASET_MAPPED_ERROR_TRUNCATED: The file is shorter than its header
+ * indicates.
+ *
+ * Error codes returned when loading a #PocDatasetMapped.
+ */
+typedef enum
+  {
+    POC_DATASET_MAPPED_ERROR_INVALID,
+    POC_DATASET_MAPPED_ERROR_UNSUPPORTED,
+    POC_DATASET_MAPPED_ERROR_TRUNCATED
+  } PocDatasetMappedError;
+
+#define POC_TYPE_DATASET_MAPPED			poc_dataset_mapped_get_type ()
+G_DECLARE_FINAL_TYPE (PocDatasetMapped, poc_dataset_mapped,
+		      POC, DATASET_MAPPED, PocDataset)
+
+PocDatasetMapped *poc_dataset_mapped_new (void);
+PocDatasetMapped *poc_dataset_mapped_new_from_file (const gchar *filename,
+						    GError **error);
+
+gboolean	poc_dataset_mapped_load (PocDatasetMapped *self,
+					 const gchar *filename, GError **error);
+void		poc_dataset_mapped_close (PocDatasetMapped *self);
+const gchar *	poc_dataset_mapped_get_filename (PocDatasetMapped *self);
+guint		poc_dataset_mapped_get_length (PocDatasetMapped *self);
+gboolean	poc_dataset_mapped_get_sorted (PocDatasetMapped *self);
+
+G_END_DECLS
+
+#endif
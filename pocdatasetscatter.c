@@ -0,0 +1,547 @@
+/* This file is part of PocPlot.
+ *
+ * PocPlot is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * PocPlot is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with PocPlot; if not, see
+ * <https://www.gnu.org/licenses/>.
+ *
+ * Copyright 2020 Brian Stafford
+ */
+#include <glib.h>
+#include <math.h>
+#include <string.h>
+#include "pocdatasetscatter.h"
+
+/**
+ * SECTION: pocdatasetscatter
+ * @title:  PocDatasetScatter
+ * @short_description: Scatter plot dataset for #PocPlot
+ * @see_also: #PocPlot #PocAxis #PocDataset
+ *
+ * A #PocDataset subclass which draws a marker at each data point instead of
+ * joining the points with a line.  The marker is rendered once into a small
+ * cached surface which is then stamped at each projected position.  Stamps
+ * are snapped to whole pixels and a marker landing on a pixel which already
+ * holds one is skipped, so that very dense data costs little more to draw
+ * than can be seen.
+ */
+
+struct _PocDatasetScatter
+  {
+    PocDataset parent_instance;
+
+    PocMarkerShape	marker_shape;
+    gdouble		marker_size;
+    GdkRGBA		marker_stroke;
+    GdkRGBA		marker_fill;
+
+    /* Cached marker sprite, valid for the target type and scale */
+    cairo_pattern_t	*sprite;
+    gint		sprite_extent;
+    cairo_surface_type_t sprite_type;
+    gdouble		sprite_scale;
+
+    /* One bit for each sprite position already stamped in this draw */
+    guint32		*occupied;
+    gsize		occupied_len;
+  };
+
+G_DEFINE_TYPE (PocDatasetScatter, poc_dataset_scatter, POC_TYPE_DATASET)
+
+/**
+ * poc_dataset_scatter_new:
+ *
+ * Create a new #PocDatasetScatter
+ *
+ * Returns: (transfer full): New #PocDatasetScatter
+ */
+PocDatasetScatter *
+poc_dataset_scatter_new (void)
+{
+  return g_object_new (POC_TYPE_DATASET_SCATTER, NULL);
+}
+
+enum
+  {
+    PROP_0,
+    PROP_MARKER_SHAPE,
+    PROP_MARKER_SIZE,
+    PROP_MARKER_STROKE,
+    PROP_MARKER_FILL,
+    N_PROPERTIES
+  };
+static GParamSpec *poc_dataset_scatter_prop[N_PROPERTIES];
+
+static void poc_dataset_scatter_finalize (GObject *object);
+static void poc_dataset_scatter_get_property (GObject *object, guint param_id,
+				     GValue *value, GParamSpec *pspec);
+static void poc_dataset_scatter_set_property (GObject *object, guint param_id,
+				     const GValue *value, GParamSpec *pspec);
+static void poc_dataset_scatter_draw (PocDataset *dataset, cairo_t *cr,
+				      guint width, guint height);
+
+static void
+poc_dataset_scatter_class_init (PocDatasetScatterClass *class)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (class);
+  PocDatasetClass *dataset_class = POC_DATASET_CLASS (class);
+
+  gobject_class->finalize = poc_dataset_scatter_finalize;
+  gobject_class->set_property = poc_dataset_scatter_set_property;
+  gobject_class->get_property = poc_dataset_scatter_get_property;
+
+  dataset_class->draw = poc_dataset_scatter_draw;
+
+  poc_dataset_scatter_prop[PROP_MARKER_SHAPE] = g_param_spec_enum (
+	"marker-shape", "Marker Shape", "Shape of the markers",
+	POC_TYPE_MARKER_SHAPE, POC_MARKER_CIRCLE,
+	G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+  poc_dataset_scatter_prop[PROP_MARKER_SIZE] = g_param_spec_double (
+	"marker-size", "Marker Size", "Width of the markers in pixels",
+	1.0, 100.0, 6.0,
+	G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+  poc_dataset_scatter_prop[PROP_MARKER_STROKE] = g_param_spec_boxed (
+  	"marker-stroke",
+	"Marker Stroke Colour", "Colour for stroking markers",
+	GDK_TYPE_RGBA,
+	G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+  poc_dataset_scatter_prop[PROP_MARKER_FILL] = g_param_spec_boxed (
+  	"marker-fill",
+	"Marker Fill Colour", "Colour for filling markers",
+	GDK_TYPE_RGBA,
+	G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+  g_object_class_install_properties (gobject_class, N_PROPERTIES, poc_dataset_scatter_prop);
+}
+
+static void
+poc_dataset_scatter_init (PocDatasetScatter *self)
+{
+  GdkRGBA clear = { 0.0, 0.0, 0.0, 0.0 };
+  GdkRGBA white = { 1.0, 1.0, 1.0, 1.0 };
+
+  self->marker_shape = POC_MARKER_CIRCLE;
+  self->marker_size = 6.0;
+  self->marker_stroke = white;
+  self->marker_fill = clear;
+}
+
+static void
+poc_dataset_scatter_finalize (GObject *object)
+{
+  PocDatasetScatter *self = (PocDatasetScatter *) object;
+
+  if (self->sprite != NULL)
+    cairo_pattern_destroy (self->sprite);
+  g_free (self->occupied);
+  G_OBJECT_CLASS (poc_dataset_scatter_parent_class)->finalize (object);
+}
+
+static void
+poc_dataset_scatter_set_property (GObject *object, guint prop_id,
+				  const GValue *value, GParamSpec *pspec)
+{
+  PocDatasetScatter *self = POC_DATASET_SCATTER (object);
+
+  switch (prop_id)
+    {
+    case PROP_MARKER_SHAPE:
+      poc_dataset_scatter_set_marker_shape (self, g_value_get_enum (value));
+      break;
+    case PROP_MARKER_SIZE:
+      poc_dataset_scatter_set_marker_size (self, g_value_get_double (value));
+      break;
+    case PROP_MARKER_STROKE:
+      poc_dataset_scatter_set_marker_stroke (self, g_value_get_boxed (value));
+      break;
+    case PROP_MARKER_FILL:
+      poc_dataset_scatter_set_marker_fill (self, g_value_get_boxed (value));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      return;
+    }
+}
+
+static void
+poc_dataset_scatter_get_property (GObject *object, guint prop_id,
+				  GValue *value, GParamSpec *pspec)
+{
+  PocDatasetScatter *self = POC_DATASET_SCATTER (object);
+  GdkRGBA rgba;
+
+  switch (prop_id)
+    {
+    case PROP_MARKER_SHAPE:
+      g_value_set_enum (value, poc_dataset_scatter_get_marker_shape (self));
+      break;
+    case PROP_MARKER_SIZE:
+      g_value_set_double (value, poc_dataset_scatter_get_marker_size (self));
+      break;
+    case PROP_MARKER_STROKE:
+      poc_dataset_scatter_get_marker_stroke (self, &rgba);
+      g_value_set_boxed (value, &rgba);
+      break;
+    case PROP_MARKER_FILL:
+      poc_dataset_scatter_get_marker_fill (self, &rgba);
+      g_value_set_boxed (value, &rgba);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+/* Discard the sprite so that it is rendered again on the next draw */
+static void
+poc_dataset_scatter_drop_sprite (PocDatasetScatter *self)
+{
+  if (self->sprite != NULL)
+    {
+      cairo_pattern_destroy (self->sprite);
+      self->sprite = NULL;
+    }
+}
+
+/* properties {{{1 */
+
+/* marker shape {{{2 */
+
+/**
+ * poc_dataset_scatter_set_marker_shape:
+ * @self: A #PocDatasetScatter
+ * @shape: A #PocMarkerShape
+ *
+ * Set the shape of the markers.
+ */
+void
+poc_dataset_scatter_set_marker_shape (PocDatasetScatter *self,
+				      PocMarkerShape shape)
+{
+  g_return_if_fail (POC_IS_DATASET_SCATTER (self));
+
+  if (self->marker_shape != shape)
+    {
+      self->marker_shape = shape;
+      poc_dataset_scatter_drop_sprite (self);
+      poc_dataset_notify_update (POC_DATASET (self));
+      g_object_notify_by_pspec (G_OBJECT (self), poc_dataset_scatter_prop[PROP_MARKER_SHAPE]);
+    }
+}
+
+/**
+ * poc_dataset_scatter_get_marker_shape:
+ * @self: A #PocDatasetScatter
+ *
+ * Get the shape of the markers.
+ *
+ * Returns: a #PocMarkerShape
+ */
+PocMarkerShape
+poc_dataset_scatter_get_marker_shape (PocDatasetScatter *self)
+{
+  g_return_val_if_fail (POC_IS_DATASET_SCATTER (self), POC_MARKER_CIRCLE);
+  return self->marker_shape;
+}
+
+/* marker size {{{2 */
+
+/**
+ * poc_dataset_scatter_set_marker_size:
+ * @self: A #PocDatasetScatter
+ * @size: Marker width in pixels
+ *
+ * Set the width of the markers in pixels, not including the stroke.
+ */
+void
+poc_dataset_scatter_set_marker_size (PocDatasetScatter *self, gdouble size)
+{
+  g_return_if_fail (POC_IS_DATASET_SCATTER (self));
+  g_return_if_fail (size >= 1.0);
+
+  if (self->marker_size != size)
+    {
+      self->marker_size = size;
+      poc_dataset_scatter_drop_sprite (self);
+      poc_dataset_notify_update (POC_DATASET (self));
+      g_object_notify_by_pspec (G_OBJECT (self), poc_dataset_scatter_prop[PROP_MARKER_SIZE]);
+    }
+}
+
+/**
+ * poc_dataset_scatter_get_marker_size:
+ * @self: A #PocDatasetScatter
+ *
+ * Get the width of the markers in pixels.
+ *
+ * Returns: the marker size
+ */
+gdouble
+poc_dataset_scatter_get_marker_size (PocDatasetScatter *self)
+{
+  g_return_val_if_fail (POC_IS_DATASET_SCATTER (self), 0.0);
+  return self->marker_size;
+}
+
+/* marker stroke {{{2 */
+
+/**
+ * poc_dataset_scatter_get_marker_stroke:
+ * @self: A #PocDatasetScatter
+ * @rgba: A #GdkRGBA to receive the marker stroke colour
+ *
+ * Get the colour for stroking markers.
+ */
+void
+poc_dataset_scatter_get_marker_stroke (PocDatasetScatter *self, GdkRGBA *rgba)
+{
+  g_return_if_fail (POC_IS_DATASET_SCATTER (self));
+  g_return_if_fail (rgba != NULL);
+
+  *rgba = self->marker_stroke;
+}
+
+/**
+ * poc_dataset_scatter_set_marker_stroke:
+ * @self: A #PocDatasetScatter
+ * @rgba: A #GdkRGBA
+ *
+ * Set the colour for stroking markers.
+ */
+void
+poc_dataset_scatter_set_marker_stroke (PocDatasetScatter *self, const GdkRGBA *rgba)
+{
+  g_return_if_fail (POC_IS_DATASET_SCATTER (self));
+  g_return_if_fail (rgba != NULL);
+
+  if (!gdk_rgba_equal (&self->marker_stroke, rgba))
+    {
+      self->marker_stroke = *rgba;
+      poc_dataset_scatter_drop_sprite (self);
+      poc_dataset_notify_update (POC_DATASET (self));
+      g_object_notify_by_pspec (G_OBJECT (self), poc_dataset_scatter_prop[PROP_MARKER_STROKE]);
+    }
+}
+
+/* marker fill {{{2 */
+
+/**
+ * poc_dataset_scatter_get_marker_fill:
+ * @self: A #PocDatasetScatter
+ * @rgba: A #GdkRGBA to receive the marker fill colour
+ *
+ * Get the colour for filling markers.
+ */
+void
+poc_dataset_scatter_get_marker_fill (PocDatasetScatter *self, GdkRGBA *rgba)
+{
+  g_return_if_fail (POC_IS_DATASET_SCATTER (self));
+  g_return_if_fail (rgba != NULL);
+
+  *rgba = self->marker_fill;
+}
+
+/**
+ * poc_dataset_scatter_set_marker_fill:
+ * @self: A #PocDatasetScatter
+ * @rgba: A #GdkRGBA
+ *
+ * Set the colour for filling markers.  The fill is not used for
+ * %POC_MARKER_PLUS and %POC_MARKER_CROSS.
+ */
+void
+poc_dataset_scatter_set_marker_fill (PocDatasetScatter *self, const GdkRGBA *rgba)
+{
+  g_return_if_fail (POC_IS_DATASET_SCATTER (self));
+  g_return_if_fail (rgba != NULL);
+
+  if (!gdk_rgba_equal (&self->marker_fill, rgba))
+    {
+      self->marker_fill = *rgba;
+      poc_dataset_scatter_drop_sprite (self);
+      poc_dataset_notify_update (POC_DATASET (self));
+      g_object_notify_by_pspec (G_OBJECT (self), poc_dataset_scatter_prop[PROP_MARKER_FILL]);
+    }
+}
+
+/* draw {{{1 */
+
+/* Add the outline of a marker of radius r centred on cx, cy to the path.
+   Returns TRUE if the shape encloses an area which should be filled. */
+static gboolean
+poc_dataset_scatter_marker_path (cairo_t *cr, PocMarkerShape shape,
+				 gdouble cx, gdouble cy, gdouble r)
+{
+  gdouble d;
+
+  switch (shape)
+    {
+    case POC_MARKER_CIRCLE:
+      cairo_arc (cr, cx, cy, r, 0.0, 2.0 * G_PI);
+      return TRUE;
+    case POC_MARKER_SQUARE:
+      cairo_rectangle (cr, cx - r, cy - r, 2.0 * r, 2.0 * r);
+      return TRUE;
+    case POC_MARKER_DIAMOND:
+      cairo_move_to (cr, cx, cy - r);
+      cairo_line_to (cr, cx + r, cy);
+      cairo_line_to (cr, cx, cy + r);
+      cairo_line_to (cr, cx - r, cy);
+      cairo_close_path (cr);
+      return TRUE;
+    case POC_MARKER_TRIANGLE:
+      /* Equilateral triangle inscribed in the circle of radius r */
+      d = r * 0.8660254037844386;	/* r * sqrt(3) / 2 */
+      cairo_move_to (cr, cx, cy - r);
+      cairo_line_to (cr, cx + d, cy + r / 2.0);
+      cairo_line_to (cr, cx - d, cy + r / 2.0);
+      cairo_close_path (cr);
+      return TRUE;
+    case POC_MARKER_PLUS:
+      cairo_move_to (cr, cx - r, cy);
+      cairo_line_to (cr, cx + r, cy);
+      cairo_move_to (cr, cx, cy - r);
+      cairo_line_to (cr, cx, cy + r);
+      return FALSE;
+    case POC_MARKER_CROSS:
+      d = r / G_SQRT2;
+      cairo_move_to (cr, cx - d, cy - d);
+      cairo_line_to (cr, cx + d, cy + d);
+      cairo_move_to (cr, cx - d, cy + d);
+      cairo_line_to (cr, cx + d, cy - d);
+      return FALSE;
+    }
+  return FALSE;
+}
+
+/* Render the marker into a surface compatible with the target of cr unless
+   the cached sprite is already suitable.  Surfaces created similar to the
+   target inherit its device scale so the sprite is sharp on HiDPI displays;
+   a change of scale or target type forces the sprite to be rendered again. */
+static void
+poc_dataset_scatter_update_sprite (PocDatasetScatter *self, cairo_t *cr)
+{
+  cairo_surface_t *target, *surface;
+  cairo_surface_type_t type;
+  double x_scale, y_scale;
+  gdouble extent, centre;
+  cairo_t *scr;
+
+  target = cairo_get_target (cr);
+  type = cairo_surface_get_type (target);
+  cairo_surface_get_device_scale (target, &x_scale, &y_scale);
+  if (self->sprite != NULL
+      && self->sprite_type == type && self->sprite_scale == x_scale)
+    return;
+  poc_dataset_scatter_drop_sprite (self);
+
+  /* Allow for half the line width on either side */
+  extent = ceil (self->marker_size + 1.0);
+  self->sprite_extent = (gint) extent;
+  self->sprite_type = type;
+  self->sprite_scale = x_scale;
+
+  surface = cairo_surface_create_similar (target, CAIRO_CONTENT_COLOR_ALPHA,
+					  self->sprite_extent,
+					  self->sprite_extent);
+  scr = cairo_create (surface);
+  centre = extent / 2.0;
+  cairo_set_line_width (scr, 1.0);
+  if (poc_dataset_scatter_marker_path (scr, self->marker_shape, centre, centre,
+				       self->marker_size / 2.0))
+    {
+      gdk_cairo_set_source_rgba (scr, &self->marker_fill);
+      cairo_fill_preserve (scr);
+    }
+  gdk_cairo_set_source_rgba (scr, &self->marker_stroke);
+  cairo_stroke (scr);
+  cairo_destroy (scr);
+
+  self->sprite = cairo_pattern_create_for_surface (surface);
+  cairo_surface_destroy (surface);
+}
+
+/* Size and clear the occupancy bitmap for a draw of width x height pixels.
+   Sprite positions range over [-extent, width) x [-extent, height). */
+static void
+poc_dataset_scatter_clear_occupied (PocDatasetScatter *self,
+				    guint width, guint height)
+{
+  gsize bits, len;
+
+  bits = (gsize) (width + self->sprite_extent) * (height + self->sprite_extent);
+  len = (bits + 31) / 32;
+  if (len > self->occupied_len)
+    {
+      g_free (self->occupied);
+      self->occupied = g_new (guint32, len);
+      self->occupied_len = len;
+    }
+  memset (self->occupied, 0, len * sizeof (guint32));
+}
+
+static void
+poc_dataset_scatter_draw (PocDataset *dataset, cairo_t *cr,
+			  guint width, guint height)
+{
+  PocDatasetScatter *self = POC_DATASET_SCATTER (dataset);
+  gsize bit, span;
+  PocPoint buf[256];
+  guint i, j, n, first, end, stamped;
+  gdouble half, ox, oy;
+  gint extent, ix, iy;
+  cairo_matrix_t matrix;
+
+  if (poc_dataset_get_visible_range (dataset, &first, &end) == 0)
+    return;
+
+  poc_dataset_scatter_update_sprite (self, cr);
+  poc_dataset_scatter_clear_occupied (self, width, height);
+  extent = self->sprite_extent;
+  half = extent / 2.0;
+  span = width + extent;
+
+  stamped = 0;
+  cairo_new_path (cr);
+  for (i = first; i < end; i += n)
+    {
+      n = MIN (G_N_ELEMENTS (buf), end - i);
+      poc_dataset_project_range (dataset, i, buf, n, width, height);
+      for (j = 0; j < n; j++)
+	{
+	  /* Snap the sprite origin to the pixel grid */
+	  ox = floor (buf[j].x - half + 0.5);
+	  oy = floor (buf[j].y - half + 0.5);
+
+	  /* Skip markers wholly outside the plot; also rejects NaN */
+	  if (!(ox > -extent && ox < width && oy > -extent && oy < height))
+	    continue;
+
+	  /* Skip markers identical to one already stamped */
+	  ix = (gint) ox + extent;
+	  iy = (gint) oy + extent;
+	  bit = (gsize) iy * span + (gsize) ix;
+	  if (self->occupied[bit / 32] & (1u << (bit % 32)))
+	    continue;
+	  self->occupied[bit / 32] |= 1u << (bit % 32);
+
+	  /* Fill only the sprite's extent, since painting composites the
+	     whole clip region */
+	  cairo_matrix_init_translate (&matrix, -ox, -oy);
+	  cairo_pattern_set_matrix (self->sprite, &matrix);
+	  cairo_set_source (cr, self->sprite);
+	  cairo_rectangle (cr, ox, oy, extent, extent);
+	  cairo_fill (cr);
+	  stamped++;
+	}
+    }
+  poc_dataset_add_draw_stats (dataset, stamped, 0);
+}
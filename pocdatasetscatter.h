@@ -0,0 +1,49 @@
+/* This file is part of PocPlot.
+ *
+ * PocPlot is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * PocPlot is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with PocPlot; if not, see
+ * <https://www.gnu.org/licenses/>.
+ *
+ * Copyright 2020 Brian Stafford
+ */
+#ifndef _pocdatasetscatter_h
+#define _pocdatasetscatter_h
+
+#if !defined(__poc_h_inside__) && !defined(__poc_compile__)
+# error "only <poc.h> can be included directly"
+#endif
+
+#include "pocdataset.h"
+
+G_BEGIN_DECLS
+
+#define POC_TYPE_DATASET_SCATTER		poc_dataset_scatter_get_type ()
+G_DECLARE_FINAL_TYPE (PocDatasetScatter, poc_dataset_scatter,
+		      POC, DATASET_SCATTER, PocDataset)
+
+PocDatasetScatter *poc_dataset_scatter_new (void);
+
+void		poc_dataset_scatter_set_marker_shape (PocDatasetScatter *self,
+						      PocMarkerShape shape);
+PocMarkerShape	poc_dataset_scatter_get_marker_shape (PocDatasetScatter *self);
+void		poc_dataset_scatter_set_marker_size (PocDatasetScatter *self,
+						     gdouble size);
+gdouble		poc_dataset_scatter_get_marker_size (PocDatasetScatter *self);
+void		poc_dataset_scatter_get_marker_stroke (PocDatasetScatter *self, GdkRGBA *rgba);
+void		poc_dataset_scatter_set_marker_stroke (PocDatasetScatter *self, const GdkRGBA *rgba);
+void		poc_dataset_scatter_get_marker_fill (PocDatasetScatter *self, GdkRGBA *rgba);
+void		poc_dataset_scatter_set_marker_fill (PocDatasetScatter *self, const GdkRGBA *rgba);
+
+G_END_DECLS
+
+#endif
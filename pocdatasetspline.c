@@ -19,6 +19,8 @@
 #include <glib.h>
 #include "pocdatasetspline.h"
 #include "pocspline.h"
+#include "poccache.h"
+#include <math.h>
 
 /**
  * SECTION: pocdatasetspline
@@ -29,8 +31,15 @@
  * A #PocDataset subclass which interpolates a curve from the control points
  * based on the algorithm from Numerical Recipies 2nd Edition.
  * Control points may be highlighted by drawing markers at their locations.
+ * With #PocDatasetSpline:async set the curve is computed on a worker thread
+ * so that large sets of control points do not delay redrawing the plot.
+ * With #PocDatasetSpline:adaptive set the curve is sampled densely only where
+ * it bends sharply rather than at a fixed interval across the plot.
  */
 
+/* At most one computation for each entry in the render cache */
+#define SPLINE_MAX_PENDING	4
+
 struct _PocDatasetSpline
   {
     PocDataset parent_instance;
@@ -39,8 +48,27 @@ struct _PocDatasetSpline
     GdkRGBA		marker_fill;
     gboolean		show_markers;
 
+    PocSpline		*spline;
     PocPointArray	*points;
-    guint		cache_width;
+
+    /* Adaptive sampling */
+    gboolean		adaptive;
+    gdouble		tolerance;
+
+    /* Asynchronous computations in progress, see
+       poc_dataset_spline_compute_async() */
+    gboolean		async;
+    struct spline_pending
+      {
+	PocCacheKey	key;
+	gdouble		tolerance;
+	GCancellable	*cancellable;
+	guint64		requested;
+	gboolean	wanted;
+      }			pending[SPLINE_MAX_PENDING];
+    guint		n_pending;
+    guint64		request_serial;
+    guint		sweep_id;
   };
 
 G_DEFINE_TYPE (PocDatasetSpline, poc_dataset_spline, POC_TYPE_DATASET)
@@ -64,6 +92,9 @@ enum
     PROP_MARKER_FILL,
     PROP_MARKER_STROKE,
     PROP_SHOW_MARKERS,
+    PROP_ASYNC,
+    PROP_ADAPTIVE,
+    PROP_TOLERANCE,
     N_PROPERTIES
   };
 static GParamSpec *poc_dataset_spline_prop[N_PROPERTIES];
@@ -76,6 +107,7 @@ static void poc_dataset_spline_set_property (GObject *object, guint param_id,
 static void poc_dataset_spline_draw (PocDataset *dataset, cairo_t *cr,
 				     guint width, guint height);
 static void poc_dataset_spline_invalidate (PocDataset *dataset);
+static void poc_dataset_spline_cancel (PocDatasetSpline *self);
 
 static void
 poc_dataset_spline_class_init (PocDatasetSplineClass *class)
@@ -104,6 +136,19 @@ poc_dataset_spline_class_init (PocDatasetSplineClass *class)
 	"show-markers", "Show Markers", "Show markers on graph lines",
 	FALSE,
 	G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+  poc_dataset_spline_prop[PROP_ASYNC] = g_param_spec_boolean (
+	"async", "Asynchronous", "Compute the curve on a worker thread",
+	FALSE,
+	G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+  poc_dataset_spline_prop[PROP_ADAPTIVE] = g_param_spec_boolean (
+	"adaptive", "Adaptive", "Sample the curve according to its curvature",
+	FALSE,
+	G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+  poc_dataset_spline_prop[PROP_TOLERANCE] = g_param_spec_double (
+	"tolerance", "Tolerance",
+	"Maximum deviation in pixels of adaptively sampled lines from the curve",
+	0.01, 100.0, 0.25,
+	G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
   g_object_class_install_properties (gobject_class, N_PROPERTIES, poc_dataset_spline_prop);
 }
 
@@ -116,6 +161,7 @@ poc_dataset_spline_init (PocDatasetSpline *self)
   self->marker_stroke = white;
   self->marker_fill = clear;
   self->show_markers = FALSE;
+  self->tolerance = 0.25;
 }
 
 static void
@@ -123,6 +169,9 @@ poc_dataset_spline_finalize (GObject *object)
 {
   PocDatasetSpline *self = (PocDatasetSpline *) object;
 
+  poc_dataset_spline_cancel (self);
+  if (self->spline != NULL)
+    poc_spline_unref (self->spline);
   if (self->points != NULL)
     poc_point_array_unref (self->points);
   G_OBJECT_CLASS (poc_dataset_spline_parent_class)->finalize (object);
@@ -145,6 +194,15 @@ poc_dataset_spline_set_property (GObject *object, guint prop_id,
     case PROP_SHOW_MARKERS:
       poc_dataset_spline_set_show_markers (self, g_value_get_boolean (value));
       break;
+    case PROP_ASYNC:
+      poc_dataset_spline_set_async (self, g_value_get_boolean (value));
+      break;
+    case PROP_ADAPTIVE:
+      poc_dataset_spline_set_adaptive (self, g_value_get_boolean (value));
+      break;
+    case PROP_TOLERANCE:
+      poc_dataset_spline_set_tolerance (self, g_value_get_double (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       return;
@@ -171,6 +229,15 @@ poc_dataset_spline_get_property (GObject *object, guint prop_id,
     case PROP_SHOW_MARKERS:
       g_value_set_boolean (value, poc_dataset_spline_get_show_markers (self));
       break;
+    case PROP_ASYNC:
+      g_value_set_boolean (value, poc_dataset_spline_get_async (self));
+      break;
+    case PROP_ADAPTIVE:
+      g_value_set_boolean (value, poc_dataset_spline_get_adaptive (self));
+      break;
+    case PROP_TOLERANCE:
+      g_value_set_double (value, poc_dataset_spline_get_tolerance (self));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -284,6 +351,142 @@ poc_dataset_spline_get_show_markers (PocDatasetSpline *self)
   return self->show_markers;
 }
 
+/* async {{{2 */
+
+/**
+ * poc_dataset_spline_set_async:
+ * @self: A #PocDatasetSpline
+ * @value: %TRUE to compute the curve asynchronously
+ *
+ * Set whether the curve is computed on a worker thread.  When enabled and
+ * the control points, plot width or visible range change, drawing continues
+ * to show the last computed curve, or the control points joined by straight
+ * lines if there is none, while the spline is solved and sampled with a
+ * #GTask.  The dataset is updated when the result is ready; a computation
+ * overtaken by changes to the control points is cancelled and its result
+ * discarded, as is one whose curve is no longer requested once the plots
+ * showing the dataset have been redrawn, for instance after a resize.
+ *
+ * Vectors set with poc_dataset_set_vectors() are read by the worker and must
+ * not be modified while a computation is pending.
+ */
+void
+poc_dataset_spline_set_async (PocDatasetSpline *self, gboolean value)
+{
+  g_return_if_fail (POC_IS_DATASET_SPLINE (self));
+
+  value = !!value;
+  if (self->async == value)
+    return;
+  self->async = value;
+  poc_dataset_spline_cancel (self);
+
+  /* A spline solved on the main thread may share the dataset's point array,
+     which must not be read by a worker */
+  if (self->spline != NULL)
+    {
+      poc_spline_unref (self->spline);
+      self->spline = NULL;
+    }
+  g_object_notify_by_pspec (G_OBJECT (self), poc_dataset_spline_prop[PROP_ASYNC]);
+}
+
+/**
+ * poc_dataset_spline_get_async:
+ * @self: A #PocDatasetSpline
+ *
+ * Get whether the curve is computed on a worker thread.
+ *
+ * Returns: %TRUE if the curve is computed asynchronously.
+ */
+gboolean
+poc_dataset_spline_get_async (PocDatasetSpline *self)
+{
+  g_return_val_if_fail (POC_IS_DATASET_SPLINE (self), FALSE);
+  return self->async;
+}
+
+/* adaptive {{{2 */
+
+/**
+ * poc_dataset_spline_set_adaptive:
+ * @self: A #PocDatasetSpline
+ * @value: %TRUE to sample the curve adaptively
+ *
+ * Set whether the number and placement of points used to draw the curve
+ * depend on its curvature.  When enabled, points are placed so that the
+ * straight lines joining them deviate from the curve by no more than
+ * #PocDatasetSpline:tolerance pixels; nearly straight stretches are drawn
+ * with few points and sharp bends with many.  Otherwise the curve is sampled
+ * every four pixels across the plot.  Adaptive sampling applies only when
+ * both axes are linear.
+ */
+void
+poc_dataset_spline_set_adaptive (PocDatasetSpline *self, gboolean value)
+{
+  g_return_if_fail (POC_IS_DATASET_SPLINE (self));
+
+  value = !!value;
+  if (self->adaptive == value)
+    return;
+  self->adaptive = value;
+  poc_dataset_notify_update (POC_DATASET (self));
+  g_object_notify_by_pspec (G_OBJECT (self), poc_dataset_spline_prop[PROP_ADAPTIVE]);
+}
+
+/**
+ * poc_dataset_spline_get_adaptive:
+ * @self: A #PocDatasetSpline
+ *
+ * Get whether the curve is sampled adaptively.
+ *
+ * Returns: %TRUE if the curve is sampled according to its curvature.
+ */
+gboolean
+poc_dataset_spline_get_adaptive (PocDatasetSpline *self)
+{
+  g_return_val_if_fail (POC_IS_DATASET_SPLINE (self), FALSE);
+  return self->adaptive;
+}
+
+/* tolerance {{{2 */
+
+/**
+ * poc_dataset_spline_set_tolerance:
+ * @self: A #PocDatasetSpline
+ * @value: Tolerance in pixels
+ *
+ * Set the maximum distance in pixels between the curve and the lines drawn
+ * to represent it when #PocDatasetSpline:adaptive is set.
+ */
+void
+poc_dataset_spline_set_tolerance (PocDatasetSpline *self, gdouble value)
+{
+  g_return_if_fail (POC_IS_DATASET_SPLINE (self));
+
+  value = CLAMP (value, 0.01, 100.0);
+  if (self->tolerance == value)
+    return;
+  self->tolerance = value;
+  poc_dataset_notify_update (POC_DATASET (self));
+  g_object_notify_by_pspec (G_OBJECT (self), poc_dataset_spline_prop[PROP_TOLERANCE]);
+}
+
+/**
+ * poc_dataset_spline_get_tolerance:
+ * @self: A #PocDatasetSpline
+ *
+ * Get the tolerance for adaptive sampling.
+ *
+ * Returns: The tolerance in pixels.
+ */
+gdouble
+poc_dataset_spline_get_tolerance (PocDatasetSpline *self)
+{
+  g_return_val_if_fail (POC_IS_DATASET_SPLINE (self), 0.0);
+  return self->tolerance;
+}
+
 /* override class methods {{{1 */
 
 static void
@@ -292,57 +495,536 @@ poc_dataset_spline_invalidate (PocDataset *dataset)
   PocDatasetSpline *self = POC_DATASET_SPLINE (dataset);
 
   POC_DATASET_CLASS (poc_dataset_spline_parent_class)->invalidate (dataset);
+  poc_dataset_spline_cancel (self);
+  if (self->spline != NULL)
+    {
+      poc_spline_unref (self->spline);
+      self->spline = NULL;
+    }
+  /* The sampled curves were discarded with the render cache, but the last
+     one drawn is kept to draw while an asynchronous update is pending */
+}
+
+/* Remove pending computation i, cancelling it if it has not finished */
+static void
+poc_dataset_spline_remove_pending (PocDatasetSpline *self, guint i)
+{
+  g_cancellable_cancel (self->pending[i].cancellable);
+  g_object_unref (self->pending[i].cancellable);
+  self->n_pending -= 1;
+  if (i < self->n_pending)
+    self->pending[i] = self->pending[self->n_pending];
+}
+
+static void
+poc_dataset_spline_cancel (PocDatasetSpline *self)
+{
+  while (self->n_pending > 0)
+    poc_dataset_spline_remove_pending (self, self->n_pending - 1);
+}
+
+/* render cache {{{2 */
+
+/* Sampled curves are kept in the dataset's render cache, see poccache.c,
+   so that plots of different sizes sharing the dataset each find their own
+   curve.  The spline itself is solved once per change to the control
+   points. */
+struct spline_samples
+  {
+    PocPointArray	*points;
+    gdouble		tolerance;
+  };
+
+static const gchar spline_cache_tag[] = "spline";
+
+static void
+spline_samples_free (gpointer data)
+{
+  struct spline_samples *samples = data;
+
+  poc_point_array_unref (samples->points);
+  g_free (samples);
+}
+
+/* Look up the curve for drawing at width by height and make it the one
+   drawn.  Returns FALSE if it must be computed, along with the cache key
+   and the pixel scales for adaptive sampling, which are zero if it does not
+   apply. */
+static gboolean
+poc_dataset_spline_find (PocDatasetSpline *self, guint width, guint height,
+			 PocCacheKey *key, gdouble *x_scale, gdouble *y_scale)
+{
+  PocDataset *dataset = POC_DATASET (self);
+  struct spline_samples *samples;
+  PocAxis *x_axis, *y_axis;
+  gdouble offset, tolerance;
+
+  x_axis = poc_dataset_get_x_axis (dataset);
+  y_axis = poc_dataset_get_y_axis (dataset);
+  poc_cache_key_init (key, spline_cache_tag, x_axis, y_axis, width, height);
+
+  *x_scale = *y_scale = 0.0;
+  if (self->adaptive
+      && key->x_mode == POC_AXIS_LINEAR && key->y_mode == POC_AXIS_LINEAR)
+    {
+      poc_axis_get_projection (x_axis, width, x_scale, &offset);
+      poc_axis_get_projection (y_axis, -height, y_scale, &offset);
+      *x_scale = fabs (*x_scale);
+      *y_scale = fabs (*y_scale);
+      if (!(*x_scale > 0.0 && *y_scale > 0.0))
+	*x_scale = *y_scale = 0.0;
+    }
+  tolerance = *y_scale > 0.0 ? self->tolerance : 0.0;
+
+  samples = poc_cache_lookup (poc_dataset_get_cache (dataset), key);
+  if (samples == NULL || samples->tolerance != tolerance)
+    return FALSE;
+  if (self->points != samples->points)
+    {
+      if (self->points != NULL)
+	poc_point_array_unref (self->points);
+      self->points = poc_point_array_ref (samples->points);
+    }
+  return TRUE;
+}
+
+/* Cache a computed curve, taking ownership of points, and draw it */
+static void
+poc_dataset_spline_store (PocDatasetSpline *self, const PocCacheKey *key,
+			  PocPointArray *points, gdouble tolerance)
+{
+  struct spline_samples *samples;
+
+  samples = g_new (struct spline_samples, 1);
+  samples->points = points;
+  samples->tolerance = tolerance;
+  poc_cache_insert (poc_dataset_get_cache (POC_DATASET (self)), key,
+		    samples, spline_samples_free);
+
   if (self->points != NULL)
+    poc_point_array_unref (self->points);
+  self->points = poc_point_array_ref (points);
+}
+
+/* asynchronous computation {{{2 */
+
+/* Work for a computation on a worker thread.  The worker solves the spline
+   if there is not already one and samples it over the visible range.  */
+struct spline_task
+  {
+    PocSpline		*spline;
+    PocVector		*x_vector;
+    PocVector		*y_vector;
+    PocPointArray	*control;
+    PocCacheKey		key;
+    guint		n_samples;
+    gdouble		x_scale;
+    gdouble		y_scale;
+    gdouble		tolerance;
+    PocPointArray	*points;
+  };
+
+static void
+spline_task_free (gpointer data)
+{
+  struct spline_task *task_data = data;
+
+  if (task_data->spline != NULL)
+    poc_spline_unref (task_data->spline);
+  if (task_data->x_vector != NULL)
+    poc_vector_unref (task_data->x_vector);
+  if (task_data->y_vector != NULL)
+    poc_vector_unref (task_data->y_vector);
+  if (task_data->control != NULL)
+    poc_point_array_unref (task_data->control);
+  if (task_data->points != NULL)
+    poc_point_array_unref (task_data->points);
+  g_free (task_data);
+}
+
+static void
+poc_dataset_spline_thread (GTask *task, G_GNUC_UNUSED gpointer source_object,
+			   gpointer data, G_GNUC_UNUSED GCancellable *cancellable)
+{
+  struct spline_task *task_data = data;
+
+  if (task_data->spline == NULL)
+    {
+      if (task_data->x_vector != NULL)
+	task_data->spline = poc_spline_new_vectors (task_data->x_vector,
+						    task_data->y_vector);
+      else
+	task_data->spline = poc_spline_new (task_data->control);
+    }
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  if (task_data->tolerance > 0.0)
+    task_data->points = poc_spline_sample_adaptive (task_data->spline,
+						    task_data->key.x_lower,
+						    task_data->key.x_upper,
+						    task_data->x_scale,
+						    task_data->y_scale,
+						    task_data->tolerance);
+  else
+    task_data->points = poc_spline_sample_points (task_data->spline,
+						  task_data->key.x_lower,
+						  task_data->key.x_upper,
+						  task_data->n_samples);
+  if (!g_task_return_error_if_cancelled (task))
+    g_task_return_boolean (task, TRUE);
+}
+
+static void
+poc_dataset_spline_ready (GObject *source_object, GAsyncResult *result,
+			  G_GNUC_UNUSED gpointer user_data)
+{
+  PocDatasetSpline *self = POC_DATASET_SPLINE (source_object);
+  struct spline_task *task_data;
+  GTask *task = G_TASK (result);
+  guint i;
+
+  /* Ignore cancelled or superseded computations */
+  if (!g_task_propagate_boolean (task, NULL))
+    return;
+  for (i = 0; i < self->n_pending; i++)
+    if (self->pending[i].cancellable == g_task_get_cancellable (task))
+      break;
+  if (i == self->n_pending)
+    return;
+  poc_dataset_spline_remove_pending (self, i);
+
+  task_data = g_task_get_task_data (task);
+  if (self->spline == NULL)
+    self->spline = poc_spline_ref (task_data->spline);
+  poc_dataset_spline_store (self, &task_data->key,
+			    poc_point_array_ref (task_data->points),
+			    task_data->tolerance);
+  poc_dataset_notify_update (POC_DATASET (self));
+}
+
+/* Runs once the plots have finished drawing after a request.  Cancel the
+   computations not requested again since the last sweep; their curves have
+   been superseded by a resize, pan or zoom.  A plot that was not redrawn
+   meanwhile may still want one, so the plots are asked to redraw and
+   request the curves they need again. */
+static gboolean
+poc_dataset_spline_sweep (gpointer user_data)
+{
+  PocDatasetSpline *self = user_data;
+  gboolean cancelled = FALSE;
+  guint i;
+
+  self->sweep_id = 0;
+  for (i = self->n_pending; i-- > 0; )
+    if (!self->pending[i].wanted)
+      {
+	poc_dataset_spline_remove_pending (self, i);
+	cancelled = TRUE;
+      }
+    else
+      self->pending[i].wanted = FALSE;
+  if (cancelled)
+    poc_dataset_notify_update (POC_DATASET (self));
+  return G_SOURCE_REMOVE;
+}
+
+/* Record a request for the curve to be computed with tolerance.  Returns
+   FALSE if it is not already being computed. */
+static gboolean
+poc_dataset_spline_request (PocDatasetSpline *self, const PocCacheKey *key,
+			    gdouble tolerance)
+{
+  guint i;
+
+  if (self->sweep_id == 0)
+    self->sweep_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+				      poc_dataset_spline_sweep,
+				      g_object_ref (self), g_object_unref);
+
+  for (i = 0; i < self->n_pending; i++)
+    if (poc_cache_key_equal (&self->pending[i].key, key)
+	&& self->pending[i].tolerance == tolerance)
+      {
+	self->pending[i].wanted = TRUE;
+	self->pending[i].requested = ++self->request_serial;
+	return TRUE;
+      }
+  return FALSE;
+}
+
+/* Several computations may be in progress so that plots of different sizes
+   sharing the dataset each receive their curve.  A computation is cancelled
+   when its curve is no longer requested by any plot as they are redrawn, or
+   to make room for a new one, in which case the least recently requested is
+   cancelled. */
+static void
+poc_dataset_spline_compute_async (PocDatasetSpline *self,
+				  const PocCacheKey *key,
+				  gdouble x_scale, gdouble y_scale)
+{
+  PocDataset *dataset = POC_DATASET (self);
+  struct spline_task *task_data;
+  struct spline_pending *pending;
+  PocPointArray *points;
+  gdouble tolerance;
+  GTask *task;
+  guint i, oldest;
+
+  tolerance = y_scale > 0.0 ? self->tolerance : 0.0;
+  if (poc_dataset_spline_request (self, key, tolerance))
+    return;
+
+  if (self->n_pending == SPLINE_MAX_PENDING)
+    {
+      oldest = 0;
+      for (i = 1; i < self->n_pending; i++)
+	if (self->pending[i].requested < self->pending[oldest].requested)
+	  oldest = i;
+      poc_dataset_spline_remove_pending (self, oldest);
+    }
+
+  task_data = g_new0 (struct spline_task, 1);
+  if (self->spline != NULL)
+    task_data->spline = poc_spline_ref (self->spline);
+  else if (poc_dataset_get_x_vector (dataset) != NULL)
     {
-      poc_point_array_unref (self->points);
-      self->points = NULL;
+      task_data->x_vector = poc_vector_ref (poc_dataset_get_x_vector (dataset));
+      task_data->y_vector = poc_vector_ref (poc_dataset_get_y_vector (dataset));
     }
+  else
+    {
+      /* The point array may be appended to in place, so copy it */
+      points = poc_dataset_get_points (dataset);
+      task_data->control = poc_point_array_sized_new (points->len);
+      poc_point_array_append_vals (task_data->control, points->data,
+				   points->len);
+    }
+  task_data->key = *key;
+  task_data->n_samples = key->width / 4 + 1;
+  task_data->x_scale = x_scale;
+  task_data->y_scale = y_scale;
+  task_data->tolerance = tolerance;
+
+  pending = &self->pending[self->n_pending++];
+  pending->key = *key;
+  pending->tolerance = tolerance;
+  pending->cancellable = g_cancellable_new ();
+  pending->requested = ++self->request_serial;
+  pending->wanted = TRUE;
+
+  task = g_task_new (self, pending->cancellable, poc_dataset_spline_ready, NULL);
+  g_task_set_task_data (task, task_data, spline_task_free);
+  g_task_run_in_thread (task, poc_dataset_spline_thread);
+  g_object_unref (task);
 }
 
+/* batch computation {{{2 */
+
+/* Describe the curve to be computed.  Returns the array to receive uniform
+   samples, or NULL if the curve is sampled adaptively. */
+static PocPointArray *
+poc_dataset_spline_batch_init (PocDatasetSpline *self, PocSplineBatch *item,
+			       const PocCacheKey *key,
+			       gdouble x_scale, gdouble y_scale)
+{
+  PocDataset *dataset = POC_DATASET (self);
+  PocPointArray *uniform;
+  guint veclen;
+
+  item->points = NULL;
+  item->x = item->y = NULL;
+  item->spline = self->spline;
+  if (self->spline == NULL)
+    {
+      if (poc_dataset_get_x_vector (dataset) != NULL)
+	{
+	  item->x = poc_dataset_get_x_vector (dataset);
+	  item->y = poc_dataset_get_y_vector (dataset);
+	}
+      else
+	item->points = poc_dataset_get_points (dataset);
+    }
+  item->min_x = key->x_lower;
+  item->max_x = key->x_upper;
+  item->x_scale = x_scale;
+  item->y_scale = y_scale;
+  item->samples = NULL;
+
+  /* Adaptive samples are returned in a new array */
+  if (y_scale > 0.0)
+    {
+      item->tolerance = self->tolerance;
+      item->out = NULL;
+      item->veclen = 0;
+      return NULL;
+    }
+
+  item->tolerance = 0.0;
+  veclen = key->width / 4 + 1;
+  uniform = poc_point_array_sized_new (veclen);
+  poc_point_array_set_size (uniform, veclen);
+  item->out = uniform->data;
+  item->veclen = veclen;
+  return uniform;
+}
+
+/* Keep the solved spline and cache the samples */
+static void
+poc_dataset_spline_batch_done (PocDatasetSpline *self, PocSplineBatch *item,
+			       const PocCacheKey *key, PocPointArray *uniform)
+{
+  if (self->spline == NULL)
+    self->spline = item->spline;
+  if (item->samples != NULL)
+    poc_dataset_spline_store (self, key, item->samples, item->tolerance);
+  else if (uniform != NULL && item->spline != NULL)
+    poc_dataset_spline_store (self, key, uniform, 0.0);
+  else if (uniform != NULL)
+    poc_point_array_unref (uniform);
+}
+
+struct spline_update
+  {
+    PocDatasetSpline	*dataset;
+    PocCacheKey		key;
+    PocPointArray	*uniform;
+  };
+
+/**
+ * poc_dataset_spline_update_batch:
+ * @datasets: (array length=n): An array of #PocDatasetSpline
+ * @n: The number of datasets
+ * @width: Width of the plot area
+ * @height: Height of the plot area
+ *
+ * Bring the curves of several datasets up to date for drawing at @width by
+ * @height.
+ * The stale curves are solved and sampled in parallel using
+ * poc_spline_solve_batch() so that a subsequent poc_dataset_draw() of each
+ * dataset need only stroke its curve.  Datasets with #PocDatasetSpline:async
+ * set are skipped since they compute their curves on a worker thread.  Used
+ * by #PocPlot before drawing its datasets.
+ */
+void
+poc_dataset_spline_update_batch (PocDatasetSpline **datasets, guint n,
+				 guint width, guint height)
+{
+  PocDatasetSpline *self;
+  PocSplineBatch *batch;
+  struct spline_update *update;
+  gdouble x_scale, y_scale;
+  guint i, count;
+
+  g_return_if_fail (datasets != NULL || n == 0);
+  for (i = 0; i < n; i++)
+    g_return_if_fail (POC_IS_DATASET_SPLINE (datasets[i]));
+
+  batch = g_new (PocSplineBatch, n);
+  update = g_new (struct spline_update, n);
+  count = 0;
+  for (i = 0; i < n; i++)
+    {
+      self = datasets[i];
+      if (self->async
+	  || poc_dataset_get_x_axis (POC_DATASET (self)) == NULL
+	  || poc_dataset_get_y_axis (POC_DATASET (self)) == NULL
+	  || poc_dataset_get_data_vectors (POC_DATASET (self), NULL, NULL) < 2
+	  || poc_dataset_spline_find (self, width, height, &update[count].key,
+				      &x_scale, &y_scale))
+	continue;
+      update[count].dataset = self;
+      update[count].uniform = poc_dataset_spline_batch_init (self,
+							      &batch[count],
+							      &update[count].key,
+							      x_scale, y_scale);
+      count++;
+    }
+
+  poc_spline_solve_batch (batch, count);
+  for (i = 0; i < count; i++)
+    poc_dataset_spline_batch_done (update[i].dataset, &batch[i],
+				   &update[i].key, update[i].uniform);
+
+  g_free (batch);
+  g_free (update);
+}
+
+/* draw {{{2 */
+
 static void
 poc_dataset_spline_draw (PocDataset *dataset, cairo_t *cr,
 			 guint width, guint height)
 {
   PocDatasetSpline *self = POC_DATASET_SPLINE (dataset);
-  PocPointArray *spline;
-  gdouble min_x, max_x;
-  PocPoint p;
-  guint i;
-  PocAxis *x_axis, *y_axis;
+  gdouble x_scale, y_scale;
+  PocPoint buf[256];
+  guint i, j, n, len, n_points, first, end;
   GdkRGBA line_stroke;
   PocLineStyle line_style;
   const double *dashes;
   int num_dashes;
+  PocSplineBatch item;
+  PocPointArray *uniform;
+  PocCacheKey key;
 
-  spline = poc_dataset_get_points (POC_DATASET (self));
-  if (spline == NULL)
+  n_points = poc_dataset_get_data_vectors (dataset, NULL, NULL);
+  if (n_points < 2)
     return;
 
-  x_axis = poc_dataset_get_x_axis (dataset);
-  y_axis = poc_dataset_get_y_axis (dataset);
   poc_dataset_get_line_stroke (dataset, &line_stroke);
   line_style = poc_dataset_get_line_style (dataset);
 
-  if (self->points == NULL || self->cache_width != width)
+  if (!poc_dataset_spline_find (self, width, height, &key,
+				&x_scale, &y_scale))
     {
-      self->cache_width = width;
-      poc_axis_get_display_range (x_axis, &min_x, &max_x);
-      if (self->points != NULL)
-	poc_point_array_unref (self->points);
-      self->points = poc_spline_get_points (spline, min_x, max_x,
-      					    width / 4 + 1);
+      if (self->async)
+	poc_dataset_spline_compute_async (self, &key, x_scale, y_scale);
+      else
+	{
+	  uniform = poc_dataset_spline_batch_init (self, &item, &key,
+						   x_scale, y_scale);
+	  poc_spline_solve_batch (&item, 1);
+	  poc_dataset_spline_batch_done (self, &item, &key, uniform);
+	}
     }
 
-  /* Draw the plot line */
+  /* Draw the plot line.  While a computation is pending this is the last
+     computed curve or, failing that, the control points joined by lines. */
   cairo_new_path (cr);
-  p = poc_point_array_index (self->points, 0);
-  cairo_move_to (cr, poc_axis_project (x_axis, p.x, width),
-		     poc_axis_project (y_axis, p.y, -height));
-  for (i = 1; i < poc_point_array_len (self->points); i++)
+  if (self->points != NULL)
     {
-      p = poc_point_array_index (self->points, i);
-      cairo_line_to (cr, poc_axis_project (x_axis, p.x, width),
-			 poc_axis_project (y_axis, p.y, -height));
+      len = poc_point_array_len (self->points);
+      for (i = 0; i < len; i += n)
+	{
+	  n = MIN (G_N_ELEMENTS (buf), len - i);
+	  poc_dataset_project_points (dataset,
+				      &poc_point_array_index (self->points, i),
+				      buf, n, width, height);
+	  for (j = 0; j < n; j++)
+	    if (i + j == 0)
+	      cairo_move_to (cr, buf[j].x, buf[j].y);
+	    else
+	      cairo_line_to (cr, buf[j].x, buf[j].y);
+	}
+      if (len > 0)
+	poc_dataset_add_draw_stats (dataset, len, len - 1);
+    }
+  else
+    {
+      poc_dataset_get_visible_range (dataset, &first, &end);
+      for (i = first; i < end; i += n)
+	{
+	  n = MIN (G_N_ELEMENTS (buf), end - i);
+	  poc_dataset_project_range (dataset, i, buf, n, width, height);
+	  for (j = 0; j < n; j++)
+	    if (i + j == first)
+	      cairo_move_to (cr, buf[j].x, buf[j].y);
+	    else
+	      cairo_line_to (cr, buf[j].x, buf[j].y);
+	}
+      if (end > first)
+	poc_dataset_add_draw_stats (dataset, end - first, end - first - 1);
     }
 
   /* Stroke the line */
@@ -356,14 +1038,17 @@ poc_dataset_spline_draw (PocDataset *dataset, cairo_t *cr,
   if (self->show_markers)
     {
       cairo_new_path (cr);
-      for (i = 0; i < poc_point_array_len (spline); i++)
+      poc_dataset_get_visible_range (dataset, &first, &end);
+      for (i = first; i < end; i += n)
 	{
-	  cairo_new_sub_path (cr);
-	  //TODO Marker size and style properties
-	  p = poc_point_array_index (spline, i);
-	  cairo_arc (cr, poc_axis_project (x_axis, p.x, width),
-			 poc_axis_project (y_axis, p.y, -height),
-		     3, 0.0, 2.0 * G_PI);
+	  n = MIN (G_N_ELEMENTS (buf), end - i);
+	  poc_dataset_project_range (dataset, i, buf, n, width, height);
+	  for (j = 0; j < n; j++)
+	    {
+	      cairo_new_sub_path (cr);
+	      //TODO Marker size and style properties
+	      cairo_arc (cr, buf[j].x, buf[j].y, 3, 0.0, 2.0 * G_PI);
+	    }
 	}
       gdk_cairo_set_source_rgba (cr, &self->marker_fill);
       cairo_fill_preserve (cr);
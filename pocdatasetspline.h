@@ -39,6 +39,15 @@ void		poc_dataset_spline_get_marker_fill (PocDatasetSpline *self, GdkRGBA *rgba)
 void		poc_dataset_spline_set_marker_fill (PocDatasetSpline *self, const GdkRGBA *rgba);
 gboolean	poc_dataset_spline_get_show_markers (PocDatasetSpline *self);
 void		poc_dataset_spline_set_show_markers (PocDatasetSpline *self, gboolean value);
+gboolean	poc_dataset_spline_get_async (PocDatasetSpline *self);
+void		poc_dataset_spline_set_async (PocDatasetSpline *self, gboolean value);
+gboolean	poc_dataset_spline_get_adaptive (PocDatasetSpline *self);
+void		poc_dataset_spline_set_adaptive (PocDatasetSpline *self, gboolean value);
+gdouble		poc_dataset_spline_get_tolerance (PocDatasetSpline *self);
+void		poc_dataset_spline_set_tolerance (PocDatasetSpline *self, gdouble value);
+void		poc_dataset_spline_update_batch (PocDatasetSpline **datasets,
+						 guint n, guint width,
+						 guint height);
 
 G_END_DECLS
 
@@ -0,0 +1,773 @@
+/* This file is part of PocPlot.
+ *
+ * PocPlot is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * PocPlot is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with PocPlot; if not, see
+ * <https://www.gnu.org/licenses/>.
+ *
+ * Copyright 2020 Brian Stafford
+ */
+#include <glib.h>
+#include <string.h>
+#include "pocdatasetstream.h"
+
+/**
+ * SECTION: pocdatasetstream
+ * @title:  PocDatasetStream
+ * @short_description: Streaming dataset for #PocPlot
+ * @see_also: #PocPlot #PocAxis #PocDataset
+ *
+ * A #PocDataset subclass for live data.  Points are appended to a fixed
+ * capacity ring buffer with poc_dataset_stream_append(); once the buffer is
+ * full the oldest points are discarded.  The history window optionally
+ * discards points whose x coordinate is older than the newest point by more
+ * than a given amount.
+ *
+ * The plot line is rendered to an offscreen surface which is retained between
+ * redraws.  If the axes, the plot size and the line appearance are unchanged
+ * since the previous redraw, only the segment joining the newly appended
+ * points is projected and stroked.  Points are assumed to be appended in
+ * increasing x order.  Discarding points normally requires the whole line to
+ * be redrawn, except when all the discarded points lie before the start of
+ * the visible range of the x axis.
+ *
+ * Points may also be supplied from another thread with
+ * poc_dataset_stream_push() once a producer queue has been allocated by
+ * setting #PocDatasetStream:queue-size.  Pushing points to an empty queue
+ * asks the plot for a new frame and the queue is drained into the ring buffer
+ * on the main thread when the plot prepares it.
+ */
+
+struct _PocDatasetStream
+  {
+    PocDataset parent_instance;
+
+    /* Ring buffer */
+    PocPoint		*ring;
+    guint		capacity;
+    guint		head;
+    guint		len;
+    gdouble		history;
+
+    /* Count of points ever appended */
+    guint64		serial;
+
+    /* Points discarded since the last redraw */
+    gboolean		evicted;
+    gdouble		evicted_x;
+
+    /* Incremental redraw */
+    cairo_surface_t	*cache;
+    guint		cache_width;
+    guint		cache_height;
+    guint64		cache_serial;
+    PocAxis		*cache_x_axis;
+    PocAxis		*cache_y_axis;
+    PocAxisMode		cache_x_mode;
+    PocAxisMode		cache_y_mode;
+    gdouble		cache_projection[4];
+    GdkRGBA		cache_stroke;
+    PocLineStyle	cache_style;
+
+    /* Single producer, single consumer queue.  queue_tail is written only
+       by the producer and queue_head only by the main thread; both count
+       points ever queued and wrap freely.  queue_wakeup is set by the
+       producer when it schedules poc_dataset_stream_wakeup() and cleared
+       by the latter.  */
+    PocPoint		*queue;
+    guint		queue_size;
+    gint		queue_head;
+    gint		queue_tail;
+    gint		queue_wakeup;
+  };
+
+G_DEFINE_TYPE (PocDatasetStream, poc_dataset_stream, POC_TYPE_DATASET)
+
+/**
+ * poc_dataset_stream_new:
+ * @capacity: maximum number of points retained
+ *
+ * Create a new #PocDatasetStream
+ *
+ * Returns: (transfer full): New #PocDatasetStream
+ */
+PocDatasetStream *
+poc_dataset_stream_new (guint capacity)
+{
+  return g_object_new (POC_TYPE_DATASET_STREAM, "capacity", capacity, NULL);
+}
+
+enum
+  {
+    PROP_0,
+    PROP_CAPACITY,
+    PROP_HISTORY,
+    PROP_QUEUE_SIZE,
+    N_PROPERTIES
+  };
+static GParamSpec *poc_dataset_stream_prop[N_PROPERTIES];
+
+static void poc_dataset_stream_finalize (GObject *object);
+static void poc_dataset_stream_get_property (GObject *object, guint param_id,
+				     GValue *value, GParamSpec *pspec);
+static void poc_dataset_stream_set_property (GObject *object, guint param_id,
+				     const GValue *value, GParamSpec *pspec);
+static void poc_dataset_stream_draw (PocDataset *dataset, cairo_t *cr,
+				     guint width, guint height);
+static void poc_dataset_stream_invalidate (PocDataset *dataset);
+static gboolean poc_dataset_stream_prepare (PocDataset *dataset);
+
+static void
+poc_dataset_stream_class_init (PocDatasetStreamClass *class)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (class);
+  PocDatasetClass *dataset_class = POC_DATASET_CLASS (class);
+
+  gobject_class->finalize = poc_dataset_stream_finalize;
+  gobject_class->set_property = poc_dataset_stream_set_property;
+  gobject_class->get_property = poc_dataset_stream_get_property;
+
+  dataset_class->draw = poc_dataset_stream_draw;
+  dataset_class->invalidate = poc_dataset_stream_invalidate;
+  dataset_class->prepare = poc_dataset_stream_prepare;
+
+  poc_dataset_stream_prop[PROP_CAPACITY] = g_param_spec_uint (
+	"capacity", "Capacity", "Maximum number of points retained",
+	1, G_MAXUINT, 1024,
+	G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_EXPLICIT_NOTIFY
+	| G_PARAM_STATIC_STRINGS);
+  poc_dataset_stream_prop[PROP_HISTORY] = g_param_spec_double (
+	"history", "History", "Range of X values retained, zero for unlimited",
+	0.0, G_MAXDOUBLE, 0.0,
+	G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+  poc_dataset_stream_prop[PROP_QUEUE_SIZE] = g_param_spec_uint (
+	"queue-size", "Queue Size",
+	"Number of points the producer queue holds, zero for none",
+	0, G_MAXINT / 2 + 1, 0,
+	G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+  g_object_class_install_properties (gobject_class, N_PROPERTIES, poc_dataset_stream_prop);
+}
+
+static void
+poc_dataset_stream_init (PocDatasetStream *self)
+{
+  self->capacity = 0;
+  self->history = 0.0;
+}
+
+static void
+poc_dataset_stream_finalize (GObject *object)
+{
+  PocDatasetStream *self = (PocDatasetStream *) object;
+
+  g_free (self->ring);
+  g_free (self->queue);
+  if (self->cache != NULL)
+    cairo_surface_destroy (self->cache);
+  G_OBJECT_CLASS (poc_dataset_stream_parent_class)->finalize (object);
+}
+
+static void
+poc_dataset_stream_set_property (GObject *object, guint prop_id,
+				 const GValue *value, GParamSpec *pspec)
+{
+  PocDatasetStream *self = POC_DATASET_STREAM (object);
+
+  switch (prop_id)
+    {
+    case PROP_CAPACITY:
+      poc_dataset_stream_set_capacity (self, g_value_get_uint (value));
+      break;
+    case PROP_HISTORY:
+      poc_dataset_stream_set_history (self, g_value_get_double (value));
+      break;
+    case PROP_QUEUE_SIZE:
+      poc_dataset_stream_set_queue_size (self, g_value_get_uint (value));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      return;
+    }
+}
+
+static void
+poc_dataset_stream_get_property (GObject *object, guint prop_id,
+				 GValue *value, GParamSpec *pspec)
+{
+  PocDatasetStream *self = POC_DATASET_STREAM (object);
+
+  switch (prop_id)
+    {
+    case PROP_CAPACITY:
+      g_value_set_uint (value, poc_dataset_stream_get_capacity (self));
+      break;
+    case PROP_HISTORY:
+      g_value_set_double (value, poc_dataset_stream_get_history (self));
+      break;
+    case PROP_QUEUE_SIZE:
+      g_value_set_uint (value, poc_dataset_stream_get_queue_size (self));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+/* ring buffer {{{1 */
+
+#define ring_index(s,i)	(((s)->head + (i)) % (s)->capacity)
+#define ring_at(s,i)	((s)->ring[ring_index ((s), (i))])
+
+static void
+poc_dataset_stream_evict (PocDatasetStream *self, guint n)
+{
+  guint i;
+
+  for (i = 0; i < n; i++)
+    if (!self->evicted || ring_at (self, i).x > self->evicted_x)
+      {
+	self->evicted_x = ring_at (self, i).x;
+	self->evicted = TRUE;
+      }
+  self->head = ring_index (self, n);
+  self->len -= n;
+}
+
+static gboolean
+poc_dataset_stream_trim_history (PocDatasetStream *self)
+{
+  gdouble oldest;
+  guint n;
+
+  if (self->history <= 0.0 || self->len == 0)
+    return FALSE;
+
+  oldest = ring_at (self, self->len - 1).x - self->history;
+  for (n = 0; n < self->len && ring_at (self, n).x < oldest; n++)
+    ;
+  poc_dataset_stream_evict (self, n);
+  return n > 0;
+}
+
+static void
+poc_dataset_stream_drop_cache (PocDatasetStream *self)
+{
+  if (self->cache != NULL)
+    {
+      cairo_surface_destroy (self->cache);
+      self->cache = NULL;
+    }
+}
+
+/* properties {{{1 */
+
+/* capacity {{{2 */
+
+/**
+ * poc_dataset_stream_set_capacity:
+ * @self: A #PocDatasetStream
+ * @capacity: maximum number of points retained
+ *
+ * Set the capacity of the ring buffer.  If the buffer holds more than
+ * @capacity points the oldest are discarded.
+ */
+void
+poc_dataset_stream_set_capacity (PocDatasetStream *self, guint capacity)
+{
+  PocPoint *ring;
+  guint i, skip;
+
+  g_return_if_fail (POC_IS_DATASET_STREAM (self));
+  g_return_if_fail (capacity > 0);
+
+  if (self->capacity == capacity)
+    return;
+
+  skip = self->len > capacity ? self->len - capacity : 0;
+  ring = g_new (PocPoint, capacity);
+  for (i = skip; i < self->len; i++)
+    ring[i - skip] = ring_at (self, i);
+  if (skip > 0)
+    poc_dataset_stream_evict (self, skip);
+  g_free (self->ring);
+  self->ring = ring;
+  self->capacity = capacity;
+  self->head = 0;
+
+  poc_dataset_stream_drop_cache (self);
+  poc_dataset_notify_update (POC_DATASET (self));
+  g_object_notify_by_pspec (G_OBJECT (self), poc_dataset_stream_prop[PROP_CAPACITY]);
+}
+
+/**
+ * poc_dataset_stream_get_capacity:
+ * @self: A #PocDatasetStream
+ *
+ * Get the capacity of the ring buffer.
+ *
+ * Returns: maximum number of points retained
+ */
+guint
+poc_dataset_stream_get_capacity (PocDatasetStream *self)
+{
+  g_return_val_if_fail (POC_IS_DATASET_STREAM (self), 0);
+  return self->capacity;
+}
+
+/* history {{{2 */
+
+/**
+ * poc_dataset_stream_set_history:
+ * @self: A #PocDatasetStream
+ * @history: range of X values retained
+ *
+ * Set the history window.  Points with an x coordinate less than that of
+ * the newest point by more than @history are discarded.  If @history is zero
+ * points are only discarded when the ring buffer is full.
+ */
+void
+poc_dataset_stream_set_history (PocDatasetStream *self, gdouble history)
+{
+  g_return_if_fail (POC_IS_DATASET_STREAM (self));
+  g_return_if_fail (history >= 0.0);
+
+  if (self->history == history)
+    return;
+
+  self->history = history;
+  if (poc_dataset_stream_trim_history (self))
+    poc_dataset_notify_update (POC_DATASET (self));
+  g_object_notify_by_pspec (G_OBJECT (self), poc_dataset_stream_prop[PROP_HISTORY]);
+}
+
+/**
+ * poc_dataset_stream_get_history:
+ * @self: A #PocDatasetStream
+ *
+ * Get the history window.
+ *
+ * Returns: range of X values retained, zero if unlimited.
+ */
+gdouble
+poc_dataset_stream_get_history (PocDatasetStream *self)
+{
+  g_return_val_if_fail (POC_IS_DATASET_STREAM (self), 0.0);
+  return self->history;
+}
+
+/* queue size {{{2 */
+
+/**
+ * poc_dataset_stream_set_queue_size:
+ * @self: A #PocDatasetStream
+ * @size: number of points, zero to remove the queue
+ *
+ * Allocate a producer queue for poc_dataset_stream_push().  @size is rounded
+ * up to a power of two.  Points already queued are first moved to the ring
+ * buffer.  This must be called on the main thread and not while a producer
+ * may be pushing points.
+ */
+void
+poc_dataset_stream_set_queue_size (PocDatasetStream *self, guint size)
+{
+  g_return_if_fail (POC_IS_DATASET_STREAM (self));
+  g_return_if_fail (size <= G_MAXINT / 2 + 1);
+
+  if (size > 0)
+    size = 1u << g_bit_storage (size - 1);
+  if (self->queue_size == size)
+    return;
+
+  poc_dataset_stream_prepare (POC_DATASET (self));
+  g_free (self->queue);
+  self->queue = size > 0 ? g_new (PocPoint, size) : NULL;
+  self->queue_size = size;
+  self->queue_head = self->queue_tail = 0;
+
+  /* Let the plot know it should start or stop draining the queue */
+  poc_dataset_notify_update (POC_DATASET (self));
+  g_object_notify_by_pspec (G_OBJECT (self), poc_dataset_stream_prop[PROP_QUEUE_SIZE]);
+}
+
+/**
+ * poc_dataset_stream_get_queue_size:
+ * @self: A #PocDatasetStream
+ *
+ * Get the size of the producer queue.
+ *
+ * Returns: number of points the queue holds, zero if there is no queue.
+ */
+guint
+poc_dataset_stream_get_queue_size (PocDatasetStream *self)
+{
+  g_return_val_if_fail (POC_IS_DATASET_STREAM (self), 0);
+  return self->queue_size;
+}
+
+/* data {{{1 */
+
+/* Runs on the main thread after poc_dataset_stream_push() adds points.  The
+   flag is cleared before the plot drains the queue so that points pushed
+   from then on schedule another wakeup. */
+static gboolean
+poc_dataset_stream_wakeup (gpointer user_data)
+{
+  PocDatasetStream *self = user_data;
+
+  g_atomic_int_set (&self->queue_wakeup, 0);
+  poc_dataset_notify_update (POC_DATASET (self));
+  return G_SOURCE_REMOVE;
+}
+
+/**
+ * poc_dataset_stream_push:
+ * @self: A #PocDatasetStream
+ * @points: (array length=n): points to queue
+ * @n: number of points
+ *
+ * Queue points for appending to the dataset.  Unlike the rest of the
+ * #PocDatasetStream API this may be called from a thread other than the
+ * main thread, but by only one such thread at a time.  No locks are taken;
+ * the points are copied into the queue sized by #PocDatasetStream:queue-size
+ * and appended, as if by poc_dataset_stream_append(), when a plot showing the
+ * dataset next prepares a frame.  Unless a frame has already been requested
+ * since the queue was last drained, an idle callback is added to the default
+ * main context to request one.  If the queue is full the excess points are
+ * not queued.
+ *
+ * Returns: the number of points queued.
+ */
+guint
+poc_dataset_stream_push (PocDatasetStream *self,
+			 const PocPoint *points, guint n)
+{
+  guint head, tail, mask, index, chunk;
+
+  g_return_val_if_fail (POC_IS_DATASET_STREAM (self), 0);
+  g_return_val_if_fail (points != NULL || n == 0, 0);
+  g_return_val_if_fail (self->queue != NULL, 0);
+
+  tail = (guint) self->queue_tail;
+  head = (guint) g_atomic_int_get (&self->queue_head);
+  n = MIN (n, self->queue_size - (tail - head));
+  if (n == 0)
+    return 0;
+
+  mask = self->queue_size - 1;
+  index = tail & mask;
+  chunk = MIN (n, self->queue_size - index);
+  memcpy (&self->queue[index], points, chunk * sizeof (PocPoint));
+  memcpy (self->queue, points + chunk, (n - chunk) * sizeof (PocPoint));
+
+  /* Publish the points only once they have been written */
+  g_atomic_int_set (&self->queue_tail, (gint) (tail + n));
+
+  /* Wake the plot unless it has been woken since the wakeup last ran */
+  if (g_atomic_int_compare_and_exchange (&self->queue_wakeup, 0, 1))
+    g_idle_add_full (G_PRIORITY_DEFAULT, poc_dataset_stream_wakeup,
+		     g_object_ref (self), g_object_unref);
+  return n;
+}
+
+/**
+ * poc_dataset_stream_append:
+ * @self: A #PocDatasetStream
+ * @points: (array length=n): points to append
+ * @n: number of points
+ *
+ * Append points to the dataset, discarding the oldest points as required by
+ * the capacity and history window.  Points should be appended in increasing
+ * order of their x coordinates.  Unlike poc_dataset_set_points() this does not
+ * invalidate the dataset, so that the next redraw need only stroke the new
+ * points.
+ */
+void
+poc_dataset_stream_append (PocDatasetStream *self,
+			   const PocPoint *points, guint n)
+{
+  guint i, skip;
+
+  g_return_if_fail (POC_IS_DATASET_STREAM (self));
+  g_return_if_fail (points != NULL || n == 0);
+
+  if (n == 0)
+    return;
+
+  /* Points which would be overwritten within this call are never stored */
+  skip = n > self->capacity ? n - self->capacity : 0;
+  for (i = 0; i < skip; i++)
+    if (!self->evicted || points[i].x > self->evicted_x)
+      {
+	self->evicted_x = points[i].x;
+	self->evicted = TRUE;
+      }
+
+  if (self->len + n - skip > self->capacity)
+    poc_dataset_stream_evict (self, self->len + n - skip - self->capacity);
+  for (i = skip; i < n; i++)
+    self->ring[ring_index (self, self->len++)] = points[i];
+  self->serial += n;
+
+  poc_dataset_stream_trim_history (self);
+  poc_dataset_notify_update (POC_DATASET (self));
+}
+
+/**
+ * poc_dataset_stream_clear:
+ * @self: A #PocDatasetStream
+ *
+ * Discard all points.
+ */
+void
+poc_dataset_stream_clear (PocDatasetStream *self)
+{
+  g_return_if_fail (POC_IS_DATASET_STREAM (self));
+
+  self->head = self->len = 0;
+  self->evicted = FALSE;
+  poc_dataset_stream_drop_cache (self);
+  poc_dataset_notify_update (POC_DATASET (self));
+}
+
+/**
+ * poc_dataset_stream_get_length:
+ * @self: A #PocDatasetStream
+ *
+ * Get the number of points currently retained.
+ *
+ * Returns: number of points
+ */
+guint
+poc_dataset_stream_get_length (PocDatasetStream *self)
+{
+  g_return_val_if_fail (POC_IS_DATASET_STREAM (self), 0);
+  return self->len;
+}
+
+/**
+ * poc_dataset_stream_get_points:
+ * @self: A #PocDatasetStream
+ *
+ * Copy the retained points, oldest first, into a new array.
+ *
+ * Returns: (transfer full): a #PocPointArray
+ */
+PocPointArray *
+poc_dataset_stream_get_points (PocDatasetStream *self)
+{
+  PocPointArray *array;
+  guint n;
+
+  g_return_val_if_fail (POC_IS_DATASET_STREAM (self), NULL);
+
+  array = poc_point_array_sized_new (self->len);
+  n = MIN (self->len, self->capacity - self->head);
+  poc_point_array_append_vals (array, &self->ring[self->head], n);
+  poc_point_array_append_vals (array, self->ring, self->len - n);
+  return array;
+}
+
+/* override class methods {{{1 */
+
+static void
+poc_dataset_stream_invalidate (PocDataset *dataset)
+{
+  PocDatasetStream *self = POC_DATASET_STREAM (dataset);
+
+  POC_DATASET_CLASS (poc_dataset_stream_parent_class)->invalidate (dataset);
+  poc_dataset_stream_drop_cache (self);
+}
+
+/* Drain the producer queue into the ring buffer.  The dataset asks to be
+   prepared on the next frame only if points were drained, once the queue is
+   empty the plot is woken by poc_dataset_stream_push().  */
+static gboolean
+poc_dataset_stream_prepare (PocDataset *dataset)
+{
+  PocDatasetStream *self = POC_DATASET_STREAM (dataset);
+  guint head, tail, mask, index, chunk;
+
+  if (self->queue == NULL)
+    return FALSE;
+
+  head = (guint) self->queue_head;
+  tail = (guint) g_atomic_int_get (&self->queue_tail);
+  if (head == tail)
+    return FALSE;
+
+  mask = self->queue_size - 1;
+  poc_dataset_freeze_update (dataset);
+  while (head != tail)
+    {
+      index = head & mask;
+      chunk = MIN (tail - head, self->queue_size - index);
+      poc_dataset_stream_append (self, &self->queue[index], chunk);
+      head += chunk;
+    }
+  poc_dataset_thaw_update (dataset);
+
+  /* Release the space to the producer */
+  g_atomic_int_set (&self->queue_head, (gint) head);
+  return TRUE;
+}
+
+/* Add points from index start onwards to the current path */
+static void
+poc_dataset_stream_path (PocDatasetStream *self, cairo_t *cr, guint start,
+			 guint width, guint height)
+{
+  PocPoint buf[256];
+  guint i, j, k, n;
+
+  for (i = start; i < self->len; i += n)
+    {
+      k = ring_index (self, i);
+      n = MIN (G_N_ELEMENTS (buf), self->len - i);
+      n = MIN (n, self->capacity - k);
+      poc_dataset_project_points (POC_DATASET (self), &self->ring[k],
+				  buf, n, width, height);
+      for (j = 0; j < n; j++)
+	if (i + j == start)
+	  cairo_move_to (cr, buf[j].x, buf[j].y);
+	else
+	  cairo_line_to (cr, buf[j].x, buf[j].y);
+    }
+  if (self->len > start)
+    poc_dataset_add_draw_stats (POC_DATASET (self), self->len - start,
+				self->len - start - 1);
+}
+
+/* Check whether the retained surface may be extended with new points */
+static gboolean
+poc_dataset_stream_cache_valid (PocDatasetStream *self,
+				guint width, guint height,
+				PocAxis *x_axis, PocAxis *y_axis,
+				const gdouble projection[4],
+				const GdkRGBA *line_stroke,
+				PocLineStyle line_style)
+{
+  gdouble lower, upper;
+
+  if (self->cache == NULL
+      || self->cache_width != width || self->cache_height != height
+      || self->cache_x_axis != x_axis || self->cache_y_axis != y_axis
+      || self->cache_x_mode != poc_axis_get_axis_mode (x_axis)
+      || self->cache_y_mode != poc_axis_get_axis_mode (y_axis)
+      || memcmp (self->cache_projection, projection,
+		 sizeof self->cache_projection) != 0
+      || !gdk_rgba_equal (&self->cache_stroke, line_stroke)
+      || self->cache_style != line_style)
+    return FALSE;
+
+  /* Dashes would not join up between successive strokes */
+  if (line_style != POC_LINE_STYLE_SOLID)
+    return self->cache_serial == self->serial && !self->evicted;
+
+  /* Discarded segments must not be visible */
+  if (self->evicted)
+    {
+      poc_axis_get_display_range (x_axis, &lower, &upper);
+      if (self->evicted_x > lower
+	  || (self->len > 0 && ring_at (self, 0).x > lower))
+	return FALSE;
+    }
+  return TRUE;
+}
+
+static void
+poc_dataset_stream_draw (PocDataset *dataset, cairo_t *cr,
+			 guint width, guint height)
+{
+  PocDatasetStream *self = POC_DATASET_STREAM (dataset);
+  PocAxis *x_axis, *y_axis;
+  GdkRGBA line_stroke;
+  PocLineStyle line_style;
+  gdouble projection[4];
+  const double *dashes;
+  int num_dashes;
+  guint64 added;
+  guint start;
+  cairo_t *ccr;
+
+  if (self->len == 0)
+    return;
+
+  x_axis = poc_dataset_get_x_axis (dataset);
+  y_axis = poc_dataset_get_y_axis (dataset);
+  poc_dataset_get_line_stroke (dataset, &line_stroke);
+  line_style = poc_dataset_get_line_style (dataset);
+  poc_axis_get_projection (x_axis, width, &projection[0], &projection[1]);
+  poc_axis_get_projection (y_axis, -height, &projection[2], &projection[3]);
+
+  if (poc_dataset_stream_cache_valid (self, width, height, x_axis, y_axis,
+				      projection, &line_stroke, line_style))
+    {
+      /* Restart from the last point drawn, if still retained.  The new
+	 sub-path begins with a move to that point, so only new segments are
+	 stroked, but the line has no join there: the ends of the old and new
+	 segments overlap slightly, which shows with translucent colours, and
+	 dashes restart their pattern. */
+      added = self->serial - self->cache_serial;
+      start = added < self->len ? self->len - (guint) added - 1 : 0;
+    }
+  else
+    {
+      if (self->cache == NULL
+	  || self->cache_width != width || self->cache_height != height)
+	{
+	  poc_dataset_stream_drop_cache (self);
+	  self->cache = cairo_surface_create_similar (cairo_get_target (cr),
+						      CAIRO_CONTENT_COLOR_ALPHA,
+						      width, height);
+	  self->cache_width = width;
+	  self->cache_height = height;
+	}
+      self->cache_x_axis = x_axis;
+      self->cache_y_axis = y_axis;
+      self->cache_x_mode = poc_axis_get_axis_mode (x_axis);
+      self->cache_y_mode = poc_axis_get_axis_mode (y_axis);
+      memcpy (self->cache_projection, projection, sizeof self->cache_projection);
+      self->cache_stroke = line_stroke;
+      self->cache_style = line_style;
+      self->cache_serial = 0;
+      start = 0;
+    }
+
+  if (self->cache_serial != self->serial)
+    {
+      ccr = cairo_create (self->cache);
+      if (start == 0)
+	{
+	  cairo_set_operator (ccr, CAIRO_OPERATOR_CLEAR);
+	  cairo_paint (ccr);
+	  cairo_set_operator (ccr, CAIRO_OPERATOR_OVER);
+	}
+
+      /* Draw the plot line */
+      cairo_new_path (ccr);
+      poc_dataset_stream_path (self, ccr, start, width, height);
+
+      /* Stroke the line */
+      cairo_set_line_width (ccr, 1.0);
+      dashes = poc_line_style_get_dashes (line_style, &num_dashes);
+      cairo_set_dash (ccr, dashes, num_dashes, 0.0);
+      gdk_cairo_set_source_rgba (ccr, &line_stroke);
+      cairo_stroke (ccr);
+      cairo_destroy (ccr);
+
+      self->cache_serial = self->serial;
+    }
+  self->evicted = FALSE;
+
+  cairo_set_source_surface (cr, self->cache, 0.0, 0.0);
+  cairo_paint (cr);
+}
@@ -0,0 +1,53 @@
+/* This file is part of PocPlot.
+ *
+ * PocPlot is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * PocPlot is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with PocPlot; if not, see
+ * <https://www.gnu.org/licenses/>.
+ *
+ * Copyright 2020 Brian Stafford
+ */
+#ifndef _pocdatasetstream_h
+#define _pocdatasetstream_h
+
+#if !defined(__poc_h_inside__) && !defined(__poc_compile__)
+# error "only <poc.h> can be included directly"
+#endif
+
+#include "pocdataset.h"
+
+G_BEGIN_DECLS
+
+#define POC_TYPE_DATASET_STREAM			poc_dataset_stream_get_type ()
+G_DECLARE_FINAL_TYPE (PocDatasetStream, poc_dataset_stream,
+		      POC, DATASET_STREAM, PocDataset)
+
+PocDatasetStream *poc_dataset_stream_new (guint capacity);
+
+void		poc_dataset_stream_set_capacity (PocDatasetStream *self, guint capacity);
+guint		poc_dataset_stream_get_capacity (PocDatasetStream *self);
+void		poc_dataset_stream_set_history (PocDatasetStream *self, gdouble history);
+gdouble		poc_dataset_stream_get_history (PocDatasetStream *self);
+void		poc_dataset_stream_set_queue_size (PocDatasetStream *self, guint size);
+guint		poc_dataset_stream_get_queue_size (PocDatasetStream *self);
+
+void		poc_dataset_stream_append (PocDatasetStream *self,
+					   const PocPoint *points, guint n);
+guint		poc_dataset_stream_push (PocDatasetStream *self,
+					 const PocPoint *points, guint n);
+void		poc_dataset_stream_clear (PocDatasetStream *self);
+guint		poc_dataset_stream_get_length (PocDatasetStream *self);
+PocPointArray *	poc_dataset_stream_get_points (PocDatasetStream *self);
+
+G_END_DECLS
+
+#endif
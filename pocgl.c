@@ -0,0 +1,542 @@
+/* This file is part of PocPlot.
+ *
+ * PocPlot is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * PocPlot is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with PocPlot; if not, see
+ * <https://www.gnu.org/licenses/>.
+ *
+ * Copyright 2020 Brian Stafford
+ */
+#include <math.h>
+#include "pocgl.h"
+#include "pocaxis.h"
+
+/* OpenGL rendering of datasets for PocPlot.
+
+   Each dataset's points are uploaded to a vertex buffer once and kept until
+   the dataset emits "update", so that panning and zooming change only the
+   uniforms passed to the vertex shader which performs the axis projection.
+   Datasets are drawn into a renderbuffer the size of the plot area which is
+   then composited into the widget's cairo context with
+   gdk_cairo_draw_from_gl().  Only datasets drawn by PocDataset's own draw()
+   method with solid lines are handled here; PocPlot draws the others, and
+   the axes, grid and background, with cairo as usual.  */
+
+#ifdef POC_ENABLE_GL
+
+#include <epoxy/gl.h>
+
+/* Vertex buffer holding a dataset's points.  Values on a linear axis are
+   stored relative to an origin so that little precision is lost converting
+   to single precision; logarithms of values on a logarithmic axis are taken
+   in the shader.  */
+struct poc_gl_buffer
+  {
+    GLuint vbo;
+    guint len;
+    gboolean stale;
+    gboolean x_log, y_log;
+    gdouble x_origin, y_origin;
+  };
+
+struct _PocGL
+  {
+    GdkGLContext *context;
+    GdkWindow *window;
+    gboolean use_es;
+
+    GLuint program;
+    GLint u_scale, u_offset, u_log, u_stroke;
+    GLuint vao;
+
+    GLuint framebuffer, renderbuffer;
+    gint fb_width, fb_height;
+    gboolean fb_complete;
+    gint scale;
+
+    GHashTable *buffers;
+  };
+
+/* Attribute location bound before linking */
+#define POSITION	0
+
+static const gchar poc_gl_vertex_gl[] =
+  "#version 150\n"
+  "#define ATTRIBUTE in\n";
+static const gchar poc_gl_vertex_es[] =
+  "#version 100\n"
+  "#define ATTRIBUTE attribute\n";
+static const gchar poc_gl_vertex_source[] =
+  "uniform vec2 scale;\n"
+  "uniform vec2 offset;\n"
+  "uniform vec2 log_axis;\n"
+  "ATTRIBUTE vec2 position;\n"
+  "void main ()\n"
+  "{\n"
+  "  vec2 v = vec2 (log_axis.x > 0.5 ? log2 (position.x) : position.x,\n"
+  "                 log_axis.y > 0.5 ? log2 (position.y) : position.y);\n"
+  "  gl_Position = vec4 (v * scale + offset, 0.0, 1.0);\n"
+  "}\n";
+
+static const gchar poc_gl_fragment_gl[] =
+  "#version 150\n"
+  "out vec4 poc_colour;\n"
+  "#define FRAG_COLOUR poc_colour\n";
+static const gchar poc_gl_fragment_es[] =
+  "#version 100\n"
+  "precision mediump float;\n"
+  "#define FRAG_COLOUR gl_FragColor\n";
+static const gchar poc_gl_fragment_source[] =
+  "uniform vec4 stroke;\n"
+  "void main ()\n"
+  "{\n"
+  "  FRAG_COLOUR = stroke;\n"
+  "}\n";
+
+/* context {{{1 */
+
+static GLuint
+poc_gl_compile (GLenum type, const gchar *header, const gchar *source,
+		GError **error)
+{
+  const gchar *sources[2];
+  GLuint shader;
+  GLint status, length;
+  gchar *log;
+
+  sources[0] = header;
+  sources[1] = source;
+  shader = glCreateShader (type);
+  glShaderSource (shader, 2, sources, NULL);
+  glCompileShader (shader);
+  glGetShaderiv (shader, GL_COMPILE_STATUS, &status);
+  if (status == GL_FALSE)
+    {
+      glGetShaderiv (shader, GL_INFO_LOG_LENGTH, &length);
+      log = g_malloc0 (length + 1);
+      glGetShaderInfoLog (shader, length, NULL, log);
+      g_set_error (error, GDK_GL_ERROR, GDK_GL_ERROR_COMPILATION_FAILED,
+		   "Compiling %s shader: %s",
+		   type == GL_VERTEX_SHADER ? "vertex" : "fragment", log);
+      g_free (log);
+      glDeleteShader (shader);
+      return 0;
+    }
+  return shader;
+}
+
+static gboolean
+poc_gl_create_program (PocGL *gl, GError **error)
+{
+  GLuint vertex, fragment;
+  GLint status, length;
+  gchar *log;
+
+  vertex = poc_gl_compile (GL_VERTEX_SHADER,
+			   gl->use_es ? poc_gl_vertex_es : poc_gl_vertex_gl,
+			   poc_gl_vertex_source, error);
+  if (vertex == 0)
+    return FALSE;
+  fragment = poc_gl_compile (GL_FRAGMENT_SHADER,
+			     gl->use_es ? poc_gl_fragment_es : poc_gl_fragment_gl,
+			     poc_gl_fragment_source, error);
+  if (fragment == 0)
+    {
+      glDeleteShader (vertex);
+      return FALSE;
+    }
+
+  gl->program = glCreateProgram ();
+  glAttachShader (gl->program, vertex);
+  glAttachShader (gl->program, fragment);
+  glBindAttribLocation (gl->program, POSITION, "position");
+  glLinkProgram (gl->program);
+  glDetachShader (gl->program, vertex);
+  glDetachShader (gl->program, fragment);
+  glDeleteShader (vertex);
+  glDeleteShader (fragment);
+
+  glGetProgramiv (gl->program, GL_LINK_STATUS, &status);
+  if (status == GL_FALSE)
+    {
+      glGetProgramiv (gl->program, GL_INFO_LOG_LENGTH, &length);
+      log = g_malloc0 (length + 1);
+      glGetProgramInfoLog (gl->program, length, NULL, log);
+      g_set_error (error, GDK_GL_ERROR, GDK_GL_ERROR_LINK_FAILED,
+		   "Linking shader program: %s", log);
+      g_free (log);
+      return FALSE;
+    }
+
+  gl->u_scale = glGetUniformLocation (gl->program, "scale");
+  gl->u_offset = glGetUniformLocation (gl->program, "offset");
+  gl->u_log = glGetUniformLocation (gl->program, "log_axis");
+  gl->u_stroke = glGetUniformLocation (gl->program, "stroke");
+  return TRUE;
+}
+
+/* Called with the context current */
+static void
+poc_gl_buffer_free (gpointer data)
+{
+  struct poc_gl_buffer *buffer = data;
+
+  glDeleteBuffers (1, &buffer->vbo);
+  g_free (buffer);
+}
+
+/* Create a GL context for drawing datasets in @window.  Returns NULL and
+   sets @error if OpenGL is not available.  */
+PocGL *
+poc_gl_new (GdkWindow *window, GError **error)
+{
+  GdkGLContext *context;
+  PocGL *gl;
+
+  g_return_val_if_fail (GDK_IS_WINDOW (window), NULL);
+
+  context = gdk_window_create_gl_context (window, error);
+  if (context == NULL)
+    return NULL;
+  if (!gdk_gl_context_realize (context, error))
+    {
+      g_object_unref (context);
+      return NULL;
+    }
+  gdk_gl_context_make_current (context);
+
+  gl = g_new0 (PocGL, 1);
+  gl->context = context;
+  gl->window = g_object_ref (window);
+  gl->use_es = gdk_gl_context_get_use_es (context);
+  gl->buffers = g_hash_table_new_full (NULL, NULL, NULL, poc_gl_buffer_free);
+  if (!poc_gl_create_program (gl, error))
+    {
+      poc_gl_free (gl);
+      return NULL;
+    }
+
+  /* Core profiles require a vertex array object */
+  if (!gl->use_es)
+    glGenVertexArrays (1, &gl->vao);
+  glGenFramebuffers (1, &gl->framebuffer);
+  glGenRenderbuffers (1, &gl->renderbuffer);
+  return gl;
+}
+
+void
+poc_gl_free (PocGL *gl)
+{
+  g_return_if_fail (gl != NULL);
+
+  gdk_gl_context_make_current (gl->context);
+  g_hash_table_unref (gl->buffers);
+  if (gl->renderbuffer != 0)
+    glDeleteRenderbuffers (1, &gl->renderbuffer);
+  if (gl->framebuffer != 0)
+    glDeleteFramebuffers (1, &gl->framebuffer);
+  if (gl->vao != 0)
+    glDeleteVertexArrays (1, &gl->vao);
+  if (gl->program != 0)
+    glDeleteProgram (gl->program);
+  gdk_gl_context_clear_current ();
+
+  g_object_unref (gl->context);
+  g_object_unref (gl->window);
+  g_free (gl);
+}
+
+/* buffers {{{1 */
+
+/* Mark the dataset's vertex buffer for uploading again */
+void
+poc_gl_invalidate (PocGL *gl, PocDataset *dataset)
+{
+  struct poc_gl_buffer *buffer;
+
+  g_return_if_fail (gl != NULL);
+
+  buffer = g_hash_table_lookup (gl->buffers, dataset);
+  if (buffer != NULL)
+    buffer->stale = TRUE;
+}
+
+/* Release the vertex buffer of a dataset removed from the plot */
+void
+poc_gl_forget (PocGL *gl, PocDataset *dataset)
+{
+  g_return_if_fail (gl != NULL);
+
+  if (g_hash_table_contains (gl->buffers, dataset))
+    {
+      gdk_gl_context_make_current (gl->context);
+      g_hash_table_remove (gl->buffers, dataset);
+    }
+}
+
+/* Values are stored relative to the first finite value */
+static gdouble
+poc_gl_origin (const PocVector *v, guint len)
+{
+  gdouble value;
+  guint i;
+
+  for (i = 0; i < len; i++)
+    {
+      value = poc_vector_index (v, i);
+      if (isfinite (value))
+	return value;
+    }
+  return 0.0;
+}
+
+static struct poc_gl_buffer *
+poc_gl_get_buffer (PocGL *gl, PocDataset *dataset,
+		   gboolean x_log, gboolean y_log)
+{
+  struct poc_gl_buffer *buffer;
+  PocVector x, y;
+  GLfloat *vertices;
+  guint i, len;
+
+  buffer = g_hash_table_lookup (gl->buffers, dataset);
+  if (buffer == NULL)
+    {
+      buffer = g_new0 (struct poc_gl_buffer, 1);
+      glGenBuffers (1, &buffer->vbo);
+      buffer->stale = TRUE;
+      g_hash_table_insert (gl->buffers, dataset, buffer);
+    }
+  else if (!buffer->stale && buffer->x_log == x_log && buffer->y_log == y_log)
+    return buffer;
+
+  len = poc_dataset_get_data_vectors (dataset, &x, &y);
+  buffer->x_log = x_log;
+  buffer->y_log = y_log;
+  buffer->x_origin = x_log ? 0.0 : poc_gl_origin (&x, len);
+  buffer->y_origin = y_log ? 0.0 : poc_gl_origin (&y, len);
+
+  vertices = g_new (GLfloat, 2 * (gsize) len);
+  for (i = 0; i < len; i++)
+    {
+      vertices[2 * i] = (GLfloat) (poc_vector_index (&x, i) - buffer->x_origin);
+      vertices[2 * i + 1] = (GLfloat) (poc_vector_index (&y, i) - buffer->y_origin);
+    }
+  glBindBuffer (GL_ARRAY_BUFFER, buffer->vbo);
+  glBufferData (GL_ARRAY_BUFFER, 2 * (gsize) len * sizeof (GLfloat),
+		vertices, GL_STATIC_DRAW);
+  g_free (vertices);
+
+  buffer->len = len;
+  buffer->stale = FALSE;
+  return buffer;
+}
+
+/* draw {{{1 */
+
+/* Whether the dataset may be drawn with GL rather than cairo */
+gboolean
+poc_gl_can_draw (PocDataset *dataset)
+{
+  PocDatasetClass *base = g_type_class_peek (POC_TYPE_DATASET);
+
+  return POC_DATASET_GET_CLASS (dataset)->draw == base->draw
+	 && poc_dataset_get_line_style (dataset) == POC_LINE_STYLE_SOLID;
+}
+
+/* Prepare the renderbuffer for drawing datasets in a plot area of width by
+   height at the given scale factor.  Returns FALSE if the area is empty or
+   the framebuffer cannot be used, for example if the area exceeds the
+   maximum renderbuffer size; the datasets should then be drawn with cairo.  */
+gboolean
+poc_gl_begin (PocGL *gl, guint width, guint height, gint scale)
+{
+  gint fb_width, fb_height;
+
+  g_return_val_if_fail (gl != NULL, FALSE);
+
+  fb_width = width * scale;
+  fb_height = height * scale;
+  if (fb_width <= 0 || fb_height <= 0)
+    return FALSE;
+
+  gdk_gl_context_make_current (gl->context);
+  if (fb_width != gl->fb_width || fb_height != gl->fb_height)
+    {
+      glBindRenderbuffer (GL_RENDERBUFFER, gl->renderbuffer);
+      glRenderbufferStorage (GL_RENDERBUFFER, GL_RGBA8, fb_width, fb_height);
+      glBindFramebuffer (GL_FRAMEBUFFER, gl->framebuffer);
+      glFramebufferRenderbuffer (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+				 GL_RENDERBUFFER, gl->renderbuffer);
+      gl->fb_complete = glCheckFramebufferStatus (GL_FRAMEBUFFER)
+			== GL_FRAMEBUFFER_COMPLETE;
+      gl->fb_width = fb_width;
+      gl->fb_height = fb_height;
+    }
+  if (!gl->fb_complete)
+    return FALSE;
+  gl->scale = scale;
+
+  glBindFramebuffer (GL_FRAMEBUFFER, gl->framebuffer);
+  glViewport (0, 0, fb_width, fb_height);
+  glClearColor (0.0f, 0.0f, 0.0f, 0.0f);
+  glClear (GL_COLOR_BUFFER_BIT);
+
+  /* Colours are premultiplied, as cairo expects */
+  glEnable (GL_BLEND);
+  glBlendFunc (GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+  glUseProgram (gl->program);
+  if (gl->vao != 0)
+    glBindVertexArray (gl->vao);
+  glEnableVertexAttribArray (POSITION);
+  return TRUE;
+}
+
+/* Combine the axis projection with the conversion from pixels to normalised
+   device coordinates so that the shader computes value * scale + offset
+   with value relative to origin, or log2 (value) on a logarithmic axis.  */
+static void
+poc_gl_axis_transform (PocAxis *axis, gint norm, gdouble origin,
+		       GLfloat *scale, GLfloat *offset)
+{
+  gdouble s, o, size;
+
+  poc_axis_get_projection (axis, norm, &s, &o);
+  if (poc_axis_get_axis_mode (axis) == POC_AXIS_LOG_DECADE)
+    s *= G_LN2 / G_LN10;
+  o += origin * s;
+
+  size = norm < 0 ? -norm : norm;
+  if (norm < 0)
+    {
+      *scale = (GLfloat) (-2.0 * s / size);
+      *offset = (GLfloat) (1.0 - 2.0 * o / size);
+    }
+  else
+    {
+      *scale = (GLfloat) (2.0 * s / size);
+      *offset = (GLfloat) (2.0 * o / size - 1.0);
+    }
+}
+
+/* Draw the visible points of a dataset as a line strip */
+void
+poc_gl_draw_dataset (PocGL *gl, PocDataset *dataset, guint width, guint height)
+{
+  struct poc_gl_buffer *buffer;
+  PocAxis *x_axis, *y_axis;
+  GLfloat x_scale, x_offset, y_scale, y_offset;
+  GdkRGBA stroke;
+  guint first, end;
+
+  g_return_if_fail (gl != NULL);
+
+  x_axis = poc_dataset_get_x_axis (dataset);
+  y_axis = poc_dataset_get_y_axis (dataset);
+  if (x_axis == NULL || y_axis == NULL)
+    return;
+
+  buffer = poc_gl_get_buffer (gl, dataset,
+			      poc_axis_get_axis_mode (x_axis) != POC_AXIS_LINEAR,
+			      poc_axis_get_axis_mode (y_axis) != POC_AXIS_LINEAR);
+  poc_dataset_get_visible_range (dataset, &first, &end);
+  end = MIN (end, buffer->len);
+  if (end < first + 2)
+    return;
+
+  poc_gl_axis_transform (x_axis, width, buffer->x_origin, &x_scale, &x_offset);
+  poc_gl_axis_transform (y_axis, -(gint) height, buffer->y_origin,
+			 &y_scale, &y_offset);
+  glUniform2f (gl->u_scale, x_scale, y_scale);
+  glUniform2f (gl->u_offset, x_offset, y_offset);
+  glUniform2f (gl->u_log, buffer->x_log ? 1.0f : 0.0f,
+	       buffer->y_log ? 1.0f : 0.0f);
+
+  poc_dataset_get_line_stroke (dataset, &stroke);
+  glUniform4f (gl->u_stroke, stroke.red * stroke.alpha,
+	       stroke.green * stroke.alpha, stroke.blue * stroke.alpha,
+	       stroke.alpha);
+
+  glBindBuffer (GL_ARRAY_BUFFER, buffer->vbo);
+  glVertexAttribPointer (POSITION, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+  glDrawArrays (GL_LINE_STRIP, first, end - first);
+  poc_dataset_add_draw_stats (dataset, end - first, end - first - 1);
+}
+
+/* Composite the datasets drawn since poc_gl_begin() at the origin of cr */
+void
+poc_gl_end (PocGL *gl, cairo_t *cr)
+{
+  g_return_if_fail (gl != NULL);
+
+  glDisableVertexAttribArray (POSITION);
+  if (gl->vao != 0)
+    glBindVertexArray (0);
+  glUseProgram (0);
+  glFlush ();
+
+  gdk_cairo_draw_from_gl (cr, gl->window, gl->renderbuffer, GL_RENDERBUFFER,
+			  gl->scale, 0, 0, gl->fb_width, gl->fb_height);
+}
+
+#else /* !POC_ENABLE_GL */
+
+PocGL *
+poc_gl_new (G_GNUC_UNUSED GdkWindow *window, GError **error)
+{
+  g_set_error_literal (error, GDK_GL_ERROR, GDK_GL_ERROR_NOT_AVAILABLE,
+		       "PocPlot was built without OpenGL support");
+  return NULL;
+}
+
+void
+poc_gl_free (G_GNUC_UNUSED PocGL *gl)
+{
+}
+
+gboolean
+poc_gl_can_draw (G_GNUC_UNUSED PocDataset *dataset)
+{
+  return FALSE;
+}
+
+gboolean
+poc_gl_begin (G_GNUC_UNUSED PocGL *gl, G_GNUC_UNUSED guint width,
+	      G_GNUC_UNUSED guint height, G_GNUC_UNUSED gint scale)
+{
+  return FALSE;
+}
+
+void
+poc_gl_draw_dataset (G_GNUC_UNUSED PocGL *gl,
+		     G_GNUC_UNUSED PocDataset *dataset,
+		     G_GNUC_UNUSED guint width, G_GNUC_UNUSED guint height)
+{
+}
+
+void
+poc_gl_end (G_GNUC_UNUSED PocGL *gl, G_GNUC_UNUSED cairo_t *cr)
+{
+}
+
+void
+poc_gl_invalidate (G_GNUC_UNUSED PocGL *gl, G_GNUC_UNUSED PocDataset *dataset)
+{
+}
+
+void
+poc_gl_forget (G_GNUC_UNUSED PocGL *gl, G_GNUC_UNUSED PocDataset *dataset)
+{
+}
+
+#endif
@@ -0,0 +1,46 @@
+/* This file is part of PocPlot.
+ *
+ * PocPlot is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * PocPlot is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with PocPlot; if not, see
+ * <https://www.gnu.org/licenses/>.
+ *
+ * Copyright 2020 Brian Stafford
+ */
+#ifndef _pocgl_h
+#define _pocgl_h
+
+#if !defined(__poc_h_inside__) && !defined(__poc_compile__)
+# error "only <poc.h> can be included directly"
+#endif
+
+#include <gtk/gtk.h>
+#include "pocdataset.h"
+
+G_BEGIN_DECLS
+
+typedef struct _PocGL PocGL;
+
+PocGL *		poc_gl_new		(GdkWindow *window, GError **error);
+void		poc_gl_free		(PocGL *gl);
+gboolean	poc_gl_can_draw		(PocDataset *dataset);
+gboolean	poc_gl_begin		(PocGL *gl, guint width, guint height,
+					 gint scale);
+void		poc_gl_draw_dataset	(PocGL *gl, PocDataset *dataset,
+					 guint width, guint height);
+void		poc_gl_end		(PocGL *gl, cairo_t *cr);
+void		poc_gl_invalidate	(PocGL *gl, PocDataset *dataset);
+void		poc_gl_forget		(PocGL *gl, PocDataset *dataset);
+
+G_END_DECLS
+
+#endif
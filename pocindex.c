@@ -0,0 +1,151 @@
+/* This file is part of PocPlot.
+ *
+ * PocPlot is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * PocPlot is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with PocPlot; if not, see
+ * <https://www.gnu.org/licenses/>.
+ *
+ * Copyright 2020 Brian Stafford
+ */
+#include "pocindex.h"
+#include <math.h>
+
+/* A uniform grid over the bounding box of a set of points, used to find
+   the points near a position without visiting every point.  The grid has
+   about INDEX_DENSITY points per cell.  Cells are stored in compressed form:
+   the indices of the points in cell c are index[start[c]] up to, but not
+   including, index[start[c + 1]].  Points with a non-finite coordinate are
+   not indexed.
+
+   The grid is in data space so it remains valid whatever the axis ranges or
+   modes, since the projection of each axis is monotonic. */
+
+#define INDEX_DENSITY	4
+#define INDEX_MAX_CELLS	1024
+
+struct _PocIndex
+  {
+    gdouble	min_x, min_y;
+    gdouble	max_x, max_y;
+    gdouble	scale_x, scale_y;
+    guint	n_cols, n_rows;
+    guint	*start;
+    guint	*index;
+  };
+
+static inline guint
+index_cell (gdouble value, gdouble min, gdouble scale, guint n_cells)
+{
+  gdouble c;
+
+  c = floor ((value - min) * scale);
+  return c <= 0.0 ? 0 : c >= n_cells ? n_cells - 1 : (guint) c;
+}
+
+PocIndex *
+poc_index_new (const PocVector *x, const PocVector *y, guint n)
+{
+  PocIndex *index;
+  gdouble max_x, max_y, vx, vy, size;
+  guint *cell;
+  guint i, c, n_cells;
+
+  index = g_new0 (PocIndex, 1);
+  index->min_x = index->min_y = G_MAXDOUBLE;
+  max_x = max_y = -G_MAXDOUBLE;
+  for (i = 0; i < n; i++)
+    {
+      vx = poc_vector_index (x, i);
+      vy = poc_vector_index (y, i);
+      if (!isfinite (vx) || !isfinite (vy))
+	continue;
+      index->min_x = MIN (index->min_x, vx);
+      index->min_y = MIN (index->min_y, vy);
+      max_x = MAX (max_x, vx);
+      max_y = MAX (max_y, vy);
+    }
+  if (index->min_x > max_x)
+    index->min_x = index->min_y = max_x = max_y = 0.0;
+  index->max_x = max_x;
+  index->max_y = max_y;
+
+  size = ceil (sqrt ((gdouble) n / INDEX_DENSITY));
+  index->n_cols = index->n_rows = CLAMP (size, 1, INDEX_MAX_CELLS);
+  index->scale_x = max_x > index->min_x ? index->n_cols / (max_x - index->min_x) : 0.0;
+  index->scale_y = max_y > index->min_y ? index->n_rows / (max_y - index->min_y) : 0.0;
+  n_cells = index->n_cols * index->n_rows;
+
+  /* Count the points in each cell, then place them */
+  cell = g_new (guint, n);
+  index->start = g_new0 (guint, n_cells + 1);
+  for (i = 0; i < n; i++)
+    {
+      vx = poc_vector_index (x, i);
+      vy = poc_vector_index (y, i);
+      if (!isfinite (vx) || !isfinite (vy))
+	{
+	  cell[i] = G_MAXUINT;
+	  continue;
+	}
+      cell[i] = index_cell (vy, index->min_y, index->scale_y, index->n_rows)
+		* index->n_cols
+		+ index_cell (vx, index->min_x, index->scale_x, index->n_cols);
+      index->start[cell[i] + 1] += 1;
+    }
+  for (c = 0; c < n_cells; c++)
+    index->start[c + 1] += index->start[c];
+
+  index->index = g_new (guint, MAX (index->start[n_cells], 1));
+  for (i = 0; i < n; i++)
+    if (cell[i] != G_MAXUINT)
+      index->index[index->start[cell[i]]++] = i;
+
+  /* Placing the points advanced each start to the next cell's */
+  for (c = n_cells; c > 0; c--)
+    index->start[c] = index->start[c - 1];
+  index->start[0] = 0;
+
+  g_free (cell);
+  return index;
+}
+
+void
+poc_index_free (PocIndex *index)
+{
+  g_free (index->start);
+  g_free (index->index);
+  g_free (index);
+}
+
+/* Call func for each point in the cells overlapping the rectangle; some
+   points outside the rectangle may be visited. */
+void
+poc_index_foreach (PocIndex *index,
+		   gdouble min_x, gdouble max_x, gdouble min_y, gdouble max_y,
+		   PocIndexFunc func, gpointer user_data)
+{
+  guint col0, col1, row0, row1, row, c, k;
+
+  if (!(max_x >= min_x && max_y >= min_y)
+      || max_x < index->min_x || min_x > index->max_x
+      || max_y < index->min_y || min_y > index->max_y)
+    return;
+
+  col0 = index_cell (min_x, index->min_x, index->scale_x, index->n_cols);
+  col1 = index_cell (max_x, index->min_x, index->scale_x, index->n_cols);
+  row0 = index_cell (min_y, index->min_y, index->scale_y, index->n_rows);
+  row1 = index_cell (max_y, index->min_y, index->scale_y, index->n_rows);
+  for (row = row0; row <= row1; row++)
+    for (c = row * index->n_cols + col0; c <= row * index->n_cols + col1; c++)
+      for (k = index->start[c]; k < index->start[c + 1]; k++)
+	(*func) (index->index[k], user_data);
+}
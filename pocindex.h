@@ -0,0 +1,44 @@
+/* This file is part of PocPlot.
+ *
+ * PocPlot is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * PocPlot is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with PocPlot; if not, see
+ * <https://www.gnu.org/licenses/>.
+ *
+ * Copyright 2020 Brian Stafford
+ */
+#ifndef _pocindex_h
+#define _pocindex_h
+
+#if !defined(__poc_h_inside__) && !defined(__poc_compile__)
+# error "only <poc.h> can be included directly"
+#endif
+
+#include "poctypes.h"
+
+G_BEGIN_DECLS
+
+typedef struct _PocIndex PocIndex;
+
+typedef void	(*PocIndexFunc)		(guint i, gpointer user_data);
+
+PocIndex *	poc_index_new		(const PocVector *x,
+					 const PocVector *y, guint n);
+void		poc_index_free		(PocIndex *index);
+void		poc_index_foreach	(PocIndex *index,
+					 gdouble min_x, gdouble max_x,
+					 gdouble min_y, gdouble max_y,
+					 PocIndexFunc func, gpointer user_data);
+
+G_END_DECLS
+
+#endif
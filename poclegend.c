@@ -33,10 +33,24 @@
  * Plot and dataset titles are used for legend text and dataset
  * line styles and colours are used for the line samples.
  *
+ * Text is measured once and the measurements are cached along with the
+ * widget's size request.  The cache is discarded only when a dataset is
+ * added to or removed from the plot, when a dataset's #PocDataset:legend or
+ * the plot's #PocPlot:title changes or when one of the size properties
+ * changes.  Only entries intersecting the exposed region are drawn.
+ *
  * Please note that although operational, PocLegend is more of a
  * proof-of-concept at present and needs some work on its aesthetics.
  */
 
+/* A cached legend entry */
+struct entry
+  {
+    PocDataset *dataset;
+    gulong legend_id;
+    gdouble text_width;
+  };
+
 typedef struct _PocLegend PocLegend;
 struct _PocLegend
   {
@@ -48,7 +62,17 @@ struct _PocLegend
     gdouble line_sample_size;
     gdouble line_spacing;
 
-    gdouble width;
+    gulong dataset_added_id;
+    gulong dataset_removed_id;
+    gulong title_id;
+
+    /* Layout cache, valid unless relayout is set */
+    GArray *entries;
+    cairo_font_extents_t title_extents;
+    cairo_font_extents_t legend_extents;
+    gdouble title_width;
+    gint request_width;
+    gint request_height;
     gboolean relayout;
   };
 
@@ -96,6 +120,12 @@ static void poc_legend_get_property (GObject *object, guint param_id,
 static void poc_legend_set_property (GObject *object, guint param_id,
 				     const GValue *value, GParamSpec *pspec);
 static gboolean poc_legend_draw (GtkWidget *widget, cairo_t *cr);
+static void poc_legend_get_preferred_width (GtkWidget *widget,
+					    gint *minimum, gint *natural);
+static void poc_legend_get_preferred_height (GtkWidget *widget,
+					     gint *minimum, gint *natural);
+static void poc_legend_entry_clear (gpointer data);
+static void poc_legend_invalidate (PocLegend *self);
 
 /* GObject {{{1 */
 
@@ -112,6 +142,8 @@ poc_legend_class_init (PocLegendClass *class)
 
   gtk_widget_class_set_css_name (widget_class, "legend");
   widget_class->draw = poc_legend_draw;
+  widget_class->get_preferred_width = poc_legend_get_preferred_width;
+  widget_class->get_preferred_height = poc_legend_get_preferred_height;
 
   poc_legend_prop[PROP_PLOT] = g_param_spec_object (
         "plot", "Plot",
@@ -150,6 +182,9 @@ poc_legend_init (PocLegend *self)
   self->legend_text_size = 10.0;
   self->line_sample_size = 50.0;
   self->line_spacing = 1.0;
+  self->entries = g_array_new (FALSE, FALSE, sizeof (struct entry));
+  g_array_set_clear_func (self->entries, poc_legend_entry_clear);
+  self->relayout = TRUE;
 }
 
 static void
@@ -157,15 +192,23 @@ poc_legend_dispose (GObject *object)
 {
   PocLegend *self = (PocLegend *) object;
 
-  g_clear_object (&self->plot);
+  if (self->plot != NULL)
+    {
+      g_clear_signal_handler (&self->dataset_added_id, self->plot);
+      g_clear_signal_handler (&self->dataset_removed_id, self->plot);
+      g_clear_signal_handler (&self->title_id, self->plot);
+      g_clear_object (&self->plot);
+    }
+  g_array_set_size (self->entries, 0);
   G_OBJECT_CLASS (poc_legend_parent_class)->dispose (object);
 }
 
 static void
 poc_legend_finalize (GObject *object)
 {
-  //PocLegend *self = (PocLegend *) object;
+  PocLegend *self = (PocLegend *) object;
 
+  g_array_unref (self->entries);
   G_OBJECT_CLASS (poc_legend_parent_class)->finalize (object);
 }
 
@@ -239,17 +282,50 @@ poc_legend_get_property (GObject *object, guint prop_id,
  *
  * Display a legend for the associated plot widget.
  */
+static void
+poc_legend_plot_dataset (G_GNUC_UNUSED PocPlot *plot,
+			 G_GNUC_UNUSED PocDataset *dataset, gpointer user_data)
+{
+  poc_legend_invalidate (user_data);
+}
+
+static void
+poc_legend_plot_title (G_GNUC_UNUSED GObject *object,
+		       G_GNUC_UNUSED GParamSpec *pspec, gpointer user_data)
+{
+  poc_legend_invalidate (user_data);
+}
+
 void
 poc_legend_set_plot (PocLegend *self, PocPlot *plot)
 {
   g_return_if_fail (POC_IS_LEGEND (self));
+  g_return_if_fail (plot == NULL || POC_IS_PLOT (plot));
+
+  if (self->plot == plot)
+    return;
 
-  if (g_set_object (&self->plot, plot))
+  if (self->plot != NULL)
+    {
+      g_clear_signal_handler (&self->dataset_added_id, self->plot);
+      g_clear_signal_handler (&self->dataset_removed_id, self->plot);
+      g_clear_signal_handler (&self->title_id, self->plot);
+    }
+  g_set_object (&self->plot, plot);
+  if (self->plot != NULL)
     {
-      self->relayout = TRUE;
-      gtk_widget_queue_draw (GTK_WIDGET (self));
-      g_object_notify_by_pspec (G_OBJECT (self), poc_legend_prop[PROP_PLOT]);
+      self->dataset_added_id = g_signal_connect (self->plot, "dataset-added",
+      					G_CALLBACK (poc_legend_plot_dataset),
+					self);
+      self->dataset_removed_id = g_signal_connect (self->plot, "dataset-removed",
+      					G_CALLBACK (poc_legend_plot_dataset),
+					self);
+      self->title_id = g_signal_connect (self->plot, "notify::title",
+					 G_CALLBACK (poc_legend_plot_title),
+					 self);
     }
+  poc_legend_invalidate (self);
+  g_object_notify_by_pspec (G_OBJECT (self), poc_legend_prop[PROP_PLOT]);
 }
 
 /**
@@ -285,7 +361,7 @@ poc_legend_set_title_text_size (PocLegend *self, gdouble title_text_size)
   if (self->title_text_size != title_text_size)
     {
       self->title_text_size = title_text_size;
-      gtk_widget_queue_draw (GTK_WIDGET (self));
+      poc_legend_invalidate (self);
       g_object_notify_by_pspec (G_OBJECT (self), poc_legend_prop[PROP_TITLE_TEXT_SIZE]);
     }
 }
@@ -323,7 +399,7 @@ poc_legend_set_legend_text_size (PocLegend *self, gdouble legend_text_size)
   if (self->legend_text_size != legend_text_size)
     {
       self->legend_text_size = legend_text_size;
-      gtk_widget_queue_draw (GTK_WIDGET (self));
+      poc_legend_invalidate (self);
       g_object_notify_by_pspec (G_OBJECT (self), poc_legend_prop[PROP_LEGEND_TEXT_SIZE]);
     }
 }
@@ -361,7 +437,7 @@ poc_legend_set_line_sample_size (PocLegend *self, gdouble line_sample_size)
   if (self->line_sample_size != line_sample_size)
     {
       self->line_sample_size = line_sample_size;
-      gtk_widget_queue_draw (GTK_WIDGET (self));
+      poc_legend_invalidate (self);
       g_object_notify_by_pspec (G_OBJECT (self), poc_legend_prop[PROP_LINE_SAMPLE_SIZE]);
     }
 }
@@ -400,6 +476,7 @@ poc_legend_set_line_spacing (PocLegend *self, gdouble line_spacing)
   if (self->line_spacing != line_spacing)
     {
       self->line_spacing = line_spacing;
+      poc_legend_invalidate (self);
       g_object_notify_by_pspec (G_OBJECT (self), poc_legend_prop[PROP_LINE_SPACING]);
     }
 }
@@ -422,91 +499,149 @@ poc_legend_get_line_spacing (PocLegend *self)
 
 /* layout {{{1 */
 
+#define INTERNAL_BORDER	6.0
+
+static void
+poc_legend_entry_clear (gpointer data)
+{
+  struct entry *entry = data;
+
+  g_clear_signal_handler (&entry->legend_id, entry->dataset);
+  g_clear_object (&entry->dataset);
+}
+
+/* Discard the layout cache */
+static void
+poc_legend_invalidate (PocLegend *self)
+{
+  self->relayout = TRUE;
+  gtk_widget_queue_resize (GTK_WIDGET (self));
+}
+
+static void
+poc_legend_dataset_legend (G_GNUC_UNUSED GObject *object,
+			   G_GNUC_UNUSED GParamSpec *pspec, gpointer user_data)
+{
+  poc_legend_invalidate (user_data);
+}
+
 struct closure
   {
     PocLegend *self;
     cairo_t *cr;
-    cairo_font_extents_t font_extents;
-    GdkRGBA foreground;
-    gint count;
-    gdouble y;
     gdouble width;
-    gdouble height;
   };
 
-#define INTERNAL_BORDER	6.0
-
-#if X
 static gboolean
-poc_legend_dimensions (G_GNUC_UNUSED PocPlot *plot, PocDataset *dataset,
-		       gpointer user_data)
+poc_legend_measure (G_GNUC_UNUSED PocPlot *plot, PocDataset *dataset,
+		    gpointer user_data)
 {
   struct closure *closure = user_data;
   PocLegend *self = closure->self;
-  cairo_t *cr = closure->cr;
   cairo_text_extents_t text_extents;
   const gchar *legend;
+  struct entry entry;
   gdouble width;
 
+  entry.dataset = g_object_ref (dataset);
+  entry.legend_id = g_signal_connect (dataset, "notify::legend",
+				      G_CALLBACK (poc_legend_dataset_legend),
+				      self);
+  entry.text_width = 0.0;
+
   width = self->line_sample_size;
   legend = poc_dataset_get_legend (dataset);
   if (legend != NULL)
     {
-      cairo_text_extents (cr, legend, &text_extents);
+      cairo_text_extents (closure->cr, legend, &text_extents);
+      entry.text_width = text_extents.width;
       width += text_extents.width + INTERNAL_BORDER;
     }
   if (width > closure->width)
     closure->width = width;
-  closure->count += 1;
+  g_array_append_val (self->entries, entry);
   return FALSE;
 }
 
+/* Measure the title and legend entries if the cache is invalid.  Text
+   extents are in user space so a scratch surface serves for measurement. */
 static void
-poc_legend_layout (PocLegend *self, cairo_t *cr)
+poc_legend_layout (PocLegend *self)
 {
   struct closure closure;
+  cairo_surface_t *surface;
   cairo_text_extents_t text_extents;
   const gchar *title;
-  double line_height;
+  gdouble height, size;
 
+  if (!self->relayout)
+    return;
+  self->relayout = FALSE;
+
+  g_array_set_size (self->entries, 0);
+  self->title_width = 0.0;
+  self->request_width = self->request_height = 0;
+  if (self->plot == NULL)
+    return;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 1, 1);
   closure.self = self;
-  closure.cr = cr;
-  closure.count = 0;
+  closure.cr = cairo_create (surface);
+  closure.width = 0.0;
+  height = 0.0;
 
   title = poc_plot_get_title (self->plot);
   if (title != NULL)
     {
-      cairo_set_font_size (cr, self->title_text_size);
-      cairo_font_extents (cr, &closure.font_extents);
-      cairo_text_extents (cr, title, &text_extents);
+      cairo_set_font_size (closure.cr, self->title_text_size);
+      cairo_font_extents (closure.cr, &self->title_extents);
+      cairo_text_extents (closure.cr, title, &text_extents);
+      self->title_width = text_extents.width;
       closure.width = text_extents.width;
-      closure.height = closure.font_extents.height;
+      height = self->title_extents.height;
     }
-  else
-    closure.height = closure.width = 0.0;
 
-  cairo_set_font_size (cr, self->legend_text_size);
-  cairo_font_extents (cr, &closure.font_extents);
-  poc_plot_dataset_foreach (self->plot, poc_legend_dimensions, &closure);
+  cairo_set_font_size (closure.cr, self->legend_text_size);
+  cairo_font_extents (closure.cr, &self->legend_extents);
+  poc_plot_dataset_foreach (self->plot, poc_legend_measure, &closure);
+  height += self->legend_extents.height * self->line_spacing
+	    * self->entries->len;
 
-  line_height = closure.font_extents.height * self->line_spacing;
-  closure.height += line_height * closure.count;
+  cairo_destroy (closure.cr);
+  cairo_surface_destroy (surface);
 
-  gtk_widget_set_size_request (GTK_WIDGET (self),
-			       (gint) closure.width, (gint) closure.height);
+  size = ceil (closure.width);
+  self->request_width = size;
+  size = ceil (height);
+  self->request_height = size;
+}
+
+static void
+poc_legend_get_preferred_width (GtkWidget *widget,
+				gint *minimum, gint *natural)
+{
+  PocLegend *self = (PocLegend *) widget;
+
+  poc_legend_layout (self);
+  *minimum = *natural = self->request_width;
+}
+
+static void
+poc_legend_get_preferred_height (GtkWidget *widget,
+				 gint *minimum, gint *natural)
+{
+  PocLegend *self = (PocLegend *) widget;
+
+  poc_legend_layout (self);
+  *minimum = *natural = self->request_height;
 }
-#endif
 
 /* draw {{{1 */
 
-static gboolean
-poc_legend_sample (G_GNUC_UNUSED PocPlot *plot, PocDataset *dataset,
-		   gpointer user_data)
+static void
+poc_legend_sample (PocLegend *self, cairo_t *cr, const struct entry *entry,
+		   const GdkRGBA *foreground, gdouble width, gdouble top)
 {
-  struct closure *closure = user_data;
-  PocLegend *self = closure->self;
-  cairo_t *cr = closure->cr;
-  cairo_text_extents_t text_extents;
   GdkRGBA rgba;
   const double *dashes;
   int num_dashes;
@@ -514,89 +649,91 @@ poc_legend_sample (G_GNUC_UNUSED PocPlot *plot, PocDataset *dataset,
   const gchar *legend;
   double line_height, line_ascent, x, y;
 
-  line_height = closure->font_extents.height * self->line_spacing;
-  line_ascent = closure->font_extents.ascent * self->line_spacing;
+  line_height = self->legend_extents.height * self->line_spacing;
+  line_ascent = self->legend_extents.ascent * self->line_spacing;
 
-  legend = poc_dataset_get_legend (dataset);
+  legend = poc_dataset_get_legend (entry->dataset);
   if (legend != NULL)
     {
-      gdk_cairo_set_source_rgba (cr, &closure->foreground);
-      cairo_text_extents (cr, legend, &text_extents);
-      x = round ((closure->width * 1.5 - text_extents.width) / 2.0);
-      y = round (closure->y + line_ascent);
+      gdk_cairo_set_source_rgba (cr, foreground);
+      x = round ((width * 1.5 - entry->text_width) / 2.0);
+      y = round (top + line_ascent);
       cairo_move_to (cr, x, y);
       cairo_show_text (cr, legend);
     }
 
   /* fetch sample parameters from dataset */
-  poc_dataset_get_line_stroke (dataset, &rgba);
-  line_style = poc_dataset_get_line_style (dataset);
+  poc_dataset_get_line_stroke (entry->dataset, &rgba);
+  line_style = poc_dataset_get_line_style (entry->dataset);
   dashes = poc_line_style_get_dashes (line_style, &num_dashes);
   cairo_set_dash (cr, dashes, num_dashes, 0.0);
   gdk_cairo_set_source_rgba (cr, &rgba);
 
   /* stroke the sample line */
-  x = round ((closure->width / 2.0 - self->line_sample_size) / 2.0);
-  y = round (closure->y + line_height / 2.0);
+  x = round ((width / 2.0 - self->line_sample_size) / 2.0);
+  y = round (top + line_height / 2.0);
   cairo_move_to (cr, x + 0.5, y + 0.5);
   cairo_rel_line_to (cr, self->line_sample_size, 0.0);
   cairo_stroke (cr);
-
-  closure->y += line_height;
-  return FALSE;
 }
 
 static gboolean
 poc_legend_draw (GtkWidget *widget, cairo_t *cr)
 {
   PocLegend *self = (PocLegend *) widget;
-  cairo_text_extents_t text_extents;
-  struct closure closure;
+  const struct entry *entry;
   const gchar *title;
   GtkStyleContext *style;
   GtkStateFlags state;
+  GdkRGBA foreground;
+  gdouble width, top, line_height, k;
+  gdouble clip_x1, clip_y1, clip_x2, clip_y2;
+  guint i, first, end;
 
   if (self->plot == NULL)
     return FALSE;
 
-#if X
-  if (self->relayout)
-    {
-      poc_legend_layout (self, cr);
-      self->relayout = FALSE;
-    }
-#endif
+  poc_legend_layout (self);
 
   style = gtk_widget_get_style_context (widget);
   state = gtk_style_context_get_state (style);
-  gtk_style_context_get_color (style, state, &closure.foreground);
+  gtk_style_context_get_color (style, state, &foreground);
 
-  closure.self = self;
-  closure.cr = cr;
-  closure.width = gtk_widget_get_allocated_width (widget);
-  //closure.height = gtk_widget_get_allocated_height (widget);
+  width = gtk_widget_get_allocated_width (widget);
+  cairo_clip_extents (cr, &clip_x1, &clip_y1, &clip_x2, &clip_y2);
 
+  top = 0.0;
   title = poc_plot_get_title (self->plot);
   if (title != NULL)
     {
-      cairo_set_font_size (cr, self->title_text_size);
-      cairo_font_extents (cr, &closure.font_extents);
-      cairo_text_extents (cr, title, &text_extents);
-
-      cairo_move_to (cr, round ((closure.width - text_extents.width) / 2.0),
-			 round (closure.font_extents.ascent));
-      gdk_cairo_set_source_rgba (cr, &closure.foreground);
-      cairo_show_text (cr, title);
-
-      closure.y = closure.font_extents.height;
+      if (clip_y1 < self->title_extents.height)
+	{
+	  cairo_set_font_size (cr, self->title_text_size);
+	  cairo_move_to (cr, round ((width - self->title_width) / 2.0),
+			 round (self->title_extents.ascent));
+	  gdk_cairo_set_source_rgba (cr, &foreground);
+	  cairo_show_text (cr, title);
+	}
+      top = self->title_extents.height;
     }
-  else
-    closure.y = 0;
+
+  /* Draw only the entries intersecting the clip region */
+  line_height = self->legend_extents.height * self->line_spacing;
+  if (line_height <= 0.0 || self->entries->len == 0)
+    return FALSE;
+  k = floor ((clip_y1 - top) / line_height);
+  first = k <= 0.0 ? 0 : k >= self->entries->len ? self->entries->len : (guint) k;
+  k = ceil ((clip_y2 - top) / line_height);
+  end = k <= 0.0 ? 0 : k >= self->entries->len ? self->entries->len : (guint) k;
 
   cairo_set_font_size (cr, self->legend_text_size);
-  cairo_font_extents (cr, &closure.font_extents);
   cairo_set_line_width (cr, 1.0);
-  poc_plot_dataset_foreach (self->plot, poc_legend_sample, &closure);
+  for (i = first; i < end; i++)
+    {
+      entry = &g_array_index (self->entries, struct entry, i);
+      poc_legend_sample (self, cr, entry, &foreground, width,
+			 top + line_height * i);
+    }
 
   return FALSE;
 }
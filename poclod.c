@@ -0,0 +1,192 @@
+/* This file is part of PocPlot.
+ *
+ * PocPlot is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * PocPlot is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with PocPlot; if not, see
+ * <https://www.gnu.org/licenses/>.
+ *
+ * Copyright 2020 Brian Stafford
+ */
+#include "poclod.h"
+
+/* A multi-resolution min/max summary of a line with non-decreasing X
+   coordinates.  Level 0 summarises blocks of LOD_BLOCK points and each
+   successive level summarises pairs of blocks from the level below.  A block
+   is represented by its minimum and maximum points, by Y, in their original
+   order so each level is itself a valid, much shorter, line which may be
+   drawn in place of the original data; an array of blocks is an array of
+   PocPoint which can be viewed with stride 2.
+
+   The summary is extended incrementally when points are appended; only the
+   last, possibly partial, block at each level is recomputed. */
+
+#define LOD_BLOCK	64
+#define LOD_MAX_LEVELS	32
+
+struct _PocLod
+  {
+    guint	n;
+    guint	n_levels;
+    GArray	*level[LOD_MAX_LEVELS];
+  };
+
+PocLod *
+poc_lod_new (void)
+{
+  return g_new0 (PocLod, 1);
+}
+
+void
+poc_lod_free (PocLod *lod)
+{
+  guint i;
+
+  for (i = 0; i < LOD_MAX_LEVELS; i++)
+    if (lod->level[i] != NULL)
+      g_array_unref (lod->level[i]);
+  g_free (lod);
+}
+
+void
+poc_lod_reset (PocLod *lod)
+{
+  guint i;
+
+  for (i = 0; i < lod->n_levels; i++)
+    g_array_set_size (lod->level[i], 0);
+  lod->n = 0;
+  lod->n_levels = 0;
+}
+
+/* Store the block's minimum and maximum keeping them in order. */
+static inline void
+lod_store (PocPoint *block, const PocPoint *min, guint i_min,
+	   const PocPoint *max, guint i_max)
+{
+  if (i_min <= i_max)
+    {
+      block[0] = *min;
+      block[1] = *max;
+    }
+  else
+    {
+      block[0] = *max;
+      block[1] = *min;
+    }
+}
+
+/* The block's y values are read into a buffer in one pass, converting them
+   from the vector's format; only the extreme points' x values are read */
+static void
+lod_summarise (PocPoint *block, const PocVector *x, const PocVector *y,
+	       guint start, guint end)
+{
+  gdouble v[LOD_BLOCK];
+  PocPoint min, max;
+  guint i, i_min, i_max;
+
+  poc_vector_read (y, start, end - start, v, 1);
+  i_min = i_max = 0;
+  for (i = 1; i < end - start; i++)
+    {
+      if (v[i] < v[i_min])
+	i_min = i;
+      if (v[i] > v[i_max])
+	i_max = i;
+    }
+  min.x = poc_vector_index (x, start + i_min);
+  min.y = v[i_min];
+  max.x = poc_vector_index (x, start + i_max);
+  max.y = v[i_max];
+  lod_store (block, &min, start + i_min, &max, start + i_max);
+}
+
+static void
+lod_merge (PocPoint *block, const PocPoint *lower, guint n_points)
+{
+  guint i, i_min, i_max;
+
+  i_min = i_max = 0;
+  for (i = 1; i < n_points; i++)
+    {
+      if (lower[i].y < lower[i_min].y)
+	i_min = i;
+      if (lower[i].y > lower[i_max].y)
+	i_max = i;
+    }
+  lod_store (block, &lower[i_min], i_min, &lower[i_max], i_max);
+}
+
+static GArray *
+lod_level (PocLod *lod, guint level, guint n_blocks)
+{
+  if (lod->level[level] == NULL)
+    lod->level[level] = g_array_new (FALSE, FALSE, sizeof (PocPoint));
+  g_array_set_size (lod->level[level], 2 * n_blocks);
+  return lod->level[level];
+}
+
+/* Summarise points [0, n).  Points below the previous count are assumed to
+   be unchanged; call poc_lod_reset() first otherwise. */
+void
+poc_lod_update (PocLod *lod, const PocVector *x, const PocVector *y, guint n)
+{
+  GArray *array, *lower;
+  guint level, changed, n_blocks, n_lower, b, start;
+
+  if (n < lod->n)
+    poc_lod_reset (lod);
+  if (n == lod->n)
+    return;
+
+  /* Level 0 summarises the points */
+  changed = lod->n / LOD_BLOCK;
+  n_blocks = (n + LOD_BLOCK - 1) / LOD_BLOCK;
+  array = lod_level (lod, 0, n_blocks);
+  for (b = changed; b < n_blocks; b++)
+    {
+      start = b * LOD_BLOCK;
+      lod_summarise (&g_array_index (array, PocPoint, 2 * b),
+		     x, y, start, MIN (n, start + LOD_BLOCK));
+    }
+
+  /* Higher levels summarise pairs of blocks until a single block remains */
+  for (level = 1; level < LOD_MAX_LEVELS && n_blocks > 1; level++)
+    {
+      lower = array;
+      n_lower = n_blocks;
+      changed /= 2;
+      n_blocks = (n_lower + 1) / 2;
+      array = lod_level (lod, level, n_blocks);
+      for (b = changed; b < n_blocks; b++)
+	lod_merge (&g_array_index (array, PocPoint, 2 * b),
+		   &g_array_index (lower, PocPoint, 4 * b),
+		   2 * b + 1 < n_lower ? 4 : 2);
+    }
+  lod->n_levels = level;
+  lod->n = n;
+}
+
+guint
+poc_lod_get_n_levels (PocLod *lod)
+{
+  return lod->n_levels;
+}
+
+const PocPoint *
+poc_lod_get_level (PocLod *lod, guint level, guint *n_points)
+{
+  g_return_val_if_fail (level < lod->n_levels, NULL);
+
+  *n_points = lod->level[level]->len;
+  return (const PocPoint *) lod->level[level]->data;
+}
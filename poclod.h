@@ -0,0 +1,44 @@
+/* This file is part of PocPlot.
+ *
+ * PocPlot is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * PocPlot is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with PocPlot; if not, see
+ * <https://www.gnu.org/licenses/>.
+ *
+ * Copyright 2020 Brian Stafford
+ */
+#ifndef _poclod_h
+#define _poclod_h
+
+#if !defined(__poc_h_inside__) && !defined(__poc_compile__)
+# error "only <poc.h> can be included directly"
+#endif
+
+#include "poctypes.h"
+
+G_BEGIN_DECLS
+
+typedef struct _PocLod PocLod;
+
+PocLod *	poc_lod_new		(void);
+void		poc_lod_free		(PocLod *lod);
+void		poc_lod_reset		(PocLod *lod);
+void		poc_lod_update		(PocLod *lod,
+					 const PocVector *x,
+					 const PocVector *y, guint n);
+guint		poc_lod_get_n_levels	(PocLod *lod);
+const PocPoint *poc_lod_get_level	(PocLod *lod, guint level,
+					 guint *n_points);
+
+G_END_DECLS
+
+#endif
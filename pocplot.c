@@ -18,8 +18,11 @@
  */
 #include "pocplot.h"
 #include "pocdataset.h"
+#include "pocdatasetspline.h"
 #include "pocaxis.h"
 #include "pocbag.h"
+#include "pocgl.h"
+#include "pocpool.h"
 #include "poctypes.h"
 
 #include <stdlib.h>
@@ -80,15 +83,39 @@ struct _PocPlot
 
   PocObjectBag		*axes;
   PocObjectBag		*datasets;
+  GHashTable		*nicknames;
   PocAxis		*x_axis;
   PocAxis		*y_axis;
 
   GdkRectangle		area;
   gint			width, height;
 
+  /* Cached background, frame and axes; grid */
+  cairo_surface_t	*base_layer;
+  cairo_surface_t	*grid_layer;
+  gint			layer_scale;
+
+  /* Deferred updates, see poc_plot_freeze_updates() */
+  guint			update_freeze;
+  GPtrArray		*frozen;
+  guint			tick_id;
+
+  /* Instrumentation of the most recent frame */
+  PocPlotFrameStats	*frame_stats;
+
+  /* OpenGL dataset rendering, see poc_plot_set_use_gl() */
+  PocGL			*gl;
+
   gint			solo;
   guint			enable_plot_fill : 1;
   guint			relayout : 1;
+  guint			dataset_layers : 1;
+  guint			threaded_datasets : 1;
+  guint			redraw_pending : 1;
+  guint			invalidate_pending : 1;
+  guint			frame_stats_enabled : 1;
+  guint			use_gl : 1;
+  guint			gl_failed : 1;
 };
 
 typedef struct _PocPlotAxis PocPlotAxis;
@@ -104,6 +131,9 @@ typedef struct _PocPlotDataset PocPlotDataset;
 struct _PocPlotDataset
   {
     gboolean solo;
+    gboolean dirty;
+    cairo_surface_t *layer;
+    gchar *nickname;
   };
 
 static void poc_plot_buildable_init (GtkBuildableIface *iface);
@@ -124,6 +154,108 @@ poc_plot_new (void)
   return g_object_new (POC_TYPE_PLOT, NULL);
 }
 
+/* frame statistics {{{1 */
+
+/**
+ * PocPlotDatasetStats:
+ * @dataset: The #PocDataset
+ * @draw_time: Time spent in the dataset's #PocDatasetClass.draw() method in
+ * 	microseconds, zero if a cached layer was reused
+ * @points: Number of points submitted for drawing
+ * @segments: Number of line segments added to the path
+ *
+ * Drawing statistics for a dataset in a #PocPlotFrameStats.
+ */
+
+/**
+ * PocPlotAxisStats:
+ * @axis: The #PocAxis
+ * @draw_time: Time spent drawing the axis in microseconds
+ *
+ * Drawing statistics for an axis in a #PocPlotFrameStats.  Axes are listed
+ * only for frames in which they were drawn rather than taken from the
+ * cached layer.
+ */
+
+/**
+ * PocPlotFrameStats:
+ * @frame_time: Total time spent drawing the frame
+ * @layout_time: Time spent laying out the plot, zero if not required
+ * @axes_time: Total time spent drawing axes
+ * @datasets_time: Time spent drawing or compositing the datasets
+ * @grid_time: Time spent drawing the grid, zero if the cached grid was used
+ * @n_datasets: Number of elements in @datasets
+ * @datasets: (array length=n_datasets): Statistics for each dataset
+ * @n_axes: Number of elements in @axes
+ * @axes: (array length=n_axes): Statistics for each axis drawn
+ *
+ * Statistics for a frame drawn by #PocPlot, see
+ * #PocPlot:frame-stats-enabled.  Times are in microseconds.  When datasets
+ * are rasterised on worker threads the per-dataset times overlap and may
+ * sum to more than @datasets_time.
+ */
+
+/**
+ * poc_plot_frame_stats_copy:
+ * @stats: A #PocPlotFrameStats
+ *
+ * Copy frame statistics.
+ *
+ * Returns: (transfer full): a new #PocPlotFrameStats
+ */
+PocPlotFrameStats *
+poc_plot_frame_stats_copy (const PocPlotFrameStats *stats)
+{
+  PocPlotFrameStats *copy;
+  guint i;
+
+  g_return_val_if_fail (stats != NULL, NULL);
+
+  copy = g_new (PocPlotFrameStats, 1);
+  *copy = *stats;
+  copy->datasets = g_new (PocPlotDatasetStats, stats->n_datasets);
+  for (i = 0; i < copy->n_datasets; i++)
+    {
+      copy->datasets[i] = stats->datasets[i];
+      g_object_ref (copy->datasets[i].dataset);
+    }
+  copy->axes = g_new (PocPlotAxisStats, stats->n_axes);
+  for (i = 0; i < copy->n_axes; i++)
+    {
+      copy->axes[i] = stats->axes[i];
+      g_object_ref (copy->axes[i].axis);
+    }
+  return copy;
+}
+
+/**
+ * poc_plot_frame_stats_free:
+ * @stats: A #PocPlotFrameStats
+ *
+ * Free frame statistics.
+ */
+void
+poc_plot_frame_stats_free (PocPlotFrameStats *stats)
+{
+  guint i;
+
+  g_return_if_fail (stats != NULL);
+
+  for (i = 0; i < stats->n_datasets; i++)
+    g_object_unref (stats->datasets[i].dataset);
+  g_free (stats->datasets);
+  for (i = 0; i < stats->n_axes; i++)
+    g_object_unref (stats->axes[i].axis);
+  g_free (stats->axes);
+  g_free (stats);
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+G_DEFINE_BOXED_TYPE (PocPlotFrameStats, poc_plot_frame_stats,
+		     poc_plot_frame_stats_copy, poc_plot_frame_stats_free)
+#pragma GCC diagnostic pop
+
 /* GObject {{{1 */
 
 enum
@@ -139,10 +271,24 @@ enum
     PROP_X_AXIS,
     PROP_Y_AXIS,
 
+    PROP_DATASET_LAYERS,
+    PROP_THREADED_DATASETS,
+    PROP_FRAME_STATS_ENABLED,
+    PROP_USE_GL,
+
     N_PROPERTIES
   };
 static GParamSpec *poc_plot_prop[N_PROPERTIES];
 
+enum
+  {
+    FRAME_STATS,
+    DATASET_ADDED,
+    DATASET_REMOVED,
+    N_SIGNAL
+  };
+static guint poc_plot_signals[N_SIGNAL];
+
 static void poc_plot_dispose (GObject *object);
 static void poc_plot_finalize (GObject *object);
 static void poc_plot_get_property (GObject *object, guint param_id,
@@ -150,6 +296,20 @@ static void poc_plot_get_property (GObject *object, guint param_id,
 static void poc_plot_set_property (GObject *object, guint param_id,
 				   const GValue *value, GParamSpec *pspec);
 static gboolean poc_plot_draw (GtkWidget *widget, cairo_t *cr);
+static void poc_plot_style_updated (GtkWidget *widget);
+static void poc_plot_unrealize (GtkWidget *widget);
+static void poc_plot_invalidate_layers (PocPlot *self);
+static void poc_plot_dataset_update (PocDataset *dataset, PocPlot *self);
+static void poc_plot_invalidate_dataset_layers (PocPlot *self, gboolean discard);
+static void poc_plot_queue_redraw (PocPlot *self);
+static void poc_plot_collect_dataset_stats (gpointer object,
+					    gpointer object_data,
+					    gpointer user_data);
+static void poc_plot_flush_invalidate (PocPlot *self);
+static gboolean poc_plot_prepare_datasets (PocPlot *self);
+static void poc_plot_flush_datasets (PocPlot *self);
+static gboolean poc_plot_tick (GtkWidget *widget, GdkFrameClock *frame_clock,
+			       gpointer user_data);
 
 static void
 poc_plot_class_init (PocPlotClass *class)
@@ -164,6 +324,8 @@ poc_plot_class_init (PocPlotClass *class)
 
   gtk_widget_class_set_css_name (widget_class, "plot");
   widget_class->draw = poc_plot_draw;
+  widget_class->style_updated = poc_plot_style_updated;
+  widget_class->unrealize = poc_plot_unrealize;
 
   /*FIXME - the following should be specified by CSS */
   poc_plot_prop[PROP_ENABLE_PLOT_FILL] = g_param_spec_boolean (
@@ -203,7 +365,80 @@ poc_plot_class_init (PocPlotClass *class)
         POC_TYPE_AXIS,
         G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
 
+  poc_plot_prop[PROP_DATASET_LAYERS] = g_param_spec_boolean (
+	"dataset-layers",
+	"Dataset Layers", "Render each dataset to its own cached layer",
+	FALSE,
+	G_PARAM_EXPLICIT_NOTIFY |
+	G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+  poc_plot_prop[PROP_THREADED_DATASETS] = g_param_spec_boolean (
+	"threaded-datasets",
+	"Threaded Datasets", "Rasterise datasets on worker threads",
+	FALSE,
+	G_PARAM_EXPLICIT_NOTIFY |
+	G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+  poc_plot_prop[PROP_FRAME_STATS_ENABLED] = g_param_spec_boolean (
+	"frame-stats-enabled",
+	"Frame Statistics Enabled", "Measure the time spent drawing each frame",
+	FALSE,
+	G_PARAM_EXPLICIT_NOTIFY |
+	G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+  poc_plot_prop[PROP_USE_GL] = g_param_spec_boolean (
+	"use-gl",
+	"Use OpenGL", "Draw datasets with OpenGL where possible",
+	FALSE,
+	G_PARAM_EXPLICIT_NOTIFY |
+	G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, N_PROPERTIES, poc_plot_prop);
+
+  /**
+   * PocPlot::frame-stats:
+   * @plot: The #PocPlot
+   * @stats: A #PocPlotFrameStats for the frame just drawn
+   *
+   * Emitted after each frame is drawn while
+   * #PocPlot:frame-stats-enabled is set.  @stats is owned by the plot and
+   * is valid only for the duration of the signal emission; use
+   * poc_plot_frame_stats_copy() to keep it.
+   */
+  poc_plot_signals[FRAME_STATS] = g_signal_new (
+	"frame-stats", G_TYPE_FROM_CLASS (class),
+	G_SIGNAL_RUN_LAST | G_SIGNAL_NO_HOOKS,
+	0, NULL, NULL,
+	g_cclosure_marshal_VOID__BOXED, G_TYPE_NONE,
+	1, POC_TYPE_PLOT_FRAME_STATS | G_SIGNAL_TYPE_STATIC_SCOPE);
+
+  /**
+   * PocPlot::dataset-added:
+   * @plot: The #PocPlot
+   * @dataset: The #PocDataset added
+   *
+   * Emitted when a dataset is added to the plot with
+   * poc_plot_add_dataset().  Adding a dataset already in the plot does not
+   * emit the signal.
+   */
+  poc_plot_signals[DATASET_ADDED] = g_signal_new (
+	"dataset-added", G_TYPE_FROM_CLASS (class),
+	G_SIGNAL_RUN_LAST | G_SIGNAL_NO_HOOKS,
+	0, NULL, NULL,
+	g_cclosure_marshal_VOID__OBJECT, G_TYPE_NONE,
+	1, POC_TYPE_DATASET);
+
+  /**
+   * PocPlot::dataset-removed:
+   * @plot: The #PocPlot
+   * @dataset: The #PocDataset removed
+   *
+   * Emitted when a dataset is removed from the plot, either by
+   * poc_plot_remove_dataset() or poc_plot_clear_dataset().
+   */
+  poc_plot_signals[DATASET_REMOVED] = g_signal_new (
+	"dataset-removed", G_TYPE_FROM_CLASS (class),
+	G_SIGNAL_RUN_LAST | G_SIGNAL_NO_HOOKS,
+	0, NULL, NULL,
+	g_cclosure_marshal_VOID__OBJECT, G_TYPE_NONE,
+	1, POC_TYPE_DATASET);
 }
 
 static void
@@ -215,6 +450,8 @@ poc_plot_init (PocPlot *self)
 
   self->axes = poc_object_bag_new ();
   self->datasets = poc_object_bag_new ();
+  self->nicknames = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+					   (GDestroyNotify) g_queue_free);
 }
 
 static void
@@ -222,11 +459,22 @@ poc_plot_dispose (GObject *object)
 {
   PocPlot *self = (PocPlot *) object;
 
+  /* Thawing may queue a redraw, so remove the tick callback afterwards */
+  while (self->update_freeze > 0)
+    poc_plot_thaw_updates (self);
+  if (self->tick_id != 0)
+    {
+      gtk_widget_remove_tick_callback (GTK_WIDGET (self), self->tick_id);
+      self->tick_id = 0;
+    }
+  self->redraw_pending = FALSE;
+  g_clear_pointer (&self->gl, poc_gl_free);
   g_clear_object (&self->x_axis);
   g_clear_object (&self->y_axis);
   if (self->datasets != NULL)
     poc_object_bag_unref (self->datasets);
   self->datasets = NULL;
+  g_clear_pointer (&self->nicknames, g_hash_table_unref);
   if (self->axes != NULL)
     poc_object_bag_unref (self->axes);
   self->axes = NULL;
@@ -238,6 +486,8 @@ poc_plot_finalize (GObject *object)
 {
   PocPlot *self = (PocPlot *) object;
 
+  poc_plot_invalidate_layers (self);
+  g_clear_pointer (&self->frame_stats, poc_plot_frame_stats_free);
   g_free (self->title);
   G_OBJECT_CLASS (poc_plot_parent_class)->finalize (object);
 }
@@ -271,6 +521,19 @@ poc_plot_set_property (GObject *object, guint prop_id,
       poc_plot_set_y_axis (self, g_value_get_object (value));
       break;
 
+    case PROP_DATASET_LAYERS:
+      poc_plot_set_dataset_layers (self, g_value_get_boolean (value));
+      break;
+    case PROP_THREADED_DATASETS:
+      poc_plot_set_threaded_datasets (self, g_value_get_boolean (value));
+      break;
+    case PROP_FRAME_STATS_ENABLED:
+      poc_plot_set_frame_stats_enabled (self, g_value_get_boolean (value));
+      break;
+    case PROP_USE_GL:
+      poc_plot_set_use_gl (self, g_value_get_boolean (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       return;
@@ -308,6 +571,19 @@ poc_plot_get_property (GObject *object, guint prop_id,
       g_value_set_object (value, poc_plot_get_y_axis (self));
       break;
 
+    case PROP_DATASET_LAYERS:
+      g_value_set_boolean (value, poc_plot_get_dataset_layers (self));
+      break;
+    case PROP_THREADED_DATASETS:
+      g_value_set_boolean (value, poc_plot_get_threaded_datasets (self));
+      break;
+    case PROP_FRAME_STATS_ENABLED:
+      g_value_set_boolean (value, poc_plot_get_frame_stats_enabled (self));
+      break;
+    case PROP_USE_GL:
+      g_value_set_boolean (value, poc_plot_get_use_gl (self));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -558,6 +834,213 @@ poc_plot_set_axis (PocPlot *self, PocAxis *axis)
     poc_plot_set_y_axis (self, axis);
 }
 
+/* "dataset-layers" {{{2 */
+
+/**
+ * poc_plot_set_dataset_layers:
+ * @self: A #PocPlot
+ * @value: %TRUE to cache each dataset in its own layer.
+ *
+ * Set whether each dataset is rendered into its own cached layer.  When
+ * enabled an update to one dataset redraws only that dataset's layer and the
+ * plot is recomposited from the cached layers.  This suits plots with many
+ * datasets of which only a few change at a time, at the cost of an offscreen
+ * surface the size of the plot area for each dataset.
+ */
+void
+poc_plot_set_dataset_layers (PocPlot *self, gboolean value)
+{
+  g_return_if_fail (POC_IS_PLOT (self));
+
+  value = !!value;
+  if (self->dataset_layers == (guint) value)
+    return;
+  self->dataset_layers = value;
+  poc_plot_invalidate_dataset_layers (self, TRUE);
+  poc_plot_queue_redraw (self);
+  g_object_notify_by_pspec (G_OBJECT (self), poc_plot_prop[PROP_DATASET_LAYERS]);
+}
+
+/**
+ * poc_plot_get_dataset_layers:
+ * @self: A #PocPlot
+ *
+ * Get whether each dataset is rendered into its own cached layer.
+ *
+ * Returns: %TRUE if dataset layers are enabled.
+ */
+gboolean
+poc_plot_get_dataset_layers (PocPlot *self)
+{
+  g_return_val_if_fail (POC_IS_PLOT (self), FALSE);
+
+  return self->dataset_layers;
+}
+
+/* "threaded-datasets" {{{2 */
+
+/**
+ * poc_plot_set_threaded_datasets:
+ * @self: A #PocPlot
+ * @value: %TRUE to rasterise datasets on worker threads.
+ *
+ * Set whether datasets are rasterised in parallel.  When enabled each dataset
+ * is drawn into its own image surface on a pool of worker threads and the
+ * results are composited in order on the main thread.  If
+ * #PocPlot:dataset-layers is also enabled only datasets which have been
+ * updated are rasterised again.
+ *
+ * Dataset #PocDatasetClass.draw() implementations are called on worker
+ * threads in this mode, see #PocDatasetClass for the requirements.
+ */
+void
+poc_plot_set_threaded_datasets (PocPlot *self, gboolean value)
+{
+  g_return_if_fail (POC_IS_PLOT (self));
+
+  value = !!value;
+  if (self->threaded_datasets == (guint) value)
+    return;
+  self->threaded_datasets = value;
+  poc_plot_invalidate_dataset_layers (self, TRUE);
+  poc_plot_queue_redraw (self);
+  g_object_notify_by_pspec (G_OBJECT (self), poc_plot_prop[PROP_THREADED_DATASETS]);
+}
+
+/**
+ * poc_plot_get_threaded_datasets:
+ * @self: A #PocPlot
+ *
+ * Get whether datasets are rasterised on worker threads.
+ *
+ * Returns: %TRUE if threaded rasterisation is enabled.
+ */
+gboolean
+poc_plot_get_threaded_datasets (PocPlot *self)
+{
+  g_return_val_if_fail (POC_IS_PLOT (self), FALSE);
+
+  return self->threaded_datasets;
+}
+
+/* "frame-stats-enabled" {{{2 */
+
+/**
+ * poc_plot_set_frame_stats_enabled:
+ * @self: A #PocPlot
+ * @value: %TRUE to collect frame statistics.
+ *
+ * Set whether the plot measures where time is spent drawing each frame.
+ * When enabled, the time taken to lay out the plot, to draw each axis, each
+ * dataset and the grid, and the number of points and line segments drawn
+ * for each dataset, are recorded and reported with the
+ * #PocPlot::frame-stats signal and poc_plot_get_frame_stats().
+ */
+void
+poc_plot_set_frame_stats_enabled (PocPlot *self, gboolean value)
+{
+  g_return_if_fail (POC_IS_PLOT (self));
+
+  value = !!value;
+  if (self->frame_stats_enabled == (guint) value)
+    return;
+  self->frame_stats_enabled = value;
+  if (value)
+    /* Discard anything accumulated by the datasets in the meantime */
+    poc_object_bag_foreach (self->datasets, poc_plot_collect_dataset_stats,
+			    NULL);
+  else
+    g_clear_pointer (&self->frame_stats, poc_plot_frame_stats_free);
+  g_object_notify_by_pspec (G_OBJECT (self), poc_plot_prop[PROP_FRAME_STATS_ENABLED]);
+}
+
+/**
+ * poc_plot_get_frame_stats_enabled:
+ * @self: A #PocPlot
+ *
+ * Get whether the plot collects frame statistics.
+ *
+ * Returns: %TRUE if frame statistics are collected.
+ */
+gboolean
+poc_plot_get_frame_stats_enabled (PocPlot *self)
+{
+  g_return_val_if_fail (POC_IS_PLOT (self), FALSE);
+
+  return self->frame_stats_enabled;
+}
+
+/* "use-gl" {{{2 */
+
+/**
+ * poc_plot_set_use_gl:
+ * @self: A #PocPlot
+ * @value: %TRUE to draw datasets with OpenGL.
+ *
+ * Set whether datasets are drawn with OpenGL.  Each dataset's points are
+ * uploaded to a vertex buffer on the GPU once, and again only after the
+ * dataset emits #PocDataset::update; the axis projection is performed in a
+ * vertex shader so panning and zooming the axes costs little more than
+ * redrawing.  The background, axes, labels and grid are still drawn with
+ * cairo and the GL output is composited with them in the dataset order.
+ *
+ * Only datasets drawn by #PocDataset itself with %POC_LINE_STYLE_SOLID are
+ * drawn with OpenGL.  Every visible point is drawn, #PocDataset:decimation
+ * is not applied, and lines are not antialiased.  Other datasets, such as
+ * #PocDatasetSpline, are drawn with cairo as usual.  If OpenGL is not
+ * available, or the library was built without it, all datasets are drawn
+ * with cairo.
+ */
+void
+poc_plot_set_use_gl (PocPlot *self, gboolean value)
+{
+  g_return_if_fail (POC_IS_PLOT (self));
+
+  value = !!value;
+  if (self->use_gl == (guint) value)
+    return;
+  self->use_gl = value;
+  if (!value)
+    g_clear_pointer (&self->gl, poc_gl_free);
+  self->gl_failed = FALSE;
+  poc_plot_invalidate_dataset_layers (self, TRUE);
+  poc_plot_queue_redraw (self);
+  g_object_notify_by_pspec (G_OBJECT (self), poc_plot_prop[PROP_USE_GL]);
+}
+
+/**
+ * poc_plot_get_use_gl:
+ * @self: A #PocPlot
+ *
+ * Get whether datasets are drawn with OpenGL.
+ *
+ * Returns: %TRUE if OpenGL drawing is requested.
+ */
+gboolean
+poc_plot_get_use_gl (PocPlot *self)
+{
+  g_return_val_if_fail (POC_IS_PLOT (self), FALSE);
+
+  return self->use_gl;
+}
+
+/**
+ * poc_plot_get_frame_stats:
+ * @self: A #PocPlot
+ *
+ * Get the statistics for the most recently drawn frame.
+ *
+ * Returns: (transfer none) (nullable): a #PocPlotFrameStats or %NULL if
+ * statistics are not enabled or no frame has been drawn since.
+ */
+const PocPlotFrameStats *
+poc_plot_get_frame_stats (PocPlot *self)
+{
+  g_return_val_if_fail (POC_IS_PLOT (self), NULL);
+
+  return self->frame_stats;
+}
+
 /* draw {{{1 */
 
 struct poc_plot_closure
@@ -570,6 +1053,14 @@ struct poc_plot_closure
     guint x_offset_end;
     guint y_offset_start;
     guint y_offset_end;
+    /* Explicit colours used instead of style by poc_plot_render() */
+    const GdkRGBA *grid_stroke;
+    const GdkRGBA *text_fill;
+    /* PocPlotAxisStats when collecting frame statistics */
+    GArray *axis_stats;
+    /* Datasets drawn with GL awaiting poc_gl_end() */
+    PocGL *gl;
+    gboolean gl_pending;
   };
 
 static void poc_plot_layout (PocPlot *self, struct poc_plot_closure *closure);
@@ -582,105 +1073,613 @@ poc_plot_draw_dataset (gpointer object, gpointer object_data,
   PocPlotDataset *dataset_data = object_data;
   struct poc_plot_closure *closure = user_data;
   PocPlot *self = closure->self;
+  cairo_t *cr;
+
+  if (self->solo != 0 && !dataset_data->solo)
+    return;
+
+  /* If GL cannot draw this frame the remaining datasets are drawn with
+     cairo */
+  if (closure->gl != NULL && poc_gl_can_draw (dataset) && !closure->gl_pending
+      && !poc_gl_begin (closure->gl, self->area.width, self->area.height,
+			self->layer_scale))
+    closure->gl = NULL;
+  if (closure->gl != NULL && poc_gl_can_draw (dataset))
+    {
+      closure->gl_pending = TRUE;
+      poc_gl_draw_dataset (closure->gl, dataset,
+			   self->area.width, self->area.height);
+      return;
+    }
+
+  /* Composite the datasets drawn with GL so far to preserve the order */
+  if (closure->gl_pending)
+    {
+      poc_gl_end (closure->gl, closure->cr);
+      closure->gl_pending = FALSE;
+    }
 
-  if (self->solo == 0 || dataset_data->solo)
-    poc_dataset_draw (dataset, closure->cr, self->area.width, self->area.height);
+  if ((!self->dataset_layers && !self->threaded_datasets)
+      || closure->style == NULL)
+    {
+      poc_dataset_draw (dataset, closure->cr, self->area.width, self->area.height);
+      return;
+    }
+
+  /* Redraw the dataset's layer only if it has been updated */
+  if (dataset_data->layer == NULL)
+    {
+      dataset_data->layer = cairo_surface_create_similar (
+				cairo_get_target (closure->cr),
+				CAIRO_CONTENT_COLOR_ALPHA,
+				self->area.width, self->area.height);
+      dataset_data->dirty = TRUE;
+    }
+  if (dataset_data->dirty)
+    {
+      cr = cairo_create (dataset_data->layer);
+      cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+      cairo_paint (cr);
+      cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+      poc_dataset_draw (dataset, cr, self->area.width, self->area.height);
+      cairo_destroy (cr);
+      dataset_data->dirty = FALSE;
+    }
+  cairo_set_source_surface (closure->cr, dataset_data->layer, 0.0, 0.0);
+  cairo_paint (closure->cr);
 }
 
+/* threaded rasterisation {{{2 */
+
+struct poc_plot_raster
+  {
+    PocDataset *dataset;
+    cairo_surface_t *layer;
+    guint width, height;
+  };
+
+struct poc_plot_raster_closure
+  {
+    PocPlot *self;
+    GArray *rasters;
+    gint scale;
+  };
+
 static void
-poc_plot_draw_axis (gpointer object, gpointer object_data, gpointer user_data)
+poc_plot_collect_raster (gpointer object, gpointer object_data,
+			 gpointer user_data)
 {
-  PocAxis *axis = object;
-  PocPlotAxis *axis_data = object_data;
-  struct poc_plot_closure *closure = user_data;
+  PocPlotDataset *dataset_data = object_data;
+  struct poc_plot_raster_closure *closure = user_data;
+  PocPlot *self = closure->self;
+  struct poc_plot_raster raster;
 
-  if (axis_data->hidden)
+  if (self->solo != 0 && !dataset_data->solo)
+    return;
+  if (self->gl != NULL && poc_gl_can_draw (POC_DATASET (object)))
     return;
 
-  cairo_save (closure->cr);
-  gdk_cairo_rectangle (closure->cr, &axis_data->area);
-  cairo_clip (closure->cr);
-  cairo_translate (closure->cr, axis_data->area.x, axis_data->area.y);
-  poc_axis_draw_axis (axis, closure->cr,
-		      axis_data->orientation, axis_data->pack,
-		      axis_data->area.width, axis_data->area.height,
-		      closure->style);
-  cairo_restore (closure->cr);
+  if (dataset_data->layer == NULL)
+    {
+      dataset_data->layer = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+					self->area.width * closure->scale,
+					self->area.height * closure->scale);
+      cairo_surface_set_device_scale (dataset_data->layer,
+				      closure->scale, closure->scale);
+      dataset_data->dirty = TRUE;
+    }
+  if (dataset_data->dirty || !self->dataset_layers)
+    {
+      raster.dataset = POC_DATASET (object);
+      raster.layer = dataset_data->layer;
+      raster.width = self->area.width;
+      raster.height = self->area.height;
+      g_array_append_val (closure->rasters, raster);
+      dataset_data->dirty = FALSE;
+    }
 }
 
-static gboolean
-poc_plot_draw (GtkWidget *widget, cairo_t *cr)
+/* Called on a worker thread */
+static void
+poc_plot_rasterise (gpointer data, G_GNUC_UNUSED gpointer user_data)
 {
-  PocPlot *self = (PocPlot *) widget;
-  struct poc_plot_closure closure = { NULL, NULL, NULL, { 0, 0, 0, 0 }, 0, 0, 0, 0 };
-  GtkStyleContext *style;
-  GtkBorder border;
-  GtkStateFlags state;
+  struct poc_plot_raster *raster = data;
+  cairo_t *cr;
+
+  cr = cairo_create (raster->layer);
+  cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+  cairo_paint (cr);
+  cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+  poc_dataset_draw (raster->dataset, cr, raster->width, raster->height);
+  cairo_destroy (cr);
+}
 
-  style = gtk_widget_get_style_context (widget);
-  state = gtk_style_context_get_state (style);
+/* Rasterise dirty datasets into their layers on the thread pool */
+static void
+poc_plot_rasterise_datasets (PocPlot *self, gint scale)
+{
+  struct poc_plot_raster_closure closure;
+  gpointer *items;
+  guint i;
 
   closure.self = self;
-  closure.cr = cr;
-  closure.area.width = gtk_widget_get_allocated_width (widget);
-  closure.area.height = gtk_widget_get_allocated_height (widget);
-  closure.style = style;
-
-  gtk_render_background (style, cr, closure.area.x, closure.area.y,
-			 closure.area.width, closure.area.height);
-  gtk_render_frame (style, cr, closure.area.x, closure.area.y,
-  		    closure.area.width, closure.area.height);
+  closure.rasters = g_array_new (FALSE, FALSE, sizeof (struct poc_plot_raster));
+  closure.scale = scale;
+  poc_object_bag_foreach (self->datasets, poc_plot_collect_raster, &closure);
 
-  gtk_style_context_get_border (style, state, &border);
-  closure.area.x += border.left;
-  closure.area.y += border.top;
-  closure.area.width -= border.right + border.left;
-  closure.area.height -= border.bottom + border.top;
+  items = g_new (gpointer, closure.rasters->len);
+  for (i = 0; i < closure.rasters->len; i++)
+    items[i] = &g_array_index (closure.rasters, struct poc_plot_raster, i);
+  poc_pool_run (poc_plot_rasterise, items, closure.rasters->len, NULL);
 
-  gtk_style_context_get_padding (style, state, &border);
-  closure.area.x += border.left;
-  closure.area.y += border.top;
-  closure.area.width -= border.right + border.left;
-  closure.area.height -= border.bottom + border.top;
+  g_free (items);
+  g_array_unref (closure.rasters);
+}
 
-  if (self->relayout || closure.area.width != self->width || closure.area.height != self->height)
-    {
-      poc_plot_layout (self, &closure);
-      self->relayout = FALSE;
-      self->width = closure.area.width;
-      self->height = closure.area.height;
-    }
+/* spline precomputation {{{2 */
 
-  /* Draw axes */
-  poc_object_bag_foreach (self->axes, poc_plot_draw_axis, &closure);
+struct poc_plot_spline_closure
+  {
+    PocPlot *self;
+    GPtrArray *splines;
+  };
 
-  /**** draw the plot background ****/
-  cairo_save (cr);
-  gdk_cairo_rectangle (cr, &self->area);
+static void
+poc_plot_collect_spline (gpointer object, gpointer object_data,
+			 gpointer user_data)
+{
+  PocPlotDataset *dataset_data = object_data;
+  struct poc_plot_spline_closure *closure = user_data;
+  PocPlot *self = closure->self;
+
+  if (self->solo != 0 && !dataset_data->solo)
+    return;
+  if (POC_IS_DATASET_SPLINE (object))
+    g_ptr_array_add (closure->splines, object);
+}
+
+/* Solve and sample stale spline curves in parallel so that drawing each
+   spline dataset need only stroke it */
+static void
+poc_plot_update_splines (PocPlot *self)
+{
+  struct poc_plot_spline_closure closure;
+
+  closure.self = self;
+  closure.splines = g_ptr_array_new ();
+  poc_object_bag_foreach (self->datasets, poc_plot_collect_spline, &closure);
+  if (closure.splines->len > 1)
+    poc_dataset_spline_update_batch ((PocDatasetSpline **) closure.splines->pdata,
+				     closure.splines->len, self->area.width,
+				     self->area.height);
+  g_ptr_array_unref (closure.splines);
+}
+
+/* layer invalidation {{{2 */
+
+static void
+poc_plot_invalidate_dataset_layer (G_GNUC_UNUSED gpointer object,
+				   gpointer object_data, gpointer user_data)
+{
+  PocPlotDataset *dataset_data = object_data;
+  gboolean discard = GPOINTER_TO_INT (user_data);
+
+  dataset_data->dirty = TRUE;
+  if (discard && dataset_data->layer != NULL)
+    {
+      cairo_surface_destroy (dataset_data->layer);
+      dataset_data->layer = NULL;
+    }
+}
+
+/* Mark all dataset layers for redrawing, discarding the surfaces if the plot
+   area size has changed */
+static void
+poc_plot_invalidate_dataset_layers (PocPlot *self, gboolean discard)
+{
+  if (self->datasets != NULL)
+    poc_object_bag_foreach (self->datasets, poc_plot_invalidate_dataset_layer,
+			    GINT_TO_POINTER (discard));
+}
+
+static void
+poc_plot_draw_axis (gpointer object, gpointer object_data, gpointer user_data)
+{
+  PocAxis *axis = object;
+  PocPlotAxis *axis_data = object_data;
+  struct poc_plot_closure *closure = user_data;
+  PocPlotAxisStats stats;
+
+  if (axis_data->hidden)
+    return;
+
+  stats.draw_time = g_get_monotonic_time ();
+  cairo_save (closure->cr);
+  gdk_cairo_rectangle (closure->cr, &axis_data->area);
+  cairo_clip (closure->cr);
+  cairo_translate (closure->cr, axis_data->area.x, axis_data->area.y);
+  if (closure->style != NULL)
+    poc_axis_draw_axis (axis, closure->cr,
+			axis_data->orientation, axis_data->pack,
+			axis_data->area.width, axis_data->area.height,
+			closure->style);
+  else
+    poc_axis_draw_axis_rgba (axis, closure->cr,
+			     axis_data->orientation, axis_data->pack,
+			     axis_data->area.width, axis_data->area.height,
+			     closure->grid_stroke, closure->text_fill);
+  cairo_restore (closure->cr);
+
+  if (closure->axis_stats != NULL)
+    {
+      stats.axis = g_object_ref (axis);
+      stats.draw_time = g_get_monotonic_time () - stats.draw_time;
+      g_array_append_val (closure->axis_stats, stats);
+    }
+}
+
+/* Discard the cached layers so they are redrawn on the next frame */
+static void
+poc_plot_invalidate_layers (PocPlot *self)
+{
+  if (self->base_layer != NULL)
+    {
+      cairo_surface_destroy (self->base_layer);
+      self->base_layer = NULL;
+    }
+  if (self->grid_layer != NULL)
+    {
+      cairo_surface_destroy (self->grid_layer);
+      self->grid_layer = NULL;
+    }
+}
+
+/* Render the widget background and frame, the axes and the plot fill */
+static void
+poc_plot_draw_base (PocPlot *self, struct poc_plot_closure *closure,
+		    gint width, gint height)
+{
+  cairo_t *cr = closure->cr;
+
+  gtk_render_background (closure->style, cr, 0, 0, width, height);
+  gtk_render_frame (closure->style, cr, 0, 0, width, height);
+
+  /* Draw axes */
+  poc_object_bag_foreach (self->axes, poc_plot_draw_axis, closure);
+
+  /**** draw the plot background ****/
   if (self->enable_plot_fill)
     {
+      gdk_cairo_rectangle (cr, &self->area);
       gdk_cairo_set_source_rgba (cr, &self->plot_fill);
-      cairo_fill_preserve (cr);
+      cairo_fill (cr);
     }
-  cairo_clip (cr);
-  cairo_translate (cr, self->area.x, self->area.y);
-
-  /* Draw each dataset */
-  poc_object_bag_foreach (self->datasets, poc_plot_draw_dataset, &closure);
+}
 
-  /* Draw the grid */
+/* Render the grid for the current axes */
+static void
+poc_plot_draw_grid (PocPlot *self, cairo_t *cr, GtkStyleContext *style)
+{
   if (self->x_axis != NULL)
     poc_axis_draw_grid (self->x_axis, cr, GTK_ORIENTATION_HORIZONTAL,
 			self->area.width, self->area.height, style);
   if (self->y_axis != NULL)
     poc_axis_draw_grid (self->y_axis, cr, GTK_ORIENTATION_VERTICAL,
 			self->area.width, self->area.height, style);
+}
 
-  cairo_restore (cr);
+/* frame statistics {{{2 */
+
+static void
+poc_plot_collect_dataset_stats (gpointer object,
+				G_GNUC_UNUSED gpointer object_data,
+				gpointer user_data)
+{
+  GArray *array = user_data;
+  PocPlotDatasetStats stats;
+
+  poc_dataset_take_draw_stats (POC_DATASET (object), &stats.draw_time,
+			       &stats.points, &stats.segments);
+  if (array != NULL)
+    {
+      stats.dataset = g_object_ref (object);
+      g_array_append_val (array, stats);
+    }
+}
+
+/* Gather the dataset statistics, replace the previous frame's statistics
+   and announce the new ones */
+static void
+poc_plot_finish_frame_stats (PocPlot *self, PocPlotFrameStats *stats,
+			     GArray *axis_stats)
+{
+  GArray *datasets;
+  guint i;
+
+  datasets = g_array_new (FALSE, FALSE, sizeof (PocPlotDatasetStats));
+  poc_object_bag_foreach (self->datasets, poc_plot_collect_dataset_stats,
+			  datasets);
+  stats->n_datasets = datasets->len;
+  stats->datasets = (gpointer) g_array_free (datasets, FALSE);
+
+  stats->n_axes = axis_stats->len;
+  for (i = 0; i < axis_stats->len; i++)
+    stats->axes_time += g_array_index (axis_stats, PocPlotAxisStats, i).draw_time;
+  stats->axes = (gpointer) g_array_free (axis_stats, FALSE);
+
+  g_clear_pointer (&self->frame_stats, poc_plot_frame_stats_free);
+  self->frame_stats = stats;
+  g_signal_emit (self, poc_plot_signals[FRAME_STATS], 0, stats);
+}
+
+/* Create the GL context for drawing datasets on first use, falling back to
+   cairo if OpenGL is unavailable */
+static PocGL *
+poc_plot_get_gl (PocPlot *self)
+{
+  GError *error = NULL;
 
+  if (!self->use_gl || self->gl_failed)
+    return NULL;
+  if (self->gl == NULL)
+    {
+      self->gl = poc_gl_new (gtk_widget_get_window (GTK_WIDGET (self)), &error);
+      if (self->gl == NULL)
+	{
+	  g_warning ("OpenGL unavailable, drawing datasets with cairo: %s",
+		     error->message);
+	  g_error_free (error);
+	  self->gl_failed = TRUE;
+	}
+    }
+  return self->gl;
+}
+
+static gboolean
+poc_plot_draw (GtkWidget *widget, cairo_t *cr)
+{
+  PocPlot *self = (PocPlot *) widget;
+  struct poc_plot_closure closure = { NULL, NULL, NULL, { 0, 0, 0, 0 }, 0, 0, 0, 0, NULL, NULL, NULL, NULL, FALSE };
+  GtkStyleContext *style;
+  GtkBorder border;
+  GtkStateFlags state;
+  gint width, height;
+  cairo_t *lcr;
+  PocPlotFrameStats *stats = NULL;
+  gint64 start;
+
+  if (self->frame_stats_enabled)
+    {
+      stats = g_new0 (PocPlotFrameStats, 1);
+      stats->frame_time = g_get_monotonic_time ();
+      closure.axis_stats = g_array_new (FALSE, FALSE, sizeof (PocPlotAxisStats));
+    }
+
+  style = gtk_widget_get_style_context (widget);
+  state = gtk_style_context_get_state (style);
+
+  /* Without a tick callback the datasets were not prepared for this frame */
+  if (self->tick_id == 0 && poc_plot_prepare_datasets (self))
+    self->tick_id = gtk_widget_add_tick_callback (widget, poc_plot_tick,
+						  NULL, NULL);
+  self->redraw_pending = FALSE;
+  poc_plot_flush_invalidate (self);
+  closure.self = self;
+  closure.area.width = width = gtk_widget_get_allocated_width (widget);
+  closure.area.height = height = gtk_widget_get_allocated_height (widget);
+  closure.style = style;
+
+  gtk_style_context_get_border (style, state, &border);
+  closure.area.x += border.left;
+  closure.area.y += border.top;
+  closure.area.width -= border.right + border.left;
+  closure.area.height -= border.bottom + border.top;
+
+  gtk_style_context_get_padding (style, state, &border);
+  closure.area.x += border.left;
+  closure.area.y += border.top;
+  closure.area.width -= border.right + border.left;
+  closure.area.height -= border.bottom + border.top;
+
+  if (self->relayout || closure.area.width != self->width || closure.area.height != self->height)
+    {
+      start = g_get_monotonic_time ();
+      poc_plot_layout (self, &closure);
+      if (stats != NULL)
+	stats->layout_time = g_get_monotonic_time () - start;
+      self->relayout = FALSE;
+      self->width = closure.area.width;
+      self->height = closure.area.height;
+      poc_plot_invalidate_layers (self);
+      poc_plot_invalidate_dataset_layers (self, TRUE);
+    }
+  if (self->layer_scale != gtk_widget_get_scale_factor (widget))
+    {
+      self->layer_scale = gtk_widget_get_scale_factor (widget);
+      poc_plot_invalidate_layers (self);
+      poc_plot_invalidate_dataset_layers (self, TRUE);
+    }
+
+  /* Background, frame, axes and plot fill */
+  if (self->base_layer == NULL)
+    {
+      self->base_layer = cairo_surface_create_similar (cairo_get_target (cr),
+						       CAIRO_CONTENT_COLOR_ALPHA,
+						       width, height);
+      closure.cr = lcr = cairo_create (self->base_layer);
+      poc_plot_draw_base (self, &closure, width, height);
+      cairo_destroy (lcr);
+    }
+  cairo_set_source_surface (cr, self->base_layer, 0.0, 0.0);
+  cairo_paint (cr);
+
+  if (self->area.width > 0 && self->area.height > 0)
+    {
+      closure.cr = cr;
+      cairo_save (cr);
+      gdk_cairo_rectangle (cr, &self->area);
+      cairo_clip (cr);
+      cairo_translate (cr, self->area.x, self->area.y);
+
+      /* Draw each dataset */
+      start = g_get_monotonic_time ();
+      poc_plot_flush_datasets (self);
+      closure.gl = poc_plot_get_gl (self);
+      poc_plot_update_splines (self);
+      if (self->threaded_datasets)
+	poc_plot_rasterise_datasets (self, self->layer_scale);
+      poc_object_bag_foreach (self->datasets, poc_plot_draw_dataset, &closure);
+      if (closure.gl_pending)
+	poc_gl_end (closure.gl, cr);
+      if (stats != NULL)
+	stats->datasets_time = g_get_monotonic_time () - start;
+
+      /* Draw the grid */
+      if (self->grid_layer == NULL)
+	{
+	  start = g_get_monotonic_time ();
+	  self->grid_layer = cairo_surface_create_similar (cairo_get_target (cr),
+							   CAIRO_CONTENT_COLOR_ALPHA,
+							   self->area.width,
+							   self->area.height);
+	  lcr = cairo_create (self->grid_layer);
+	  poc_plot_draw_grid (self, lcr, style);
+	  cairo_destroy (lcr);
+	  if (stats != NULL)
+	    stats->grid_time = g_get_monotonic_time () - start;
+	}
+      cairo_set_source_surface (cr, self->grid_layer, 0.0, 0.0);
+      cairo_paint (cr);
+
+      cairo_restore (cr);
+    }
+
+  if (stats != NULL)
+    {
+      stats->frame_time = g_get_monotonic_time () - stats->frame_time;
+      poc_plot_finish_frame_stats (self, stats, closure.axis_stats);
+    }
   return FALSE;
 }
 
+/* render {{{1 */
+
+/**
+ * poc_plot_render:
+ * @self: A #PocPlot
+ * @cr: A #cairo_t
+ * @width: Width of the rendered plot
+ * @height: Height of the rendered plot
+ * @background: (nullable): Background colour or %NULL to leave the
+ * background unpainted.
+ * @grid_stroke: Colour for axis lines, ticks, tick labels and the grid.
+ * @text_fill: Colour for axis legends.
+ *
+ * Render the plot to @cr at @width by @height without reference to the
+ * widget's allocation or style.  Any cairo target may be used, for example an
+ * image, PNG, SVG or PDF surface; drawing is sent directly to @cr without
+ * the cached layers used by the widget, so vector targets receive vector
+ * output.  Colours are given explicitly rather than taken from the widget's
+ * #GtkStyleContext.
+ *
+ * No GTK functions are called while rendering so that independent plots may
+ * be rendered concurrently from several threads.  The caller must ensure that
+ * the plot, its datasets and its axes are not shared with another plot or
+ * modified while rendering is in progress, since they hold cached state which
+ * is updated while drawing.  Plots should be created and configured on the
+ * main thread before being handed to worker threads.
+ *
+ * Invalidation deferred by poc_dataset_freeze_update() is performed only when
+ * called on the main thread; datasets rendered from other threads should
+ * not be frozen.
+ *
+ * If the plot is also shown on screen, it is laid out again on the next
+ * redraw.
+ */
+void
+poc_plot_render (PocPlot *self, cairo_t *cr, guint width, guint height,
+		 const GdkRGBA *background,
+		 const GdkRGBA *grid_stroke, const GdkRGBA *text_fill)
+{
+  struct poc_plot_closure closure = { NULL, NULL, NULL, { 0, 0, 0, 0 }, 0, 0, 0, 0, NULL, NULL, NULL, NULL, FALSE };
+
+  g_return_if_fail (POC_IS_PLOT (self));
+  g_return_if_fail (cr != NULL);
+  g_return_if_fail (grid_stroke != NULL);
+  g_return_if_fail (text_fill != NULL);
+
+  poc_plot_flush_invalidate (self);
+  closure.self = self;
+  closure.cr = cr;
+  closure.area.width = width;
+  closure.area.height = height;
+  closure.grid_stroke = grid_stroke;
+  closure.text_fill = text_fill;
+
+  poc_plot_layout (self, &closure);
+  self->relayout = TRUE;
+
+  cairo_save (cr);
+  if (background != NULL)
+    {
+      gdk_cairo_set_source_rgba (cr, background);
+      cairo_paint (cr);
+    }
+
+  /* Draw axes */
+  poc_object_bag_foreach (self->axes, poc_plot_draw_axis, &closure);
+
+  if (self->area.width > 0 && self->area.height > 0)
+    {
+      /**** draw the plot background ****/
+      gdk_cairo_rectangle (cr, &self->area);
+      if (self->enable_plot_fill)
+	{
+	  gdk_cairo_set_source_rgba (cr, &self->plot_fill);
+	  cairo_fill_preserve (cr);
+	}
+      cairo_clip (cr);
+      cairo_translate (cr, self->area.x, self->area.y);
+
+      /* Draw each dataset */
+      if (g_main_context_is_owner (g_main_context_default ()))
+	poc_plot_flush_datasets (self);
+      poc_object_bag_foreach (self->datasets, poc_plot_draw_dataset, &closure);
+
+      /* Draw the grid */
+      if (self->x_axis != NULL)
+	poc_axis_draw_grid_rgba (self->x_axis, cr, GTK_ORIENTATION_HORIZONTAL,
+				 self->area.width, self->area.height,
+				 grid_stroke);
+      if (self->y_axis != NULL)
+	poc_axis_draw_grid_rgba (self->y_axis, cr, GTK_ORIENTATION_VERTICAL,
+				 self->area.width, self->area.height,
+				 grid_stroke);
+    }
+  cairo_restore (cr);
+}
+
+/* The GL context belongs to the widget's window */
+static void
+poc_plot_unrealize (GtkWidget *widget)
+{
+  PocPlot *self = (PocPlot *) widget;
+
+  g_clear_pointer (&self->gl, poc_gl_free);
+  self->gl_failed = FALSE;
+  GTK_WIDGET_CLASS (poc_plot_parent_class)->unrealize (widget);
+}
+
+static void
+poc_plot_style_updated (GtkWidget *widget)
+{
+  PocPlot *self = (PocPlot *) widget;
+
+  GTK_WIDGET_CLASS (poc_plot_parent_class)->style_updated (widget);
+  poc_plot_invalidate_layers (self);
+  self->relayout = TRUE;
+}
+
 /* layout {{{1 */
 
 static void
@@ -773,6 +1772,79 @@ poc_plot_layout (PocPlot *self, struct poc_plot_closure *closure)
 
 /* methods {{{1 */
 
+static void
+poc_plot_dataset_data_free (gpointer data)
+{
+  PocPlotDataset *dataset_data = data;
+
+  if (dataset_data->layer != NULL)
+    cairo_surface_destroy (dataset_data->layer);
+  g_free (dataset_data->nickname);
+  g_free (dataset_data);
+}
+
+/* Datasets are indexed by nickname so that poc_plot_find_dataset() does not
+   need to scan the bag.  Each index entry is a queue of datasets sharing the
+   nickname in the order they acquired it; references are borrowed from the
+   bag.  The key under which a dataset is indexed is kept in its
+   PocPlotDataset since the nickname may have changed by the time the
+   dataset is unindexed.  */
+
+static void
+poc_plot_index_nickname (PocPlot *self, PocDataset *dataset,
+			 PocPlotDataset *data)
+{
+  const gchar *nickname;
+  GQueue *queue;
+
+  nickname = poc_dataset_get_nickname (dataset);
+  data->nickname = g_strdup (nickname);
+  if (nickname == NULL || self->nicknames == NULL)
+    return;
+
+  queue = g_hash_table_lookup (self->nicknames, nickname);
+  if (queue == NULL)
+    {
+      queue = g_queue_new ();
+      g_hash_table_insert (self->nicknames, g_strdup (nickname), queue);
+    }
+  g_queue_push_tail (queue, dataset);
+}
+
+static void
+poc_plot_unindex_nickname (PocPlot *self, PocDataset *dataset,
+			   const gchar *nickname)
+{
+  GQueue *queue;
+
+  if (nickname == NULL || self->nicknames == NULL)
+    return;
+
+  queue = g_hash_table_lookup (self->nicknames, nickname);
+  if (queue == NULL)
+    return;
+  g_queue_remove (queue, dataset);
+  if (g_queue_is_empty (queue))
+    g_hash_table_remove (self->nicknames, nickname);
+}
+
+static void
+poc_plot_dataset_nickname (PocDataset *dataset,
+			   G_GNUC_UNUSED GParamSpec *pspec, PocPlot *self)
+{
+  PocPlotDataset *data;
+
+  if (self->datasets == NULL)
+    return;
+  data = poc_object_bag_get_data (self->datasets, G_OBJECT (dataset));
+  if (data == NULL)
+    return;
+
+  poc_plot_unindex_nickname (self, dataset, data->nickname);
+  g_clear_pointer (&data->nickname, g_free);
+  poc_plot_index_nickname (self, dataset, data);
+}
+
 /**
  * poc_plot_add_dataset:
  * @self: A #PocPlot
@@ -789,6 +1861,7 @@ poc_plot_add_dataset (PocPlot *self, PocDataset *dataset,
 {
   PocAxis *axis;
   PocPlotDataset *data;
+  gboolean added;
 
   g_return_if_fail (POC_IS_PLOT (self));
   g_return_if_fail (POC_IS_DATASET (dataset));
@@ -796,14 +1869,18 @@ poc_plot_add_dataset (PocPlot *self, PocDataset *dataset,
   g_object_freeze_notify (G_OBJECT (self));
 
   //XXX Dataset should probably be initiallyunowned and use ref_sink
-  if (!poc_object_bag_add (self->datasets, G_OBJECT (dataset)))
+  added = !poc_object_bag_add (self->datasets, G_OBJECT (dataset));
+  if (added)
     {
       data = g_new0 (PocPlotDataset, 1);
-      poc_object_bag_set_data_full (self->datasets, G_OBJECT (dataset), data, g_free);
+      poc_object_bag_set_data_full (self->datasets, G_OBJECT (dataset), data,
+				    poc_plot_dataset_data_free);
+      poc_plot_index_nickname (self, dataset, data);
 
       g_signal_connect_object (dataset, "update",
-			       G_CALLBACK (poc_plot_notify_update), self,
-			       G_CONNECT_SWAPPED);
+			       G_CALLBACK (poc_plot_dataset_update), self, 0);
+      g_signal_connect_object (dataset, "notify::nickname",
+			       G_CALLBACK (poc_plot_dataset_nickname), self, 0);
     }
 
   if ((axis = poc_dataset_get_x_axis (dataset)) != NULL)
@@ -818,7 +1895,9 @@ poc_plot_add_dataset (PocPlot *self, PocDataset *dataset,
       if (self->y_axis == NULL)
 	poc_plot_set_y_axis (self, axis);
     }
-  gtk_widget_queue_draw (GTK_WIDGET (self));
+  poc_plot_queue_redraw (self);
+  if (added)
+    g_signal_emit (self, poc_plot_signals[DATASET_ADDED], 0, dataset);
   g_object_thaw_notify (G_OBJECT (self));
 }
 
@@ -830,13 +1909,19 @@ poc_plot_remove_dataset_internal (PocPlot *self, PocDataset *dataset)
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wpedantic"
   g_signal_handlers_disconnect_by_func (dataset,
-  					G_CALLBACK (poc_plot_notify_update),
+  					G_CALLBACK (poc_plot_dataset_update),
+					self);
+  g_signal_handlers_disconnect_by_func (dataset,
+  					G_CALLBACK (poc_plot_dataset_nickname),
 					self);
 #pragma GCC diagnostic pop
+  if (self->gl != NULL)
+    poc_gl_forget (self->gl, dataset);
   if ((axis = poc_dataset_get_x_axis (dataset)) != NULL)
     poc_plot_remove_axis (self, axis);
   if ((axis = poc_dataset_get_y_axis (dataset)) != NULL)
     poc_plot_remove_axis (self, axis);
+  g_signal_emit (self, poc_plot_signals[DATASET_REMOVED], 0, dataset);
 }
 
 /**
@@ -851,16 +1936,25 @@ poc_plot_remove_dataset_internal (PocPlot *self, PocDataset *dataset)
 void
 poc_plot_remove_dataset (PocPlot *self, PocDataset *dataset)
 {
+  PocPlotDataset *data;
+  gchar *nickname;
+
   g_return_if_fail (POC_IS_PLOT (self));
   g_return_if_fail (POC_IS_DATASET (dataset));
 
+  /* The bag frees the dataset's data on final removal, save the index key */
+  data = poc_object_bag_get_data (self->datasets, G_OBJECT (dataset));
+  nickname = data != NULL ? g_strdup (data->nickname) : NULL;
+
   g_object_ref (dataset);
   if (poc_object_bag_remove (self->datasets, G_OBJECT (dataset)))
     {
+      poc_plot_unindex_nickname (self, dataset, nickname);
       poc_plot_remove_dataset_internal (self, dataset);
-      gtk_widget_queue_draw (GTK_WIDGET (self));
+      poc_plot_queue_redraw (self);
     }
   g_object_unref (dataset);
+  g_free (nickname);
 }
 
 static void
@@ -884,19 +1978,8 @@ poc_plot_clear_dataset (PocPlot *self)
 {
   poc_object_bag_foreach (self->datasets, poc_plot_clear_dataset_cb, self);
   poc_object_bag_empty (self->datasets);
-  gtk_widget_queue_draw (GTK_WIDGET (self));
-}
-
-static gboolean
-poc_plot_dataset_compare (gpointer object, G_GNUC_UNUSED gpointer object_data,
-			  gpointer user_data)
-{
-  PocDataset *dataset = object;
-  const gchar *nickname = user_data;
-  const gchar *ds_name;
-
-  ds_name = poc_dataset_get_nickname (dataset);
-  return g_strcmp0 (nickname, ds_name) == 0;
+  g_hash_table_remove_all (self->nicknames);
+  poc_plot_queue_redraw (self);
 }
 
 /**
@@ -904,19 +1987,22 @@ poc_plot_dataset_compare (gpointer object, G_GNUC_UNUSED gpointer object_data,
  * @self: A #PocPlot
  * @nickname: Nickname for a #PocDataset
  *
- * Find a dataset belonging to the plot with the requested nickname.
+ * Find a dataset belonging to the plot with the requested nickname.  If
+ * several datasets share the nickname, the one that acquired it first is
+ * returned.
  *
  * returns: (transfer none): a #PocDataset or %NULL if not found.
  */
 PocDataset *
 poc_plot_find_dataset (PocPlot *self, const gchar *nickname)
 {
-  GObject *object;
+  GQueue *queue;
 
   g_return_val_if_fail (POC_IS_PLOT (self), NULL);
-  object = poc_object_bag_find (self->datasets, poc_plot_dataset_compare,
-  				(gpointer) nickname);
-  return object != NULL ? POC_DATASET (object) : NULL;
+  if (nickname == NULL || self->nicknames == NULL)
+    return NULL;
+  queue = g_hash_table_lookup (self->nicknames, nickname);
+  return queue != NULL ? g_queue_peek_head (queue) : NULL;
 }
 
 /**
@@ -948,7 +2034,7 @@ poc_plot_solo_dataset (PocPlot *self, PocDataset *dataset, gboolean solo)
     return;
   data->solo = !!solo;
   g_assert (self->solo >= 0);
-  gtk_widget_queue_draw (GTK_WIDGET (self));
+  poc_plot_queue_redraw (self);
 }
 
 /**
@@ -986,7 +2072,7 @@ poc_plot_add_axis (PocPlot *self, PocAxis *axis, gboolean hidden,
 			       G_CONNECT_SWAPPED);
 
       self->relayout = TRUE;
-      gtk_widget_queue_draw (GTK_WIDGET (self));
+      poc_plot_queue_redraw (self);
     }
 }
 
@@ -1022,7 +2108,7 @@ poc_plot_remove_axis (PocPlot *self, PocAxis *axis)
 	  g_object_notify_by_pspec (G_OBJECT (self), poc_plot_prop[PROP_Y_AXIS]);
 	}
       self->relayout = TRUE;
-      gtk_widget_queue_draw (GTK_WIDGET (self));
+      poc_plot_queue_redraw (self);
     }
 }
 
@@ -1040,7 +2126,7 @@ poc_plot_clear_axes (PocPlot *self)
   poc_object_bag_empty (self->axes);
 
   self->relayout = TRUE;
-  gtk_widget_queue_draw (GTK_WIDGET (self));
+  poc_plot_queue_redraw (self);
   g_object_notify_by_pspec (G_OBJECT (self), poc_plot_prop[PROP_X_AXIS]);
   g_object_notify_by_pspec (G_OBJECT (self), poc_plot_prop[PROP_Y_AXIS]);
 }
@@ -1086,16 +2172,279 @@ poc_plot_axis_at_point (PocPlot *self, gdouble x, gdouble y)
   return POC_AXIS (obj);
 }
 
+struct dataset_at_point
+  {
+    PocPlot *self;
+    gdouble x, y;
+    gdouble max_distance;
+    PocDataset *dataset;
+    guint index;
+  };
+
+static void
+poc_plot_nearest_dataset_point (gpointer object, gpointer obj_data,
+				gpointer user_data)
+{
+  PocPlotDataset *dataset_data = obj_data;
+  struct dataset_at_point *closure = user_data;
+  PocPlot *self = closure->self;
+  gdouble distance;
+  guint index;
+
+  if (self->solo != 0 && !dataset_data->solo)
+    return;
+  if (poc_dataset_nearest_point (POC_DATASET (object), closure->x, closure->y,
+				 self->area.width, self->area.height,
+				 closure->max_distance, &index, &distance))
+    {
+      /* Later datasets are drawn above earlier ones and win ties */
+      closure->max_distance = distance;
+      closure->dataset = POC_DATASET (object);
+      closure->index = index;
+    }
+}
+
+/**
+ * poc_plot_dataset_at_point:
+ * @self: A #PocPlot
+ * @x: x-coordinate in pixels
+ * @y: y-coordinate in pixels
+ * @max_distance: search radius in pixels
+ * @index: (out) (optional): location to store the index of the point
+ *
+ * Find the displayed dataset having a point nearest to the specified @x, @y
+ * coordinate and within @max_distance of it, for example to show a tooltip
+ * for the data under the pointer.  See poc_dataset_nearest_point().
+ *
+ * Returns: (transfer none) (nullable): the #PocDataset or %NULL.
+ */
+PocDataset *
+poc_plot_dataset_at_point (PocPlot *self, gdouble x, gdouble y,
+			   gdouble max_distance, guint *index)
+{
+  struct dataset_at_point closure;
+
+  g_return_val_if_fail (POC_IS_PLOT (self), NULL);
+
+  if (self->area.width <= 0 || self->area.height <= 0)
+    return NULL;
+
+  closure.self = self;
+  closure.x = x - self->area.x;
+  closure.y = y - self->area.y;
+  closure.max_distance = max_distance;
+  closure.dataset = NULL;
+  closure.index = 0;
+  poc_object_bag_foreach (self->datasets, poc_plot_nearest_dataset_point,
+			  &closure);
+  if (closure.dataset != NULL && index != NULL)
+    *index = closure.index;
+  return closure.dataset;
+}
+
 /**
  * poc_plot_notify_update:
  * @self: A #PocPlot
  *
- * Notify PocPlot of updates in a dataset or axis.
+ * Notify PocPlot of updates in a dataset or axis.  The plot caches its
+ * background, axes and grid between redraws; calling this function discards
+ * the cached layers so that they are redrawn along with the datasets.
  */
 void
 poc_plot_notify_update (PocPlot *self)
 {
-  gtk_widget_queue_draw (GTK_WIDGET (self));
+  self->invalidate_pending = TRUE;
+  poc_plot_queue_redraw (self);
+}
+
+static void
+poc_plot_flush_invalidate (PocPlot *self)
+{
+  if (!self->invalidate_pending)
+    return;
+  self->invalidate_pending = FALSE;
+  poc_plot_invalidate_layers (self);
+  poc_plot_invalidate_dataset_layers (self, FALSE);
+}
+
+/* Dataset updates leave the cached layers intact apart from the dataset's
+   own layer */
+static void
+poc_plot_dataset_update (PocDataset *dataset, PocPlot *self)
+{
+  PocPlotDataset *data;
+
+  data = poc_object_bag_get_data (self->datasets, G_OBJECT (dataset));
+  if (data != NULL)
+    data->dirty = TRUE;
+  if (self->gl != NULL)
+    poc_gl_invalidate (self->gl, dataset);
+  poc_plot_queue_redraw (self);
+}
+
+/* update transactions {{{1 */
+
+/* Redraws requested while the plot is frozen are held until it is thawed.
+   Otherwise the first request in a frame installs a tick callback and any
+   further requests are absorbed until it runs, so that the widget is queued
+   for drawing at most once per frame clock tick.  The tick callback also
+   prepares each dataset and remains installed while any dataset asks to be
+   prepared on every frame, for example to drain a producer queue.  */
+
+/* Deferred invalidation must run on the main thread before datasets are
+   drawn, possibly on worker threads */
+static void
+poc_plot_flush_dataset (gpointer object, G_GNUC_UNUSED gpointer object_data,
+			G_GNUC_UNUSED gpointer user_data)
+{
+  poc_dataset_flush_invalidate (POC_DATASET (object));
+}
+
+static void
+poc_plot_flush_datasets (PocPlot *self)
+{
+  if (self->datasets != NULL)
+    poc_object_bag_foreach (self->datasets, poc_plot_flush_dataset, NULL);
+}
+
+static void
+poc_plot_prepare_dataset (gpointer object, G_GNUC_UNUSED gpointer object_data,
+			  gpointer user_data)
+{
+  gboolean *live = user_data;
+
+  if (poc_dataset_prepare (POC_DATASET (object)))
+    *live = TRUE;
+}
+
+static gboolean
+poc_plot_prepare_datasets (PocPlot *self)
+{
+  gboolean live = FALSE;
+
+  if (self->datasets != NULL)
+    poc_object_bag_foreach (self->datasets, poc_plot_prepare_dataset, &live);
+  return live;
+}
+
+static gboolean
+poc_plot_tick (GtkWidget *widget, G_GNUC_UNUSED GdkFrameClock *frame_clock,
+	       G_GNUC_UNUSED gpointer user_data)
+{
+  PocPlot *self = (PocPlot *) widget;
+  gboolean live;
+
+  live = poc_plot_prepare_datasets (self);
+  if (self->redraw_pending && self->update_freeze == 0)
+    {
+      self->redraw_pending = FALSE;
+      poc_plot_flush_invalidate (self);
+      gtk_widget_queue_draw (widget);
+    }
+  if (live)
+    return G_SOURCE_CONTINUE;
+  self->tick_id = 0;
+  return G_SOURCE_REMOVE;
+}
+
+static void
+poc_plot_queue_redraw (PocPlot *self)
+{
+  self->redraw_pending = TRUE;
+  if (self->update_freeze > 0 || self->tick_id != 0)
+    return;
+
+  if (gtk_widget_get_realized (GTK_WIDGET (self)))
+    self->tick_id = gtk_widget_add_tick_callback (GTK_WIDGET (self),
+						  poc_plot_tick, NULL, NULL);
+  else
+    {
+      self->redraw_pending = FALSE;
+      gtk_widget_queue_draw (GTK_WIDGET (self));
+    }
+}
+
+static void
+poc_plot_freeze_object (gpointer object, G_GNUC_UNUSED gpointer object_data,
+			gpointer user_data)
+{
+  PocPlot *self = user_data;
+
+  if (POC_IS_DATASET (object))
+    poc_dataset_freeze_update (POC_DATASET (object));
+  else
+    poc_axis_freeze_update (POC_AXIS (object));
+  g_ptr_array_add (self->frozen, g_object_ref (object));
+}
+
+/**
+ * poc_plot_freeze_updates:
+ * @self: A #PocPlot
+ *
+ * Begin a batch of changes to the plot, its datasets and its axes.  Until
+ * the matching call to poc_plot_thaw_updates(), datasets and axes belonging
+ * to the plot defer invalidation, "update" signals and property
+ * notifications, and the plot defers discarding its cached layers and
+ * redrawing.  Calls may be nested.
+ *
+ * Datasets and axes added to the plot while it is frozen are not frozen.
+ */
+void
+poc_plot_freeze_updates (PocPlot *self)
+{
+  g_return_if_fail (POC_IS_PLOT (self));
+
+  if (self->update_freeze++ > 0)
+    return;
+
+  g_object_freeze_notify (G_OBJECT (self));
+  self->frozen = g_ptr_array_new_with_free_func (g_object_unref);
+  poc_object_bag_foreach (self->datasets, poc_plot_freeze_object, self);
+  poc_object_bag_foreach (self->axes, poc_plot_freeze_object, self);
+}
+
+/**
+ * poc_plot_thaw_updates:
+ * @self: A #PocPlot
+ *
+ * End a batch of changes started by poc_plot_freeze_updates().  When the
+ * last freeze is released the deferred updates are applied and, if any
+ * changes were made, a single redraw is scheduled on the widget's frame
+ * clock.
+ */
+void
+poc_plot_thaw_updates (PocPlot *self)
+{
+  GPtrArray *frozen;
+  GObject *object;
+  guint i;
+
+  g_return_if_fail (POC_IS_PLOT (self));
+  g_return_if_fail (self->update_freeze > 0);
+
+  if (self->update_freeze > 1)
+    {
+      self->update_freeze -= 1;
+      return;
+    }
+
+  /* Thaw members while still frozen so that their updates are collapsed */
+  frozen = self->frozen;
+  self->frozen = NULL;
+  for (i = 0; i < frozen->len; i++)
+    {
+      object = g_ptr_array_index (frozen, i);
+      if (POC_IS_DATASET (object))
+	poc_dataset_thaw_update (POC_DATASET (object));
+      else
+	poc_axis_thaw_update (POC_AXIS (object));
+    }
+  g_ptr_array_unref (frozen);
+
+  self->update_freeze = 0;
+  if (self->redraw_pending)
+    poc_plot_queue_redraw (self);
+  g_object_thaw_notify (G_OBJECT (self));
 }
 
 /* data and axis iterators {{{1 */
@@ -30,6 +30,42 @@
 
 G_BEGIN_DECLS
 
+/* frame statistics */
+
+typedef struct _PocPlotDatasetStats PocPlotDatasetStats;
+struct _PocPlotDatasetStats
+{
+  PocDataset *dataset;
+  gint64 draw_time;
+  guint points;
+  guint segments;
+};
+
+typedef struct _PocPlotAxisStats PocPlotAxisStats;
+struct _PocPlotAxisStats
+{
+  PocAxis *axis;
+  gint64 draw_time;
+};
+
+typedef struct _PocPlotFrameStats PocPlotFrameStats;
+struct _PocPlotFrameStats
+{
+  gint64 frame_time;
+  gint64 layout_time;
+  gint64 axes_time;
+  gint64 datasets_time;
+  gint64 grid_time;
+  guint n_datasets;
+  PocPlotDatasetStats *datasets;
+  guint n_axes;
+  PocPlotAxisStats *axes;
+};
+PocPlotFrameStats *poc_plot_frame_stats_copy (const PocPlotFrameStats *stats);
+void		poc_plot_frame_stats_free (PocPlotFrameStats *stats);
+GType		poc_plot_frame_stats_get_type (void) G_GNUC_CONST;
+#define POC_TYPE_PLOT_FRAME_STATS (poc_plot_frame_stats_get_type ())
+
 #define POC_TYPE_PLOT			poc_plot_get_type ()
 G_DECLARE_FINAL_TYPE (PocPlot, poc_plot, POC, PLOT, GtkDrawingArea)
 
@@ -49,6 +85,16 @@ PocAxis *	poc_plot_get_x_axis (PocPlot *self);
 void		poc_plot_set_y_axis (PocPlot *self, PocAxis *y_axis);
 PocAxis *	poc_plot_get_y_axis (PocPlot *self);
 void		poc_plot_set_axis (PocPlot *self, PocAxis *axis);
+void		poc_plot_set_dataset_layers (PocPlot *self, gboolean value);
+gboolean	poc_plot_get_dataset_layers (PocPlot *self);
+void		poc_plot_set_threaded_datasets (PocPlot *self, gboolean value);
+gboolean	poc_plot_get_threaded_datasets (PocPlot *self);
+void		poc_plot_set_frame_stats_enabled (PocPlot *self, gboolean value);
+gboolean	poc_plot_get_frame_stats_enabled (PocPlot *self);
+void		poc_plot_set_use_gl (PocPlot *self, gboolean value);
+gboolean	poc_plot_get_use_gl (PocPlot *self);
+const PocPlotFrameStats *
+		poc_plot_get_frame_stats (PocPlot *self);
 
 void		poc_plot_add_dataset (PocPlot *self, PocDataset *dataset,
 				      GtkPackType x_pack, GtkPackType y_pack);
@@ -57,6 +103,8 @@ void		poc_plot_clear_dataset (PocPlot *self);
 PocDataset *	poc_plot_find_dataset (PocPlot *self, const gchar *nickname);
 void		poc_plot_solo_dataset (PocPlot *self, PocDataset *dataset, gboolean solo);
 PocAxis *	poc_plot_axis_at_point (PocPlot *self, gdouble x, gdouble y);
+PocDataset *	poc_plot_dataset_at_point (PocPlot *self, gdouble x, gdouble y,
+					   gdouble max_distance, guint *index);
 void		poc_plot_add_axis (PocPlot *self, PocAxis *axis,
 				   gboolean hidden, GtkPackType pack,
 				   GtkOrientation orientation);
@@ -64,6 +112,13 @@ void		poc_plot_remove_axis (PocPlot *self, PocAxis *axis);
 void		poc_plot_clear_axes (PocPlot *self);
 
 void		poc_plot_notify_update (PocPlot *self);
+void		poc_plot_freeze_updates (PocPlot *self);
+void		poc_plot_thaw_updates (PocPlot *self);
+void		poc_plot_render (PocPlot *self, cairo_t *cr,
+				 guint width, guint height,
+				 const GdkRGBA *background,
+				 const GdkRGBA *grid_stroke,
+				 const GdkRGBA *text_fill);
 
 typedef gboolean (*PocPlotDatasetForEachFunc) (PocPlot *self,
 					       PocDataset *dataset,
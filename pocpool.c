@@ -0,0 +1,137 @@
+/* This file is part of PocPlot.
+ *
+ * PocPlot is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * PocPlot is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with PocPlot; if not, see
+ * <https://www.gnu.org/licenses/>.
+ *
+ * Copyright 2020 Brian Stafford
+ */
+#include "pocpool.h"
+
+/* A process wide pool of worker threads.  poc_pool_run() calls func for
+   each item on the pool and waits until all items have been processed.  The
+   calling thread processes items too, so progress is made even if the pool
+   is busy with calls from other threads. */
+
+struct PocPoolJob
+  {
+    GFunc func;
+    gpointer *items;
+    guint n;
+    gpointer user_data;
+    gint next;
+    gint pending;
+    gint ref_count;
+    GMutex mutex;
+    GCond cond;
+  };
+
+/* Workers which start after all items are claimed still hold a reference,
+   so the job is freed by whichever thread finishes with it last */
+static void
+poc_pool_job_unref (struct PocPoolJob *job)
+{
+  if (g_atomic_int_dec_and_test (&job->ref_count))
+    {
+      g_mutex_clear (&job->mutex);
+      g_cond_clear (&job->cond);
+      g_free (job);
+    }
+}
+
+/* Claim and process items until none remain */
+static void
+poc_pool_job_work (struct PocPoolJob *job)
+{
+  guint i;
+  gint done = 0;
+
+  while ((i = (guint) g_atomic_int_add (&job->next, 1)) < job->n)
+    {
+      (*job->func) (job->items[i], job->user_data);
+      done += 1;
+    }
+
+  if (done > 0)
+    {
+      g_mutex_lock (&job->mutex);
+      job->pending -= done;
+      if (job->pending == 0)
+	g_cond_signal (&job->cond);
+      g_mutex_unlock (&job->mutex);
+    }
+}
+
+static void
+poc_pool_worker (gpointer data, G_GNUC_UNUSED gpointer user_data)
+{
+  poc_pool_job_work (data);
+  poc_pool_job_unref (data);
+}
+
+static gpointer
+poc_pool_create (G_GNUC_UNUSED gpointer data)
+{
+  return g_thread_pool_new (poc_pool_worker, NULL,
+			    MAX ((gint) g_get_num_processors () - 1, 1),
+			    FALSE, NULL);
+}
+
+static GThreadPool *
+poc_pool_get (void)
+{
+  static GOnce once = G_ONCE_INIT;
+
+  return g_once (&once, poc_pool_create, NULL);
+}
+
+void
+poc_pool_run (GFunc func, gpointer *items, guint n, gpointer user_data)
+{
+  struct PocPoolJob *job;
+  GThreadPool *pool;
+  guint i, workers;
+
+  if (n == 0)
+    return;
+  if (n == 1)
+    {
+      (*func) (items[0], user_data);
+      return;
+    }
+
+  /* Offload all but one item, which the caller processes */
+  pool = poc_pool_get ();
+  workers = MIN (n - 1, (guint) g_thread_pool_get_max_threads (pool));
+
+  job = g_new (struct PocPoolJob, 1);
+  job->func = func;
+  job->items = items;
+  job->n = n;
+  job->user_data = user_data;
+  job->next = 0;
+  job->pending = n;
+  job->ref_count = workers + 1;
+  g_mutex_init (&job->mutex);
+  g_cond_init (&job->cond);
+
+  for (i = 0; i < workers; i++)
+    g_thread_pool_push (pool, job, NULL);
+  poc_pool_job_work (job);
+
+  g_mutex_lock (&job->mutex);
+  while (job->pending > 0)
+    g_cond_wait (&job->cond, &job->mutex);
+  g_mutex_unlock (&job->mutex);
+  poc_pool_job_unref (job);
+}
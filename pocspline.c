@@ -17,6 +17,8 @@
  * Copyright 2020 Brian Stafford
  */
 #include "pocspline.h"
+#include "pocpool.h"
+#include <math.h>
 
 /**
  * SECTION: pocspline
@@ -28,59 +30,515 @@
  * solves the tridiagonal equation based on Numerical Recipies 2nd Edition
  */
 
+/* Control points are addressed through a pair of vector views so that
+   PocPoint arrays and separate X and Y vectors in any format may be
+   interpolated without first being copied. */
+struct knots
+  {
+    PocVector		x;
+    PocVector		y;
+  };
+
+#define KX(k,i)		poc_vector_index (&(k)->x, (i))
+#define KY(k,i)		poc_vector_index (&(k)->y, (i))
+
+static inline void
+knots_view_doubles (PocVector *view, const gdouble *data)
+{
+  view->data = data;
+  view->len = G_MAXUINT;
+  view->stride = 2;
+  view->format = POC_VECTOR_DOUBLE;
+  view->start = 0.0;
+  view->step = 0.0;
+}
+
+static inline void
+knots_from_points (struct knots *knots, const PocPoint point[])
+{
+  knots_view_doubles (&knots->x, &point->x);
+  knots_view_doubles (&knots->y, &point->y);
+}
+
+/* Solve for the second derivatives y2[].  The scratch array u[] must have
+   room for n - 1 values. */
 static void
-spline_solve (guint n, PocPoint point[], gdouble y2[])
+spline_solve (guint n, const struct knots *knots, gdouble y2[], gdouble u[])
 {
-  gdouble p, sig, *u;
+  gdouble p, sig;
   guint i, k;
 
-  u = g_malloc ((n - 1) * sizeof (u[0]));
-
   y2[0] = y2[n-1] = u[0] = 0.0;	/* set lower boundary condition to "natural" */
 
   for (i = 1; i < n - 1; ++i)
     {
-      sig = (point[i].x - point[i-1].x) / (point[i+1].x - point[i-1].x);
+      sig = (KX (knots, i) - KX (knots, i-1))
+	    / (KX (knots, i+1) - KX (knots, i-1));
       p = sig * y2[i-1] + 2.0;
       y2[i] = (sig - 1.0) / p;
-      u[i] = ((point[i+1].y - point[i].y) / (point[i+1].x - point[i].x)
-	      - (point[i].y - point[i-1].y) / (point[i].x - point[i-1].x));
-      u[i] = (6.0 * u[i] / (point[i+1].x - point[i-1].x) - sig * u[i-1]) / p;
+      u[i] = ((KY (knots, i+1) - KY (knots, i))
+		/ (KX (knots, i+1) - KX (knots, i))
+	      - (KY (knots, i) - KY (knots, i-1))
+		/ (KX (knots, i) - KX (knots, i-1)));
+      u[i] = (6.0 * u[i] / (KX (knots, i+1) - KX (knots, i-1))
+	      - sig * u[i-1]) / p;
     }
 
   for (k = n - 2; k > 0; --k)
     y2[k] = y2[k] * y2[k+1] + u[k];
-
-  g_free (u);
 }
 
-static gdouble
-spline_eval (int n, PocPoint point[], gdouble y2[], gdouble val)
+/* Find k such that x[k] <= val < x[k+1], clamped so that values outside the
+   control points extrapolate from the end intervals. */
+static guint
+spline_find (guint n, const struct knots *knots, gdouble val)
 {
-  gint k_lo, k_hi, k;
-  gdouble h, b, a;
+  guint k_lo, k_hi, k;
 
   /* do a binary search for the right interval */
   k_lo = 0; k_hi = n - 1;
   while (k_hi - k_lo > 1)
     {
       k = (k_hi + k_lo) / 2;
-      if (point[k].x > val)
+      if (KX (knots, k) > val)
 	k_hi = k;
       else
 	k_lo = k;
     }
+  return k_lo;
+}
+
+static inline gdouble
+spline_interpolate (const struct knots *knots, const gdouble y2[],
+		    guint k_lo, gdouble val)
+{
+  guint k_hi = k_lo + 1;
+  gdouble h, b, a;
 
-  h = point[k_hi].x - point[k_lo].x;
-  a = (point[k_hi].x - val) / h;
-  b = (val - point[k_lo].x) / h;
-  return a * point[k_lo].y + b * point[k_hi].y
+  h = KX (knots, k_hi) - KX (knots, k_lo);
+  a = (KX (knots, k_hi) - val) / h;
+  b = (val - KX (knots, k_lo)) / h;
+  return a * KY (knots, k_lo) + b * KY (knots, k_hi)
 	   + ((a*a*a - a) * y2[k_lo] + (b*b*b - b) * y2[k_hi]) * (h*h) / 6.0;
 }
 
+static gdouble
+spline_eval (guint n, const struct knots *knots, const gdouble y2[],
+	     gdouble val)
+{
+  return spline_interpolate (knots, y2, spline_find (n, knots, val), val);
+}
+
+/* Evaluate veclen samples evenly spaced between min_x and max_x in a single
+   pass.  The interval is located by binary search for the first sample and
+   then advanced sequentially.  X coordinates are stored in out_x unless it
+   is NULL; successive outputs are stride gdoubles apart. */
+static void
+spline_eval_range (guint n, const struct knots *knots, const gdouble y2[],
+		   gdouble min_x, gdouble max_x, guint veclen,
+		   gdouble *out_x, gdouble *out_y, gsize stride)
+{
+  gdouble rx, dx;
+  guint k, x;
+
+  if (veclen == 0)
+    return;
+
+  dx = veclen > 1 ? (max_x - min_x) / (veclen - 1) : 0.0;
+  k = spline_find (n, knots, min_x);
+  for (x = 0; x < veclen; x++)
+    {
+      rx = min_x + x * dx;
+      while (k < n - 2 && KX (knots, k+1) <= rx)
+	k++;
+      if (out_x != NULL)
+	out_x[x * stride] = rx;
+      out_y[x * stride] = spline_interpolate (knots, y2, k, rx);
+    }
+}
+
+/* The second derivative of the cubic on interval k_lo at val; it is linear
+   in val, including when extrapolating beyond the end knots. */
+static inline gdouble
+spline_y2_at (const struct knots *knots, const gdouble y2[],
+	      guint k_lo, gdouble val)
+{
+  gdouble b;
+
+  b = (val - KX (knots, k_lo)) / (KX (knots, k_lo + 1) - KX (knots, k_lo));
+  return (1.0 - b) * y2[k_lo] + b * y2[k_lo + 1];
+}
+
+static inline void
+spline_emit (GArray *out, const struct knots *knots, const gdouble y2[],
+	     guint k_lo, gdouble val)
+{
+  PocPoint p;
+
+  p.x = val;
+  p.y = spline_interpolate (knots, y2, k_lo, val);
+  g_array_append_val (out, p);
+}
+
+/* Sample the curve between min_x and max_x so that no chord deviates from
+   the curve by more than tolerance pixels.  For a function whose second
+   derivative is bounded by m the deviation of a chord of length h is at
+   most m h^2 / 8.  The spline's second derivative is piecewise linear so m
+   is the largest |y2| at the ends of the spans making up the chord.  Chords
+   are extended greedily across knots while the bound allows; a single span
+   too curved to be spanned by one chord is divided evenly, though into no
+   more pieces than the pixels it covers. */
+static void
+spline_sample_adaptive (guint n, const struct knots *knots, const gdouble y2[],
+			gdouble min_x, gdouble max_x,
+			gdouble x_scale, gdouble y_scale, gdouble tolerance,
+			GArray *out)
+{
+  gdouble limit, x0, p, q, m, m_p, m_q, m_pq, segs, cap;
+  guint k, j;
+
+  limit = 8.0 * tolerance / y_scale;
+  k = spline_find (n, knots, min_x);
+  spline_emit (out, knots, y2, k, min_x);
+  if (!(max_x > min_x))
+    return;
+
+  x0 = p = min_x;
+  m = fabs (spline_y2_at (knots, y2, k, p));
+  while (p < max_x)
+    {
+      /* The cubic changes only at interior knots */
+      q = k + 1 <= n - 2 ? MIN (KX (knots, k + 1), max_x) : max_x;
+      m_p = fabs (spline_y2_at (knots, y2, k, p));
+      m_q = fabs (spline_y2_at (knots, y2, k, q));
+      m_pq = MAX (m_p, m_q);
+
+      if (MAX (m, m_pq) * (q - x0) * (q - x0) <= limit)
+	{
+	  /* Extend the chord to q */
+	  m = MAX (m, m_pq);
+	}
+      else if (p > x0)
+	{
+	  /* End the chord at p and start another there */
+	  spline_emit (out, knots, y2, k, p);
+	  x0 = p;
+	  m = m_p;
+	  continue;
+	}
+      else
+	{
+	  /* Divide the span [p, q] evenly */
+	  segs = ceil ((q - p) / sqrt (limit / m_pq));
+	  cap = ceil ((q - p) * x_scale);
+	  if (!(segs <= cap))
+	    segs = cap;
+	  for (j = 1; j < segs; j++)
+	    spline_emit (out, knots, y2, k, p + j * (q - p) / segs);
+	  if (q < max_x)
+	    spline_emit (out, knots, y2, k, q);
+	  x0 = q;
+	  m = m_q;
+	}
+
+      p = q;
+      if (q < max_x)
+	k++;
+    }
+  spline_emit (out, knots, y2, MIN (k, n - 2), max_x);
+}
+
+/* PocSpline {{{1 */
+
 /**
- * poc_spline_get_vector:
- * @points: A #PocPointArray of control points.
+ * PocSpline:
+ *
+ * An opaque reference counted boxed type holding a set of control points and
+ * the second derivatives of the interpolating spline.  The tridiagonal
+ * equation is solved once when the #PocSpline is created after which the
+ * curve may be evaluated over any range at low cost.
+ */
+struct _PocSpline
+  {
+    gint		ref_count;
+    guint		n_points;
+    struct knots	knots;
+    PocPointArray	*points;
+    PocVector		*x_vector;
+    PocVector		*y_vector;
+    gdouble		*y2;
+  };
+
+/* Scratch space for solving is kept per thread so that solving many
+   splines, for instance with poc_spline_solve_batch(), does not allocate
+   for each one.  Larger systems allocate their own. */
+#define SCRATCH_SIZE	4096
+
+static GPrivate spline_scratch_key = G_PRIVATE_INIT (g_free);
+
+static gdouble *
+spline_scratch (guint n)
+{
+  gdouble *scratch;
+
+  if (n > SCRATCH_SIZE)
+    return NULL;
+  scratch = g_private_get (&spline_scratch_key);
+  if (scratch == NULL)
+    {
+      scratch = g_new (gdouble, SCRATCH_SIZE);
+      g_private_set (&spline_scratch_key, scratch);
+    }
+  return scratch;
+}
+
+static PocSpline *
+poc_spline_new_knots (guint n_points, const struct knots *knots)
+{
+  PocSpline *spline;
+  gdouble *u, *scratch;
+
+  /* The second derivatives are allocated along with the spline */
+  spline = g_malloc0 (sizeof (PocSpline) + n_points * sizeof (gdouble));
+  spline->ref_count = 1;
+  spline->n_points = n_points;
+  spline->knots = *knots;
+  spline->y2 = (gdouble *) (spline + 1);
+
+  scratch = spline_scratch (n_points);
+  u = scratch != NULL ? scratch : g_new (gdouble, n_points);
+  spline_solve (n_points, &spline->knots, spline->y2, u);
+  if (u != scratch)
+    g_free (u);
+  return spline;
+}
+
+/**
+ * poc_spline_new:
+ * @points: A #PocPointArray of at least two control points.
+ *
+ * Create a new #PocSpline interpolating @points.  The control points must be
+ * ordered by increasing X coordinate.  A reference to @points is held by the
+ * spline which should not be modified subsequently.
+ *
+ * Returns: (transfer full): A new #PocSpline
+ */
+PocSpline *
+poc_spline_new (PocPointArray *points)
+{
+  PocSpline *spline;
+  struct knots knots;
+
+  g_return_val_if_fail (points != NULL, NULL);
+  g_return_val_if_fail (poc_point_array_len (points) >= 2, NULL);
+
+  knots_from_points (&knots, points->data);
+  spline = poc_spline_new_knots (poc_point_array_len (points), &knots);
+  spline->points = poc_point_array_ref (points);
+  return spline;
+}
+
+/**
+ * poc_spline_new_vectors:
+ * @x: A #PocVector of X coordinates.
+ * @y: A #PocVector of Y coordinates.
+ *
+ * Create a new #PocSpline interpolating control points held in separate X
+ * and Y vectors.  The data is used in place and is not copied.  The X
+ * coordinates must be increasing and at least two control points are
+ * required; if the vectors differ in length the shorter is used.  References
+ * to both vectors are held by the spline.
+ *
+ * Returns: (transfer full): A new #PocSpline
+ */
+PocSpline *
+poc_spline_new_vectors (PocVector *x, PocVector *y)
+{
+  PocSpline *spline;
+  struct knots knots;
+  guint n_points;
+
+  g_return_val_if_fail (x != NULL && y != NULL, NULL);
+  n_points = MIN (poc_vector_len (x), poc_vector_len (y));
+  g_return_val_if_fail (n_points >= 2, NULL);
+
+  knots.x = *x;
+  knots.y = *y;
+  spline = poc_spline_new_knots (n_points, &knots);
+  spline->x_vector = poc_vector_ref (x);
+  spline->y_vector = poc_vector_ref (y);
+  return spline;
+}
+
+/**
+ * poc_spline_ref:
+ * @spline: A #PocSpline
+ *
+ * Increments the reference count of @spline by one. This function is
+ * thread-safe and may be called from any thread.
+ *
+ * Returns: the #PocSpline
+ */
+PocSpline *
+poc_spline_ref (PocSpline *spline)
+{
+  g_return_val_if_fail (spline != NULL, NULL);
+
+  g_atomic_int_inc (&spline->ref_count);
+  return spline;
+}
+
+/**
+ * poc_spline_unref:
+ * @spline: A #PocSpline
+ *
+ * Decrements the reference count of @spline by one, freeing it when the
+ * count drops to zero. This function is thread-safe and may be called from
+ * any thread.
+ */
+void
+poc_spline_unref (PocSpline *spline)
+{
+  g_return_if_fail (spline != NULL);
+
+  if (g_atomic_int_dec_and_test (&spline->ref_count))
+    {
+      if (spline->points != NULL)
+	poc_point_array_unref (spline->points);
+      if (spline->x_vector != NULL)
+	poc_vector_unref (spline->x_vector);
+      if (spline->y_vector != NULL)
+	poc_vector_unref (spline->y_vector);
+      g_free (spline);
+    }
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+G_DEFINE_BOXED_TYPE (PocSpline, poc_spline, poc_spline_ref, poc_spline_unref)
+#pragma GCC diagnostic pop
+
+/**
+ * poc_spline_get_control_points:
+ * @spline: A #PocSpline
+ *
+ * Get the control points interpolated by @spline.
+ *
+ * Returns: (transfer none) (nullable): A #PocPointArray or %NULL if the
+ * spline was created with poc_spline_new_vectors().
+ */
+PocPointArray *
+poc_spline_get_control_points (PocSpline *spline)
+{
+  g_return_val_if_fail (spline != NULL, NULL);
+
+  return spline->points;
+}
+
+/**
+ * poc_spline_evaluate:
+ * @spline: A #PocSpline
+ * @x: An X coordinate
+ *
+ * Evaluate the spline at @x.
+ *
+ * Returns: The interpolated Y coordinate.
+ */
+gdouble
+poc_spline_evaluate (PocSpline *spline, gdouble x)
+{
+  g_return_val_if_fail (spline != NULL, 0.0);
+
+  return spline_eval (spline->n_points, &spline->knots, spline->y2, x);
+}
+
+/**
+ * poc_spline_sample_vector_into:
+ * @spline: A #PocSpline
+ * @min_x: The lowest (leftmost) X coordinate value.
+ * @max_x: The highest (rightmost) X coordinate value.
+ * @out: (array length=veclen): Destination for the Y coordinates.
+ * @veclen: The number or points to be calculated.
+ *
+ * Compute @veclen Y coordinates spaced evenly between and including @min_x
+ * and @max_x into the caller supplied array @out.  The samples are evaluated
+ * in a single pass over the control points and no memory is allocated.
+ */
+void
+poc_spline_sample_vector_into (PocSpline *spline,
+			       gdouble min_x, gdouble max_x,
+			       gdouble *out, guint veclen)
+{
+  g_return_if_fail (spline != NULL);
+  g_return_if_fail (out != NULL || veclen == 0);
+
+  spline_eval_range (spline->n_points, &spline->knots, spline->y2,
+		     min_x, max_x, veclen, NULL, out, 1);
+}
+
+/**
+ * poc_spline_sample_points_into:
+ * @spline: A #PocSpline
+ * @min_x: The lowest (leftmost) X coordinate value.
+ * @max_x: The highest (rightmost) X coordinate value.
+ * @out: (array length=veclen): Destination for the points.
+ * @veclen: The number or points to be calculated.
+ *
+ * Compute @veclen points spaced evenly between and including @min_x and
+ * @max_x into the caller supplied array @out.  The samples are evaluated in a
+ * single pass over the control points and no memory is allocated.
+ */
+void
+poc_spline_sample_points_into (PocSpline *spline,
+			       gdouble min_x, gdouble max_x,
+			       PocPoint *out, guint veclen)
+{
+  g_return_if_fail (spline != NULL);
+  g_return_if_fail (out != NULL || veclen == 0);
+
+  spline_eval_range (spline->n_points, &spline->knots, spline->y2,
+		     min_x, max_x, veclen, &out->x, &out->y, 2);
+}
+
+/**
+ * poc_spline_sample_adaptive:
+ * @spline: A #PocSpline
+ * @min_x: The lowest (leftmost) X coordinate value.
+ * @max_x: The highest (rightmost) X coordinate value.
+ * @x_scale: Pixels per unit of X.
+ * @y_scale: Pixels per unit of Y.
+ * @tolerance: Maximum deviation in pixels of the line through the
+ * points from the curve.
+ *
+ * Compute points between and including @min_x and @max_x such that straight
+ * lines joining them deviate from the curve by at most @tolerance pixels
+ * when plotted at the given scales.  Points are placed densely only where
+ * the curve bends sharply, using the second derivatives of the spline to
+ * bound the error, so flat regions need very few points.  Where the curve is
+ * sharply bent no more than one point per pixel is computed.
+ *
+ * Returns: (transfer full): A #PocPointArray of points.
+ */
+PocPointArray *
+poc_spline_sample_adaptive (PocSpline *spline, gdouble min_x, gdouble max_x,
+			    gdouble x_scale, gdouble y_scale,
+			    gdouble tolerance)
+{
+  GArray *array;
+
+  g_return_val_if_fail (spline != NULL, NULL);
+  g_return_val_if_fail (x_scale > 0.0 && y_scale > 0.0, NULL);
+  g_return_val_if_fail (tolerance > 0.0, NULL);
+
+  array = g_array_new (FALSE, FALSE, sizeof (PocPoint));
+  spline_sample_adaptive (spline->n_points, &spline->knots, spline->y2,
+			  min_x, max_x, x_scale, y_scale, tolerance, array);
+  return (PocPointArray *) array;
+}
+
+/**
+ * poc_spline_sample_vector:
+ * @spline: A #PocSpline
  * @min_x: The lowest (leftmost) X coordinate value.
  * @max_x: The highest (rightmost) X coordinate value.
  * @veclen: The number or points to be calculated in the result vector.
@@ -91,34 +549,77 @@ spline_eval (int n, PocPoint point[], gdouble y2[], gdouble val)
  * Returns: (transfer full): A #PocDoubleArray of Y coordinates.
  */
 PocDoubleArray *
-poc_spline_get_vector (PocPointArray *points,
-		       gdouble min_x, gdouble max_x, guint veclen)
+poc_spline_sample_vector (PocSpline *spline,
+			  gdouble min_x, gdouble max_x, guint veclen)
 {
   PocDoubleArray *array;
-  gdouble rx, ry, dx, *y2v;
-  guint x;
-  guint n_points;
 
-  n_points = poc_point_array_len (points);
-  g_return_val_if_fail (n_points >= 2, NULL);
+  g_return_val_if_fail (spline != NULL, NULL);
 
   array = poc_double_array_sized_new (veclen);
   g_return_val_if_fail (array != NULL && array->data != NULL, NULL);
 
-  y2v = g_malloc (n_points * sizeof (gdouble));
-  spline_solve (n_points, points->data, y2v);
-
-  rx = min_x;
-  dx = (max_x - min_x) / (veclen - 1);
   poc_double_array_set_size (array, veclen);
-  for (x = 0; x < veclen; ++x, rx += dx)
-    {
-      ry = spline_eval (n_points, points->data, y2v, rx);
-      array->data[x] = ry;
-    }
+  poc_spline_sample_vector_into (spline, min_x, max_x, array->data, veclen);
+  return array;
+}
 
-  g_free (y2v);
+/**
+ * poc_spline_sample_points:
+ * @spline: A #PocSpline
+ * @min_x: The lowest (leftmost) X coordinate value.
+ * @max_x: The highest (rightmost) X coordinate value.
+ * @veclen: The number or points to be calculated in the result vector.
+ *
+ * Compute a vector of @veclen points spaced evenly between and including
+ * @min_x and @max_x.
+ *
+ * Returns: (transfer full): A #PocPointArray of (X,Y) coordinates.
+ */
+PocPointArray *
+poc_spline_sample_points (PocSpline *spline,
+			  gdouble min_x, gdouble max_x, guint veclen)
+{
+  PocPointArray *array;
+
+  g_return_val_if_fail (spline != NULL, NULL);
+
+  array = poc_point_array_sized_new (veclen);
+  g_return_val_if_fail (array != NULL && array->data != NULL, NULL);
 
+  poc_point_array_set_size (array, veclen);
+  poc_spline_sample_points_into (spline, min_x, max_x, array->data, veclen);
+  return array;
+}
+
+/* Convenience functions {{{1 */
+
+/**
+ * poc_spline_get_vector:
+ * @points: A #PocPointArray of control points.
+ * @min_x: The lowest (leftmost) X coordinate value.
+ * @max_x: The highest (rightmost) X coordinate value.
+ * @veclen: The number or points to be calculated in the result vector.
+ *
+ * Compute a vector of @veclen Y coordinates spaced evenly between and
+ * including @min_x and @max_x.  If the curve is evaluated repeatedly for
+ * the same control points, create a #PocSpline instead so that the
+ * tridiagonal equation is solved only once.
+ *
+ * Returns: (transfer full): A #PocDoubleArray of Y coordinates.
+ */
+PocDoubleArray *
+poc_spline_get_vector (PocPointArray *points,
+		       gdouble min_x, gdouble max_x, guint veclen)
+{
+  PocDoubleArray *array;
+  PocSpline *spline;
+
+  g_return_val_if_fail (poc_point_array_len (points) >= 2, NULL);
+
+  spline = poc_spline_new (points);
+  array = poc_spline_sample_vector (spline, min_x, max_x, veclen);
+  poc_spline_unref (spline);
   return array;
 }
 
@@ -130,7 +631,9 @@ poc_spline_get_vector (PocPointArray *points,
  * @veclen: The number or points to be calculated in the result vector.
  *
  * Compute a vector of @veclen points spaced evenly between and including
- * @min_x and @max_x.
+ * @min_x and @max_x.  If the curve is evaluated repeatedly for the same
+ * control points, create a #PocSpline instead so that the tridiagonal
+ * equation is solved only once.
  *
  * Returns: (transfer full): A #PocPointArray of (X,Y) coordinates.
  */
@@ -139,30 +642,158 @@ poc_spline_get_points (PocPointArray *points,
 		       gdouble min_x, gdouble max_x, guint veclen)
 {
   PocPointArray *array;
-  PocPoint p;
-  gdouble rx, ry, dx, *y2v;
-  guint x;
+  PocSpline *spline;
+
+  g_return_val_if_fail (poc_point_array_len (points) >= 2, NULL);
+
+  spline = poc_spline_new (points);
+  array = poc_spline_sample_points (spline, min_x, max_x, veclen);
+  poc_spline_unref (spline);
+  return array;
+}
+
+/**
+ * poc_spline_get_vector_into:
+ * @points: A #PocPointArray of control points.
+ * @min_x: The lowest (leftmost) X coordinate value.
+ * @max_x: The highest (rightmost) X coordinate value.
+ * @out: (array length=veclen): Destination for the Y coordinates.
+ * @veclen: The number or points to be calculated.
+ * @scratch: (array): Caller supplied scratch space for at least twice as
+ * many values as there are control points.
+ *
+ * Compute @veclen Y coordinates spaced evenly between and including @min_x
+ * and @max_x into @out.  This is equivalent to poc_spline_get_vector() but
+ * allocates no memory, which suits calling at interactive rates.  On return
+ * the first poc_point_array_len(@points) values of @scratch hold the second
+ * derivatives of the spline.
+ */
+void
+poc_spline_get_vector_into (PocPointArray *points,
+			    gdouble min_x, gdouble max_x,
+			    gdouble *out, guint veclen, gdouble *scratch)
+{
+  struct knots knots;
   guint n_points;
 
   n_points = poc_point_array_len (points);
-  g_return_val_if_fail (n_points >= 2, NULL);
+  g_return_if_fail (n_points >= 2);
+  g_return_if_fail (out != NULL || veclen == 0);
+  g_return_if_fail (scratch != NULL);
 
-  array = poc_point_array_sized_new (veclen);
-  g_return_val_if_fail (array != NULL && array->data != NULL, NULL);
+  knots_from_points (&knots, points->data);
+  spline_solve (n_points, &knots, scratch, scratch + n_points);
+  spline_eval_range (n_points, &knots, scratch,
+		     min_x, max_x, veclen, NULL, out, 1);
+}
 
-  y2v = g_malloc (n_points * sizeof (gdouble));
-  spline_solve (n_points, points->data, y2v);
+/**
+ * poc_spline_get_points_into:
+ * @points: A #PocPointArray of control points.
+ * @min_x: The lowest (leftmost) X coordinate value.
+ * @max_x: The highest (rightmost) X coordinate value.
+ * @out: (array length=veclen): Destination for the points.
+ * @veclen: The number or points to be calculated.
+ * @scratch: (array): Caller supplied scratch space for at least twice as
+ * many values as there are control points.
+ *
+ * Compute @veclen points spaced evenly between and including @min_x and
+ * @max_x into @out.  This is equivalent to poc_spline_get_points() but
+ * allocates no memory, which suits calling at interactive rates.  On return
+ * the first poc_point_array_len(@points) values of @scratch hold the second
+ * derivatives of the spline.
+ */
+void
+poc_spline_get_points_into (PocPointArray *points,
+			    gdouble min_x, gdouble max_x,
+			    PocPoint *out, guint veclen, gdouble *scratch)
+{
+  struct knots knots;
+  guint n_points;
 
-  rx = min_x;
-  dx = (max_x - min_x) / (veclen - 1);
-  for (x = 0; x < veclen; ++x, rx += dx)
+  n_points = poc_point_array_len (points);
+  g_return_if_fail (n_points >= 2);
+  g_return_if_fail (out != NULL || veclen == 0);
+  g_return_if_fail (scratch != NULL);
+
+  knots_from_points (&knots, points->data);
+  spline_solve (n_points, &knots, scratch, scratch + n_points);
+  spline_eval_range (n_points, &knots, scratch,
+		     min_x, max_x, veclen, &out->x, &out->y, 2);
+}
+
+/* batch {{{1 */
+
+/**
+ * PocSplineBatch:
+ * @points: (nullable): A #PocPointArray of control points, or %NULL to use
+ * @x and @y
+ * @x: (nullable): A #PocVector of X coordinates of the control points
+ * @y: (nullable): A #PocVector of Y coordinates of the control points
+ * @spline: (nullable): A solved #PocSpline, or %NULL to solve one from the
+ * control points
+ * @min_x: The lowest (leftmost) X coordinate value.
+ * @max_x: The highest (rightmost) X coordinate value.
+ * @out: (array length=veclen): Destination for the points.
+ * @veclen: The number or points to be calculated.
+ * @x_scale: Pixels per unit of X, for adaptive sampling.
+ * @y_scale: Pixels per unit of Y, for adaptive sampling.
+ * @tolerance: If positive, sample adaptively as
+ * poc_spline_sample_adaptive() instead of into @out.
+ * @samples: (nullable): Set to the adaptively sampled points.
+ *
+ * One curve to be computed by poc_spline_solve_batch().  When @spline is
+ * %NULL on entry it is set to a new #PocSpline, which the caller must
+ * release with poc_spline_unref(), so that the solved curve may be kept and
+ * resampled later.  Likewise @samples, when set, must be released with
+ * poc_point_array_unref().
+ */
+
+static void
+spline_batch_run (gpointer data, G_GNUC_UNUSED gpointer user_data)
+{
+  PocSplineBatch *item = data;
+
+  if (item->spline == NULL)
     {
-      ry = spline_eval (n_points, points->data, y2v, rx);
-      p.x = rx;
-      p.y = ry;
-      poc_point_array_append_val (array, p);
+      if (item->points != NULL)
+	item->spline = poc_spline_new (item->points);
+      else
+	item->spline = poc_spline_new_vectors (item->x, item->y);
     }
-  g_free (y2v);
+  if (item->spline == NULL)
+    return;
+  if (item->tolerance > 0.0)
+    item->samples = poc_spline_sample_adaptive (item->spline,
+						item->min_x, item->max_x,
+						item->x_scale, item->y_scale,
+						item->tolerance);
+  else
+    poc_spline_sample_points_into (item->spline, item->min_x, item->max_x,
+				   item->out, item->veclen);
+}
 
-  return array;
+/**
+ * poc_spline_solve_batch:
+ * @batch: (array length=n): An array of #PocSplineBatch
+ * @n: The number of curves in @batch
+ *
+ * Solve and sample many curves at once.  The curves are shared between a
+ * pool of worker threads and the calling thread, and the function returns
+ * when all have been computed.  The control points and destinations must
+ * not be modified by other threads during the call.
+ */
+void
+poc_spline_solve_batch (PocSplineBatch *batch, guint n)
+{
+  gpointer *items;
+  guint i;
+
+  g_return_if_fail (batch != NULL || n == 0);
+
+  items = g_new (gpointer, n);
+  for (i = 0; i < n; i++)
+    items[i] = &batch[i];
+  poc_pool_run (spline_batch_run, items, n, NULL);
+  g_free (items);
 }
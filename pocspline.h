@@ -27,12 +27,64 @@
 
 G_BEGIN_DECLS
 
+typedef struct _PocSpline PocSpline;
+GType poc_spline_get_type (void) G_GNUC_CONST;
+#define POC_TYPE_SPLINE (poc_spline_get_type ())
+PocSpline *	poc_spline_new (PocPointArray *points);
+PocSpline *	poc_spline_new_vectors (PocVector *x, PocVector *y);
+PocSpline *	poc_spline_ref (PocSpline *spline);
+void		poc_spline_unref (PocSpline *spline);
+PocPointArray *	poc_spline_get_control_points (PocSpline *spline);
+gdouble		poc_spline_evaluate (PocSpline *spline, gdouble x);
+PocPointArray * poc_spline_sample_points (PocSpline *spline,
+					  gdouble min_x, gdouble max_x,
+					  guint veclen);
+PocDoubleArray *poc_spline_sample_vector (PocSpline *spline,
+					  gdouble min_x, gdouble max_x,
+					  guint veclen);
+void		poc_spline_sample_points_into (PocSpline *spline,
+					       gdouble min_x, gdouble max_x,
+					       PocPoint *out, guint veclen);
+void		poc_spline_sample_vector_into (PocSpline *spline,
+					       gdouble min_x, gdouble max_x,
+					       gdouble *out, guint veclen);
+PocPointArray * poc_spline_sample_adaptive (PocSpline *spline,
+					    gdouble min_x, gdouble max_x,
+					    gdouble x_scale, gdouble y_scale,
+					    gdouble tolerance);
+
 PocPointArray * poc_spline_get_points (PocPointArray *points,
 				       gdouble min_x, gdouble max_x,
 				       guint veclen);
 PocDoubleArray *poc_spline_get_vector (PocPointArray *points,
 				       gdouble min_x, gdouble max_x,
 				       guint veclen);
+void		poc_spline_get_points_into (PocPointArray *points,
+					    gdouble min_x, gdouble max_x,
+					    PocPoint *out, guint veclen,
+					    gdouble *scratch);
+void		poc_spline_get_vector_into (PocPointArray *points,
+					    gdouble min_x, gdouble max_x,
+					    gdouble *out, guint veclen,
+					    gdouble *scratch);
+
+typedef struct _PocSplineBatch PocSplineBatch;
+struct _PocSplineBatch
+{
+  PocPointArray *points;
+  PocVector *x;
+  PocVector *y;
+  PocSpline *spline;
+  gdouble min_x;
+  gdouble max_x;
+  PocPoint *out;
+  guint veclen;
+  gdouble x_scale;
+  gdouble y_scale;
+  gdouble tolerance;
+  PocPointArray *samples;
+};
+void		poc_spline_solve_batch (PocSplineBatch *batch, guint n);
 
 G_END_DECLS
 
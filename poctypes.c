@@ -243,6 +243,393 @@ G_DEFINE_BOXED_TYPE (PocDoubleArray, poc_double_array,
 		     poc_double_array_ref, poc_double_array_unref)
 #pragma GCC diagnostic pop
 
+/* Float array {{{1 */
+
+/**
+ * PocFloatArray:
+ * @data: pointer to a #gfloat array.
+ * @len: number of values in the array.
+ *
+ * A wrapper for #GArray to create an array of #gfloat values, using half the
+ * memory of a #PocDoubleArray.  #GArray functions may also be used with
+ * appropriate casts.
+ */
+
+/**
+ * poc_float_array_new:
+ *
+ * A wrapper for #GArray to create an array of #gfloat values.
+ *
+ * Returns: (transfer full): a #PocFloatArray
+ */
+PocFloatArray *
+poc_float_array_new (void)
+{
+  return (PocFloatArray *) g_array_new (FALSE, TRUE, sizeof (gfloat));
+}
+
+/**
+ * poc_float_array_sized_new:
+ * @reserved_size: number of elements preallocated
+ *
+ * A wrapper for #GArray to create an array of #gfloat values with
+ * @reserved_size elements preallocated.  This avoids frequent reallocation, if
+ * you are going to add many elements to the array. Note however that the size
+ * of the array is still zero.
+ *
+ * Returns: (transfer full): a #PocFloatArray
+ */
+PocFloatArray *
+poc_float_array_sized_new (guint reserved_size)
+{
+  return (PocFloatArray *) g_array_sized_new (FALSE, TRUE, sizeof (gfloat),
+					      reserved_size);
+}
+
+/**
+ * poc_float_array_set_size:
+ * @array: a #PocFloatArray
+ * @size: the new size of the array
+ *
+ * Sets the size of the array, expanding it if necessary
+ * The new elements are set to 0.
+ *
+ * Returns: (transfer none): the #PocFloatArray
+ */
+PocFloatArray *
+poc_float_array_set_size (PocFloatArray *array, guint size)
+{
+  return (PocFloatArray *) g_array_set_size ((GArray *) array, size);
+}
+
+/**
+ * poc_float_array_ref:
+ * @array: a #PocFloatArray
+ *
+ * Increments the reference count of @array by one. This function is
+ * thread-safe and may be called from any thread.
+ *
+ * Returns: the #PocFloatArray
+ */
+PocFloatArray *
+poc_float_array_ref (PocFloatArray *array)
+{
+  return (PocFloatArray *) g_array_ref ((GArray *) array);
+}
+
+/**
+ * poc_float_array_unref:
+ * @array: a #PocFloatArray
+ *
+ * Decrements the reference count of @array by one. This function is
+ * thread-safe and may be called from any thread.
+ */
+void
+poc_float_array_unref (PocFloatArray *array)
+{
+  g_array_unref ((GArray *) array);
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+G_DEFINE_BOXED_TYPE (PocFloatArray, poc_float_array,
+		     poc_float_array_ref, poc_float_array_unref)
+#pragma GCC diagnostic pop
+
+/* Vector {{{1 */
+
+/**
+ * PocVector:
+ * @data: pointer to the first value, %NULL for %POC_VECTOR_IMPLICIT.
+ * @len: number of values in the vector.
+ * @stride: distance between successive values, counted in units of the
+ * element type.
+ * @format: a #PocVectorFormat, how the values are stored.
+ * @start: first value of a %POC_VECTOR_IMPLICIT vector.
+ * @step: increment between values of a %POC_VECTOR_IMPLICIT vector.
+ *
+ * A reference counted view of a strided array of values owned by someone
+ * else.  Use poc_vector_index() to access the values.  A #PocVector allows
+ * data held in existing buffers, for example structure-of-arrays or
+ * interleaved sample buffers, to be plotted without copying.
+ *
+ * Values may be stored as #gdouble or, to halve the memory and bandwidth
+ * they use, as #gfloat.  Uniformly spaced values such as sample times need
+ * not be stored at all, see poc_vector_new_implicit().  Drawing and
+ * projection code reads each format directly.
+ */
+
+typedef struct _PocVectorReal PocVectorReal;
+struct _PocVectorReal
+{
+  PocVector vector;
+  gint ref_count;
+  GDestroyNotify destroy;
+  gpointer user_data;
+};
+
+static PocVector *
+poc_vector_new_real (gconstpointer data, guint len, gsize stride,
+		     PocVectorFormat format,
+		     GDestroyNotify destroy, gpointer user_data)
+{
+  PocVectorReal *real;
+
+  real = g_new (PocVectorReal, 1);
+  real->vector.data = data;
+  real->vector.len = len;
+  real->vector.stride = stride;
+  real->vector.format = format;
+  real->vector.start = 0.0;
+  real->vector.step = 0.0;
+  real->ref_count = 1;
+  real->destroy = destroy;
+  real->user_data = user_data;
+  return &real->vector;
+}
+
+/**
+ * poc_vector_new:
+ * @data: (array length=len): pointer to the first value
+ * @len: number of values
+ * @stride: distance between successive values, counted in #gdouble units.
+ * @destroy: (nullable): function called with @user_data when the vector is
+ * freed
+ * @user_data: data passed to @destroy
+ *
+ * Create a vector viewing @len values starting at @data.  The values are not
+ * copied; @data must remain valid until @destroy is called.
+ *
+ * Returns: (transfer full): a #PocVector
+ */
+PocVector *
+poc_vector_new (const gdouble *data, guint len, gsize stride,
+		GDestroyNotify destroy, gpointer user_data)
+{
+  g_return_val_if_fail (data != NULL || len == 0, NULL);
+  g_return_val_if_fail (stride > 0, NULL);
+
+  return poc_vector_new_real (data, len, stride, POC_VECTOR_DOUBLE,
+			      destroy, user_data);
+}
+
+/**
+ * poc_vector_new_float:
+ * @data: (array length=len): pointer to the first value
+ * @len: number of values
+ * @stride: distance between successive values, counted in #gfloat units.
+ * @destroy: (nullable): function called with @user_data when the vector is
+ * freed
+ * @user_data: data passed to @destroy
+ *
+ * Create a vector viewing @len single precision values starting at @data.
+ * The values are not copied; @data must remain valid until @destroy is
+ * called.  Interleaved x, y pairs of floats are viewed as two vectors with
+ * a stride of 2.
+ *
+ * Returns: (transfer full): a #PocVector
+ */
+PocVector *
+poc_vector_new_float (const gfloat *data, guint len, gsize stride,
+		      GDestroyNotify destroy, gpointer user_data)
+{
+  g_return_val_if_fail (data != NULL || len == 0, NULL);
+  g_return_val_if_fail (stride > 0, NULL);
+
+  return poc_vector_new_real (data, len, stride, POC_VECTOR_FLOAT,
+			      destroy, user_data);
+}
+
+/**
+ * poc_vector_new_implicit:
+ * @start: the first value
+ * @step: the increment between successive values
+ * @len: number of values
+ *
+ * Create a vector of @len uniformly spaced values, `start + i * step`, which
+ * occupy no storage.  This is typically used for the X coordinates of
+ * regularly sampled data.
+ *
+ * Returns: (transfer full): a #PocVector
+ */
+PocVector *
+poc_vector_new_implicit (gdouble start, gdouble step, guint len)
+{
+  PocVector *vector;
+
+  vector = poc_vector_new_real (NULL, len, 1, POC_VECTOR_IMPLICIT, NULL, NULL);
+  vector->start = start;
+  vector->step = step;
+  return vector;
+}
+
+static void
+poc_vector_double_array_unref (gpointer data)
+{
+  poc_double_array_unref (data);
+}
+
+/**
+ * poc_vector_new_from_double_array:
+ * @array: a #PocDoubleArray
+ *
+ * Create a vector viewing the contents of @array.  The vector holds a
+ * reference to @array which should not be resized while the vector exists.
+ *
+ * Returns: (transfer full): a #PocVector
+ */
+PocVector *
+poc_vector_new_from_double_array (PocDoubleArray *array)
+{
+  g_return_val_if_fail (array != NULL, NULL);
+
+  return poc_vector_new (array->data, array->len, 1,
+			 poc_vector_double_array_unref,
+			 poc_double_array_ref (array));
+}
+
+static void
+poc_vector_float_array_unref (gpointer data)
+{
+  poc_float_array_unref (data);
+}
+
+/**
+ * poc_vector_new_from_float_array:
+ * @array: a #PocFloatArray
+ *
+ * Create a vector viewing the contents of @array.  The vector holds a
+ * reference to @array which should not be resized while the vector exists.
+ *
+ * Returns: (transfer full): a #PocVector
+ */
+PocVector *
+poc_vector_new_from_float_array (PocFloatArray *array)
+{
+  g_return_val_if_fail (array != NULL, NULL);
+
+  return poc_vector_new_float (array->data, array->len, 1,
+			       poc_vector_float_array_unref,
+			       poc_float_array_ref (array));
+}
+
+/**
+ * poc_vector_get_value:
+ * @vector: a #PocVector
+ * @i: index of the value
+ *
+ * Get the @i'th value of @vector whatever its format.
+ * poc_vector_index() is usually more convenient.
+ *
+ * Returns: the value as a #gdouble
+ */
+gdouble
+poc_vector_get_value (const PocVector *vector, guint i)
+{
+  switch (vector->format)
+    {
+    case POC_VECTOR_DOUBLE:
+      return ((const gdouble *) vector->data)[(gsize) i * vector->stride];
+    case POC_VECTOR_FLOAT:
+      return ((const gfloat *) vector->data)[(gsize) i * vector->stride];
+    case POC_VECTOR_IMPLICIT:
+      return vector->start + i * vector->step;
+    }
+  g_return_val_if_reached (0.0);
+}
+
+/**
+ * poc_vector_read:
+ * @vector: a #PocVector
+ * @start: index of the first value to read
+ * @n: number of values to read
+ * @out: (array length=n): destination for the values
+ * @out_stride: distance between successive elements of @out in #gdouble
+ * units
+ *
+ * Read @n values starting from @start into @out converting them to
+ * #gdouble.  This is faster than poc_vector_index() for runs of values.
+ */
+void
+poc_vector_read (const PocVector *vector, guint start, guint n,
+		 gdouble *out, gsize out_stride)
+{
+  const gdouble *d;
+  const gfloat *f;
+  gsize stride;
+  guint i;
+
+  g_return_if_fail (vector != NULL);
+  g_return_if_fail (start + n <= vector->len);
+
+  stride = vector->stride;
+  switch (vector->format)
+    {
+    case POC_VECTOR_DOUBLE:
+      d = (const gdouble *) vector->data + (gsize) start * stride;
+      for (i = 0; i < n; i++)
+	out[i * out_stride] = d[i * stride];
+      break;
+    case POC_VECTOR_FLOAT:
+      f = (const gfloat *) vector->data + (gsize) start * stride;
+      for (i = 0; i < n; i++)
+	out[i * out_stride] = f[i * stride];
+      break;
+    case POC_VECTOR_IMPLICIT:
+      for (i = 0; i < n; i++)
+	out[i * out_stride] = vector->start + (start + i) * vector->step;
+      break;
+    }
+}
+
+/**
+ * poc_vector_ref:
+ * @vector: a #PocVector
+ *
+ * Increments the reference count of @vector by one. This function is
+ * thread-safe and may be called from any thread.
+ *
+ * Returns: the #PocVector
+ */
+PocVector *
+poc_vector_ref (PocVector *vector)
+{
+  PocVectorReal *real = (PocVectorReal *) vector;
+
+  g_return_val_if_fail (vector != NULL, NULL);
+
+  g_atomic_int_inc (&real->ref_count);
+  return vector;
+}
+
+/**
+ * poc_vector_unref:
+ * @vector: a #PocVector
+ *
+ * Decrements the reference count of @vector by one.  When the count drops to
+ * zero the vector's destroy notify is called. This function is thread-safe
+ * and may be called from any thread.
+ */
+void
+poc_vector_unref (PocVector *vector)
+{
+  PocVectorReal *real = (PocVectorReal *) vector;
+
+  g_return_if_fail (vector != NULL);
+
+  if (g_atomic_int_dec_and_test (&real->ref_count))
+    {
+      if (real->destroy != NULL)
+	(*real->destroy) (real->user_data);
+      g_free (real);
+    }
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+G_DEFINE_BOXED_TYPE (PocVector, poc_vector, poc_vector_ref, poc_vector_unref)
+#pragma GCC diagnostic pop
+
 
 /* Enums {{{1 */
 
@@ -388,3 +775,90 @@ poc_line_style_get_dashes (PocLineStyle line_style, int *num_dashes)
       return NULL;
     }
 }
+
+/* decimation {{{2 */
+
+GType
+poc_decimation_get_type (void)
+{
+  GType type;
+  static gsize poc_decimation_type;
+  static const GEnumValue values[] =
+    {
+      { POC_DECIMATION_NONE,	"POC_DECIMATION_NONE", 		"none" },
+      { POC_DECIMATION_MIN_MAX,	"POC_DECIMATION_MIN_MAX",	"min-max" },
+      { POC_DECIMATION_PYRAMID,	"POC_DECIMATION_PYRAMID",	"pyramid" },
+      { 0, NULL, NULL }
+    };
+
+  if (g_once_init_enter (&poc_decimation_type))
+    {
+      type = g_enum_register_static (g_intern_static_string ("PocDecimation"),
+      				     values);
+      g_value_register_transform_func (type, G_TYPE_STRING,
+				       poc_enum_transform_to_string);
+      g_value_register_transform_func (G_TYPE_STRING, type,
+				       poc_enum_transform_from_string);
+      g_once_init_leave (&poc_decimation_type, type);
+    }
+  return poc_decimation_type;
+}
+
+/* vector format {{{2 */
+
+GType
+poc_vector_format_get_type (void)
+{
+  GType type;
+  static gsize poc_vector_format_type;
+  static const GEnumValue values[] =
+    {
+      { POC_VECTOR_DOUBLE,	"POC_VECTOR_DOUBLE",	"double" },
+      { POC_VECTOR_FLOAT,	"POC_VECTOR_FLOAT",	"float" },
+      { POC_VECTOR_IMPLICIT,	"POC_VECTOR_IMPLICIT",	"implicit" },
+      { 0, NULL, NULL }
+    };
+
+  if (g_once_init_enter (&poc_vector_format_type))
+    {
+      type = g_enum_register_static (g_intern_static_string ("PocVectorFormat"),
+      				     values);
+      g_value_register_transform_func (type, G_TYPE_STRING,
+				       poc_enum_transform_to_string);
+      g_value_register_transform_func (G_TYPE_STRING, type,
+				       poc_enum_transform_from_string);
+      g_once_init_leave (&poc_vector_format_type, type);
+    }
+  return poc_vector_format_type;
+}
+
+/* marker shape {{{2 */
+
+GType
+poc_marker_shape_get_type (void)
+{
+  GType type;
+  static gsize poc_marker_shape_type;
+  static const GEnumValue values[] =
+    {
+      { POC_MARKER_CIRCLE,	"POC_MARKER_CIRCLE",	"circle" },
+      { POC_MARKER_SQUARE,	"POC_MARKER_SQUARE",	"square" },
+      { POC_MARKER_DIAMOND,	"POC_MARKER_DIAMOND",	"diamond" },
+      { POC_MARKER_TRIANGLE,	"POC_MARKER_TRIANGLE",	"triangle" },
+      { POC_MARKER_PLUS,	"POC_MARKER_PLUS",	"plus" },
+      { POC_MARKER_CROSS,	"POC_MARKER_CROSS",	"cross" },
+      { 0, NULL, NULL }
+    };
+
+  if (g_once_init_enter (&poc_marker_shape_type))
+    {
+      type = g_enum_register_static (g_intern_static_string ("PocMarkerShape"),
+      				     values);
+      g_value_register_transform_func (type, G_TYPE_STRING,
+				       poc_enum_transform_to_string);
+      g_value_register_transform_func (G_TYPE_STRING, type,
+				       poc_enum_transform_from_string);
+      g_once_init_leave (&poc_marker_shape_type, type);
+    }
+  return poc_marker_shape_type;
+}
@@ -80,6 +80,81 @@ void poc_double_array_unref (PocDoubleArray *array);
 GType	poc_double_array_get_type (void) G_GNUC_CONST;
 #define POC_TYPE_DOUBLE_ARRAY (poc_double_array_get_type ())
 
+/* float array */
+
+typedef struct _PocFloatArray PocFloatArray;
+struct _PocFloatArray
+{
+  gfloat *data;
+  guint len;
+};
+#define poc_float_array_index(a,i)	((a)->data[(i)])
+#define poc_float_array_len(a)		((a)->len)
+#define poc_float_array_append_vals(a,v,n)	\
+		((PocFloatArray *) g_array_append_vals ((GArray *) (a), (v), (n)))
+#define poc_float_array_append_val(a,v)	\
+		poc_float_array_append_vals ((a), (v), 1)
+PocFloatArray *poc_float_array_new (void);
+PocFloatArray *poc_float_array_sized_new (guint reserved_size);
+PocFloatArray *poc_float_array_set_size (PocFloatArray *array, guint size);
+PocFloatArray *poc_float_array_ref (PocFloatArray *array);
+void poc_float_array_unref (PocFloatArray *array);
+GType	poc_float_array_get_type (void) G_GNUC_CONST;
+#define POC_TYPE_FLOAT_ARRAY (poc_float_array_get_type ())
+
+/* vector */
+
+/**
+ * PocVectorFormat:
+ * @POC_VECTOR_DOUBLE: values are stored as #gdouble
+ * @POC_VECTOR_FLOAT: values are stored as #gfloat
+ * @POC_VECTOR_IMPLICIT: values are not stored, the i'th value is
+ * 	`start + i * step`
+ *
+ * An enumerated type specifying how the values viewed by a #PocVector are
+ * stored.
+ */
+typedef enum
+  {
+    POC_VECTOR_DOUBLE,
+    POC_VECTOR_FLOAT,
+    POC_VECTOR_IMPLICIT
+  }
+PocVectorFormat;
+
+#define POC_TYPE_VECTOR_FORMAT	poc_vector_format_get_type ()
+GType		poc_vector_format_get_type (void) G_GNUC_CONST;
+
+typedef struct _PocVector PocVector;
+struct _PocVector
+{
+  gconstpointer data;
+  guint len;
+  gsize stride;
+  PocVectorFormat format;
+  gdouble start;
+  gdouble step;
+};
+#define poc_vector_index(v,i)		\
+	((v)->format == POC_VECTOR_DOUBLE \
+	 ? ((const gdouble *) (v)->data)[(gsize) (i) * (v)->stride] \
+	 : poc_vector_get_value ((v), (i)))
+#define poc_vector_len(v)		((v)->len)
+PocVector *poc_vector_new (const gdouble *data, guint len, gsize stride,
+			   GDestroyNotify destroy, gpointer user_data);
+PocVector *poc_vector_new_float (const gfloat *data, guint len, gsize stride,
+				 GDestroyNotify destroy, gpointer user_data);
+PocVector *poc_vector_new_implicit (gdouble start, gdouble step, guint len);
+PocVector *poc_vector_new_from_double_array (PocDoubleArray *array);
+PocVector *poc_vector_new_from_float_array (PocFloatArray *array);
+gdouble poc_vector_get_value (const PocVector *vector, guint i);
+void poc_vector_read (const PocVector *vector, guint start, guint n,
+		      gdouble *out, gsize out_stride);
+PocVector *poc_vector_ref (PocVector *vector);
+void poc_vector_unref (PocVector *vector);
+GType	poc_vector_get_type (void) G_GNUC_CONST;
+#define POC_TYPE_VECTOR (poc_vector_get_type ())
+
 /* Enums */
 
 const gchar *poc_enum_to_string (GType enum_type, gint value);
@@ -137,6 +212,58 @@ PocLineStyle;
 GType		poc_line_style_get_type (void) G_GNUC_CONST;
 const double *	poc_line_style_get_dashes (PocLineStyle line_style,
 					   int *num_dashes);
+
+/* decimation */
+
+/**
+ * PocDecimation:
+ * @POC_DECIMATION_NONE: draw every point
+ * @POC_DECIMATION_MIN_MAX: keep only the first, last, minimum and maximum
+ * 	point in each pixel column (M4 decimation)
+ * @POC_DECIMATION_PYRAMID: as %POC_DECIMATION_MIN_MAX but draw from a
+ * 	precomputed multi-resolution min/max index.  X coordinates must be
+ * 	non-decreasing.
+ *
+ * An enumerated type specifying how a #PocDataset reduces the number of
+ * points drawn when there are many more points than pixels.
+ */
+typedef enum
+  {
+    POC_DECIMATION_NONE,
+    POC_DECIMATION_MIN_MAX,
+    POC_DECIMATION_PYRAMID
+  }
+PocDecimation;
+
+#define POC_TYPE_DECIMATION	poc_decimation_get_type ()
+GType		poc_decimation_get_type (void) G_GNUC_CONST;
+
+/* marker shapes */
+
+/**
+ * PocMarkerShape:
+ * @POC_MARKER_CIRCLE: circle
+ * @POC_MARKER_SQUARE: square
+ * @POC_MARKER_DIAMOND: diamond
+ * @POC_MARKER_TRIANGLE: upward pointing triangle
+ * @POC_MARKER_PLUS: plus sign, stroked only
+ * @POC_MARKER_CROSS: diagonal cross, stroked only
+ *
+ * An enumerated type specifying the shape of markers drawn at data points.
+ */
+typedef enum
+  {
+    POC_MARKER_CIRCLE,
+    POC_MARKER_SQUARE,
+    POC_MARKER_DIAMOND,
+    POC_MARKER_TRIANGLE,
+    POC_MARKER_PLUS,
+    POC_MARKER_CROSS
+  }
+PocMarkerShape;
+
+#define POC_TYPE_MARKER_SHAPE	poc_marker_shape_get_type ()
+GType		poc_marker_shape_get_type (void) G_GNUC_CONST;
 G_END_DECLS
 
 #endif